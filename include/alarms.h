@@ -0,0 +1,98 @@
+// =============================================================================
+// Threshold alarms
+// =============================================================================
+// A fixed set of alarms, each watching one quantity (tenths) against a limit
+// from above or from below. An alarm raises when the value goes past its
+// limit and clears only once it is back by the hysteresis, so a reading
+// hovering at the limit does not flap:
+//
+//   humidity high, limit 85.0 %, hysteresis 2.0: raises above 85.0,
+//   clears at 83.0 or below
+//
+// Every raise also sets a latched bit, which stays until acknowledged (and
+// is only cleared if the condition has gone), so an alarm that came and
+// went overnight is still seen in the morning. Checking an alarm is a few
+// compares; it is meant to run once per new sensor value.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+enum AlarmId : uint8_t {
+  ALARM_TEMP_LOW,        // temperature below the limit
+  ALARM_TEMP_HIGH,       // temperature above the limit
+  ALARM_HUMIDITY_HIGH,   // humidity above the limit
+  ALARM_DEW_MARGIN_LOW,  // temperature minus dew point below the limit
+  ALARM_COUNT
+};
+
+// Alarms that watch their value from below
+const uint8_t ALARM_BELOW = (1 << ALARM_TEMP_LOW) | (1 << ALARM_DEW_MARGIN_LOW);
+
+const int16_t ALARM_OFF = 0x7FFF; // limit of a disabled alarm
+
+struct AlarmLimit {
+  int16_t limit;      // tenths, or ALARM_OFF
+  uint8_t hysteresis; // tenths
+};
+
+// Temperature minus dew point (tenths of a degree), from a temperature in
+// tenths of a degree and a relative humidity in tenths of a percent, by the
+// Magnus form (b = 17.62, c = 243.12 C) in 32-bit integers:
+//
+//   g = ln(RH / 100) + b T / (c + T)      dew point = c g / (b - g)
+//
+// ln is taken as -k ln 2 + 2 atanh(z) (three terms), with RH / 100 halved
+// into (0.5, 1] by k doublings, so |z| <= 1/3. Within 0.1 C of the exact
+// Magnus value from -40 to 60 C and 1 to 100 %RH.
+inline int32_t dewDivide(int32_t n, int32_t d) { // rounded, d > 0
+  return (n >= 0 ? n + d / 2 : n - d / 2) / d;
+}
+
+inline int16_t dewPointMargin(int16_t temperature, int16_t humidity) {
+  const int32_t S = 10000;                 // fixed point of ln and g
+  int32_t x = humidity < 1 ? 1 : humidity > 1000 ? 1000 : humidity;
+  uint8_t k = 0;
+  for (; x <= 500; k++) x *= 2;
+  int32_t z = dewDivide((x - 1000) * S, x + 1000);
+  int32_t z2 = dewDivide(z * z, S);
+  int32_t ln = 2 * (z + dewDivide(z * z2, 3 * S) + dewDivide(dewDivide(z * z2, S) * z2, 5 * S)) - k * 6931L;
+  int32_t t = temperature;
+  int32_t g = ln + dewDivide(176200L * t, 2431 + t);
+  int32_t dew = dewDivide(2431 * g, 176200L - g);
+  return (int16_t)(t - dew);
+}
+
+struct AlarmSet {
+  uint8_t active;   // bit per AlarmId: the condition holds now
+  uint8_t latched;  // raised since the last acknowledge
+
+  // Check one alarm against a new value. Returns +1 if it was raised,
+  // -1 if it cleared, 0 if nothing changed.
+  int8_t update(uint8_t id, int16_t value, const AlarmLimit& l) {
+    uint8_t bit = 1 << id;
+    bool on = active & bit;
+    if (l.limit == ALARM_OFF) {
+      active &= ~bit;
+      return on ? -1 : 0;
+    }
+    // Turn a watch from below into one from above
+    bool below = ALARM_BELOW & bit;
+    int16_t v = below ? -value : value;
+    int16_t limit = below ? -l.limit : l.limit;
+    if (!on && v > limit) {
+      active |= bit;
+      latched |= bit;
+      return 1;
+    }
+    if (on && v <= limit - l.hysteresis) {
+      active &= ~bit;
+      return -1;
+    }
+    return 0;
+  }
+
+  // Forget raised alarms whose condition has gone
+  void acknowledge() { latched = active; }
+};
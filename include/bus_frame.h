@@ -0,0 +1,116 @@
+// =============================================================================
+// RS-485 bus frames
+// =============================================================================
+// Frames share the serial line with the text commands. Each is one line of
+// hex, so no command can be mistaken for one:
+//
+//   ':' | address | type | payload ... | CRC-16 (LE) | CR LF
+//
+// where every byte after the ':' is two hex digits and the CRC covers
+// address, type and payload. Address 0 is a broadcast, 1 the coordinator
+// and 2..BUS_ADDRESS_MAX the nodes. Multi-byte payload fields are
+// little-endian, as in the config blob:
+//
+//   'T' time sync, coordinator to all: site time (ms) u32, node count u8
+//   'P' poll, to one node: no payload
+//   'S' status, node to coordinator: site time (ms) u32, sender u8,
+//       flags u8, preset u8, latched alarms u8 (bit n: AlarmId n)
+//
+// A frame is decoded as its characters arrive, so it is never buffered
+// as text. Both frames that carry the site time have it first, so the
+// sender can stamp it as the frame goes out.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+#include "crc16.h"
+
+const char    BUS_FRAME_START = ':';
+const uint8_t BUS_BROADCAST   = 0;
+const uint8_t BUS_COORDINATOR = 1;
+const uint8_t BUS_ADDRESS_MAX = 247;
+const uint8_t BUS_FRAME_MAX   = 10; // address, type and payload bytes
+const uint8_t BUS_LINE_MAX    = 1 + (BUS_FRAME_MAX + 2) * 2; // without line end
+
+enum BusFrameType : uint8_t {
+  BUS_TIME   = 'T',
+  BUS_POLL   = 'P',
+  BUS_STATUS = 'S',
+};
+
+// Status flags
+const uint8_t BUS_STATUS_PUMP   = 0x01; // pump running
+const uint8_t BUS_STATUS_SYNCED = 0x02; // clock follows the coordinator
+
+// Accumulates one frame from the characters after its ':'
+class BusFrameReader {
+public:
+  void begin() {
+    len = 0;
+    highNibble = -1;
+    bad = false;
+    chars = 1;
+  }
+
+  void feed(char c) {
+    if (chars < 0xFF) chars++;
+    int8_t v = hexDigit(c);
+    if (v < 0 || len >= sizeof(buf)) {
+      bad = true;
+      return;
+    }
+    if (highNibble < 0) {
+      highNibble = v;
+    } else {
+      buf[len++] = (highNibble << 4) | v;
+      highNibble = -1;
+    }
+  }
+
+  // At the line end: true if a whole frame arrived with a good CRC
+  bool finish() const {
+    if (bad || highNibble >= 0 || len < 4) return false;
+    uint16_t crc = buf[len - 2] | (buf[len - 1] << 8);
+    return crc == crc16(buf, len - 2);
+  }
+
+  uint8_t address() const { return buf[0]; }
+  uint8_t type() const { return buf[1]; }
+  const uint8_t* payload() const { return buf + 2; }
+  uint8_t payloadLength() const { return len - 4; }
+  // Characters on the wire up to the line end (which is not counted)
+  uint8_t lineLength() const { return chars; }
+
+private:
+  static int8_t hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  uint8_t buf[BUS_FRAME_MAX + 2];
+  uint8_t len;
+  int8_t  highNibble;
+  bool    bad;
+  uint8_t chars;
+};
+
+inline char busHexChar(uint8_t v) { return v < 10 ? '0' + v : 'A' + v - 10; }
+
+// Format a frame of len bytes (address, type, payload) into out, which has
+// room for BUS_LINE_MAX + 1 characters. Returns the line length.
+inline uint8_t busFormatFrame(char* out, const uint8_t* frame, uint8_t len) {
+  uint16_t crc = crc16(frame, len);
+  char* p = out;
+  *p++ = BUS_FRAME_START;
+  for (uint8_t i = 0; i < len + 2; i++) {
+    uint8_t b = i < len ? frame[i] : (i == len ? crc & 0xFF : crc >> 8);
+    *p++ = busHexChar(b >> 4);
+    *p++ = busHexChar(b & 0x0F);
+  }
+  *p = '\0';
+  return p - out;
+}
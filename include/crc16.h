@@ -0,0 +1,24 @@
+// =============================================================================
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+// =============================================================================
+// Shared by the configuration blob, the rule store and the data logger.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+const uint16_t CRC16_INIT = 0xFFFF;
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t b) {
+  crc ^= (uint16_t)b << 8;
+  for (uint8_t i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
+}
+
+inline uint16_t crc16(const uint8_t* data, uint16_t len, uint16_t crc = CRC16_INIT) {
+  while (len--) crc = crc16Update(crc, *data++);
+  return crc;
+}
@@ -0,0 +1,41 @@
+// =============================================================================
+// Vertical-counter debouncing
+// =============================================================================
+// Debounces up to 8 inputs at once, one bit each. Every input has a 2-bit
+// counter, kept "vertically": bit n of cnt0 and cnt1 together count input
+// n. A sample that differs from the debounced level counts down; one that
+// matches resets the counter. After four differing samples in a row the
+// debounced level flips. All inputs are handled by the same handful of
+// bitwise operations, however many there are:
+//
+//   debouncer.begin(sample);                 // levels as they are now
+//   uint8_t changed = debouncer.update(s);   // every tick
+//   uint8_t rose = changed & debouncer.state;
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+const uint8_t DEBOUNCE_SAMPLES = 4; // equal samples in a row to accept a change
+
+struct VerticalDebouncer {
+  uint8_t state;  // debounced levels
+  uint8_t cnt0;   // counter bit 0, per input
+  uint8_t cnt1;   // counter bit 1, per input
+
+  void begin(uint8_t sample) {
+    state = sample;
+    cnt0 = cnt1 = 0xFF;
+  }
+
+  // Feed one sample; returns the inputs whose debounced level flipped
+  uint8_t update(uint8_t sample) {
+    uint8_t delta = sample ^ state;
+    cnt0 = ~(cnt0 & delta);
+    cnt1 = cnt0 ^ (cnt1 & delta);
+    uint8_t changed = delta & cnt0 & cnt1;
+    state ^= changed;
+    return changed;
+  }
+};
@@ -0,0 +1,94 @@
+// =============================================================================
+// Pump duty-cycle limit
+// =============================================================================
+// Protects the pump and the relay contacts from whatever asks for a run (a
+// fast preset, a rule that lengthens runs): a run is only started if the
+// pump has rested for minOff since the last one, and it is cut short to
+// what is left of maxOn within the last `window`.
+//
+// On-time is kept in buckets of window / Buckets each, in whole seconds,
+// with a running total, so checking and recording are a few operations
+// whatever the window. A run is counted in the bucket where it ends, and
+// Buckets + 1 buckets are kept: the current, partly elapsed one and a full
+// window behind it. A run therefore stays counted for at least the window
+// after it ended, and at most one bucket longer.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+// Why a run was not started
+enum DutyVerdict : uint8_t {
+  DUTY_OK,
+  DUTY_DENY_REST,    // less than minOff since the last run
+  DUTY_DENY_BUDGET,  // maxOn already used within the window
+};
+
+template <uint8_t Buckets>
+class DutyLimiter {
+public:
+  DutyLimiter(unsigned long window, unsigned long maxOn, unsigned long rest)
+      : bucketMs(window / Buckets), maxOnSeconds(maxOn / 1000), minOff(rest) {}
+
+  // Decide on a run of duration ms starting now; shortens duration to the
+  // budget left.
+  DutyVerdict check(unsigned long now, unsigned long& duration) {
+    advance(now);
+    if (hasRun && now - lastStop < minOff) return DUTY_DENY_REST;
+    if (total >= maxOnSeconds) return DUTY_DENY_BUDGET;
+    unsigned long left = (unsigned long)(maxOnSeconds - total) * 1000;
+    if (duration > left) duration = left;
+    return DUTY_OK;
+  }
+
+  // Record a run of ran ms that ended now
+  void stopped(unsigned long now, unsigned long ran) {
+    advance(now);
+    unsigned long seconds = (ran + 999) / 1000;
+    if (seconds > maxOnSeconds) seconds = maxOnSeconds; // enough to block the window
+    uint16_t room = 0xFFFF - buckets[head];
+    if (seconds > room) seconds = room;
+    buckets[head] += seconds;
+    total += seconds;
+    lastStop = now;
+    hasRun = true;
+  }
+
+  // On-time within the window (s)
+  uint16_t used(unsigned long now) {
+    advance(now);
+    return total;
+  }
+
+  uint16_t budget() const { return maxOnSeconds; }
+
+private:
+  static const uint8_t Slots = Buckets + 1;
+
+  // Drop the buckets that have left the window
+  void advance(unsigned long now) {
+    if (now - bucketStart >= bucketMs * Slots) {
+      for (uint8_t i = 0; i < Slots; i++) buckets[i] = 0;
+      total = 0;
+      bucketStart = now;
+      return;
+    }
+    while (now - bucketStart >= bucketMs) {
+      bucketStart += bucketMs;
+      head = (head + 1) % Slots;
+      total -= buckets[head];
+      buckets[head] = 0;
+    }
+  }
+
+  const unsigned long bucketMs;
+  const uint16_t      maxOnSeconds;
+  const unsigned long minOff;
+  uint16_t buckets[Slots] = {};    // seconds on, buckets[head] is the newest
+  uint16_t total = 0;              // sum of buckets
+  uint8_t  head = 0;
+  unsigned long bucketStart = 0;   // millis() when buckets[head] began
+  unsigned long lastStop = 0;
+  bool hasRun = false;             // lastStop is valid
+};
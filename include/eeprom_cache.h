@@ -0,0 +1,219 @@
+// =============================================================================
+// EEPROM write-back cache
+// =============================================================================
+// write() only changes a cached copy of the 16-byte line; service() commits
+// one byte per call once writes have been quiet for quietMs and the EEPROM
+// has finished its previous write (eeprom_is_ready()), so the loop never
+// waits the ~3.3 ms a byte write takes. A value written back to what the
+// EEPROM already holds is no longer dirty, so rapid edits coalesce.
+//
+// Lines are committed oldest first (in the order they were first dirtied),
+// and within a line from low to high address. Callers that need a torn
+// write to be detectable keep a CRC, as the config, rule and history
+// records do. A byte written with writeLast() (a record's sequence or
+// length byte) is held back until every other pending byte has been
+// committed, so it only changes once the record behind it is complete.
+//
+// Every committed byte is counted per EEPROM_WEAR_BLOCK_SIZE bytes, to
+// show the wear rate.
+// =============================================================================
+
+#pragma once
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#include "target_profile.h"
+
+const uint8_t  EEPROM_LINE_SIZE       = 16;
+const uint8_t  EEPROM_CACHE_LINES     = TARGET_EEPROM_LINES;
+const uint16_t EEPROM_WEAR_BLOCK_SIZE = 64;
+const uint8_t  EEPROM_WEAR_BLOCKS     = TARGET_EEPROM_SIZE / EEPROM_WEAR_BLOCK_SIZE;
+
+struct EepromCacheStats {
+  unsigned long writes;     // bytes committed to the EEPROM
+  unsigned long coalesced;  // cached writes that never reached the EEPROM
+  unsigned int  evictions;  // lines committed synchronously to make room
+};
+
+class EepromCache {
+public:
+  explicit EepromCache(unsigned long quietMs) : quietMs(quietMs) {
+    for (uint8_t i = 0; i < EEPROM_CACHE_LINES; i++) lines[i].base = NO_LINE;
+  }
+
+  uint8_t read(int addr) const {
+    const Line* l = find(addr);
+    return l ? l->data[addr % EEPROM_LINE_SIZE] : EEPROM.read(addr);
+  }
+
+  void write(int addr, uint8_t value) { store(addr, value, false); }
+
+  // As write(), but committed only after every other pending byte.
+  void writeLast(int addr, uint8_t value) { store(addr, value, true); }
+
+  // Write straight through, for callers that pace themselves. Returns
+  // false (and writes nothing) while the EEPROM is still busy.
+  bool writeNow(int addr, uint8_t value) {
+    if (!eeprom_is_ready()) return false;
+    Line* l = find(addr);
+    if (l) {
+      l->data[addr % EEPROM_LINE_SIZE] = value;
+      l->dirty &= ~(1u << (addr % EEPROM_LINE_SIZE));
+      l->last &= l->dirty;
+      if (!l->dirty) l->order = 0;
+    }
+    if (EEPROM.read(addr) != value) physicalWrite(addr, value);
+    return true;
+  }
+
+  // Commit at most one byte. Call every loop pass.
+  void service() {
+    if (pending() == 0 || millis() - lastWrite < quietMs || !eeprom_is_ready()) return;
+    commitOne();
+  }
+
+  // Commit everything now (blocks ~3.3 ms per byte). For power-fail.
+  void flush() {
+    while (commitOne()) {}
+  }
+
+  // Dirty bytes not yet committed.
+  uint16_t pending() const {
+    uint16_t n = 0;
+    for (uint8_t i = 0; i < EEPROM_CACHE_LINES; i++) {
+      for (uint16_t d = lines[i].dirty; d; d &= d - 1) n++;
+    }
+    return n;
+  }
+
+  // True if any byte in [addr, addr + len) is still uncommitted.
+  bool pending(int addr, uint16_t len) const {
+    for (uint8_t i = 0; i < EEPROM_CACHE_LINES; i++) {
+      const Line& l = lines[i];
+      if (!l.dirty || l.base + EEPROM_LINE_SIZE <= addr || l.base >= addr + (int)len) continue;
+      for (uint8_t off = 0; off < EEPROM_LINE_SIZE; off++) {
+        int a = l.base + off;
+        if ((l.dirty & (1u << off)) && a >= addr && a < addr + (int)len) return true;
+      }
+    }
+    return false;
+  }
+
+  uint16_t wear(uint8_t block) const { return wearCount[block]; }
+  const EepromCacheStats& stats() const { return counters; }
+
+private:
+  static const int NO_LINE = -1;
+
+  struct Line {
+    int      base;      // first address, or NO_LINE
+    uint16_t dirty;     // one bit per byte that differs from the EEPROM
+    uint16_t last;      // dirty bytes written with writeLast()
+    uint16_t order;     // when the line was first dirtied, 0 if clean
+    uint8_t  data[EEPROM_LINE_SIZE];
+  };
+
+  const Line* find(int addr) const {
+    int base = addr - addr % EEPROM_LINE_SIZE;
+    for (uint8_t i = 0; i < EEPROM_CACHE_LINES; i++) {
+      if (lines[i].base == base) return &lines[i];
+    }
+    return nullptr;
+  }
+
+  Line* find(int addr) {
+    return const_cast<Line*>(static_cast<const EepromCache*>(this)->find(addr));
+  }
+
+  void store(int addr, uint8_t value, bool last) {
+    Line* l = find(addr);
+    if (!l) {
+      if (EEPROM.read(addr) == value) return;
+      l = allocate(addr);
+    }
+    uint8_t off = addr % EEPROM_LINE_SIZE;
+    uint16_t bit = 1u << off;
+    if (l->dirty & bit) counters.coalesced++; // overwrites a pending byte
+    l->data[off] = value;
+    if (value != EEPROM.read(addr)) l->dirty |= bit;
+    else l->dirty &= ~bit;
+    if (last) l->last |= bit;
+    else l->last &= ~bit;
+    l->last &= l->dirty;
+    if (l->dirty && l->order == 0) {
+      if (++nextOrder == 0) nextOrder = 1; // 0 means clean
+      l->order = nextOrder;
+    }
+    if (!l->dirty) l->order = 0;
+    lastWrite = millis();
+  }
+
+  // The oldest line with a byte to commit: writeLast() bytes only once no
+  // other byte is pending. Sets mask to the bytes that may go now.
+  Line* oldestDirty(uint16_t& mask) {
+    Line* oldest = nullptr;
+    for (uint8_t pass = 0; pass < 2 && !oldest; pass++) {
+      for (uint8_t i = 0; i < EEPROM_CACHE_LINES; i++) {
+        Line& l = lines[i];
+        uint16_t m = pass == 0 ? l.dirty & ~l.last : l.dirty;
+        if (m && (!oldest || (int16_t)(l.order - oldest->order) < 0)) {
+          oldest = &l;
+          mask = m;
+        }
+      }
+    }
+    return oldest;
+  }
+
+  Line* allocate(int addr) {
+    Line* slot = nullptr;
+    for (uint8_t i = 0; i < EEPROM_CACHE_LINES && !slot; i++) {
+      if (lines[i].base == NO_LINE) slot = &lines[i];
+    }
+    for (uint8_t i = 0; i < EEPROM_CACHE_LINES && !slot; i++) {
+      if (!lines[i].dirty) slot = &lines[i];
+    }
+    if (!slot) {
+      // Every line is dirty: commit the oldest one synchronously (its
+      // writeLast() bytes may first need the other lines committed)
+      uint16_t mask;
+      slot = oldestDirty(mask);
+      while (slot->dirty) commitOne();
+      counters.evictions++;
+    }
+    slot->base = addr - addr % EEPROM_LINE_SIZE;
+    slot->dirty = 0;
+    slot->last = 0;
+    slot->order = 0;
+    for (uint8_t i = 0; i < EEPROM_LINE_SIZE; i++) slot->data[i] = EEPROM.read(slot->base + i);
+    return slot;
+  }
+
+  bool commitOne() {
+    uint16_t mask = 0;
+    Line* l = oldestDirty(mask);
+    if (!l) return false;
+    uint8_t off = 0;
+    while (!(mask & (1u << off))) off++;
+    physicalWrite(l->base + off, l->data[off]);
+    l->dirty &= ~(1u << off);
+    l->last &= l->dirty;
+    if (!l->dirty) l->order = 0;
+    return true;
+  }
+
+  void physicalWrite(int addr, uint8_t value) {
+    EEPROM.write(addr, value);
+    counters.writes++;
+    uint8_t block = (addr / EEPROM_WEAR_BLOCK_SIZE) % EEPROM_WEAR_BLOCKS;
+    if (wearCount[block] < 0xFFFF) wearCount[block]++;
+  }
+
+  Line lines[EEPROM_CACHE_LINES];
+  unsigned long quietMs;
+  unsigned long lastWrite = 0;
+  uint16_t nextOrder = 0;
+  uint16_t wearCount[EEPROM_WEAR_BLOCKS] = {};
+  EepromCacheStats counters = {};
+};
@@ -0,0 +1,332 @@
+// =============================================================================
+// History — delta-compressed temperature/humidity trend in RAM
+// =============================================================================
+// Samples are quantized to fixed point (HISTORY_TEMP_STEP / HISTORY_HUMIDITY_
+// STEP tenths) and stored as 4-bit tokens in a ring of HISTORY_BYTES:
+//
+//   0x0-0x7       one sample; (dT, dH) in {-1,0,1}^2 minus (0,0)
+//   0x8-0xD       1..6 unchanged samples
+//   0xE n         7+n unchanged samples
+//   0xF v v       one sample; dT, dH as varints
+//
+// A run is always the newest token while it grows, so the next unchanged
+// sample bumps its count in place (0xD turns into 0xE 0); a flat stretch
+// of 22 samples costs 8 bits.
+//
+// A varint is zigzag-coded, 3 bits per nibble, low bits first, bit 3 set on
+// every nibble but the last. Every HISTORY_BLOCK_SAMPLES samples a block
+// starts with a keyframe (absolute T, H as varints) and no token, so any
+// sample can be decoded from the start of its block. When the ring is full
+// the oldest block is dropped.
+//
+// HistoryReader decodes a sample at a time, without a buffer.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "target_profile.h"
+
+const uint16_t HISTORY_BYTES         = TARGET_HISTORY_BYTES;
+const uint8_t  HISTORY_MAX_BLOCKS    = TARGET_HISTORY_BLOCKS;
+const uint8_t  HISTORY_BLOCK_SAMPLES = 96;   // 8 h at one sample per 5 min
+const int16_t  HISTORY_TEMP_STEP     = 1;    // 0.1 C
+const int16_t  HISTORY_HUMIDITY_STEP = 5;    // 0.5 %RH
+
+const uint8_t  HISTORY_SHORT_RUN = 0x8;  // + samples - 1
+const uint8_t  HISTORY_LONG_RUN  = 0xE;
+const uint8_t  HISTORY_ESCAPE    = 0xF;
+const uint8_t  HISTORY_SHORT_MAX = 6;
+const uint8_t  HISTORY_LONG_MIN  = 7;
+const uint16_t HISTORY_NO_RUN    = 0xFFFF;
+
+class HistoryLog {
+public:
+  HistoryLog() { clear(); }
+
+  void clear() {
+    memset(this, 0, sizeof(*this));
+    runPos = HISTORY_NO_RUN;
+  }
+
+  // Add one sample (values in tenths).
+  void append(int16_t temperature, int16_t humidity) {
+    int16_t t = quantize(temperature, HISTORY_TEMP_STEP);
+    int16_t h = quantize(humidity, HISTORY_HUMIDITY_STEP);
+    appended++;
+
+    if (blockCount == 0 || closed || blockLen[lastBlock()] >= HISTORY_BLOCK_SAMPLES) {
+      startBlock(t, h);
+      return;
+    }
+
+    int16_t dt = t - lastT;
+    int16_t dh = h - lastH;
+    if (dt == 0 && dh == 0 && extendRun()) {
+      blockLen[lastBlock()]++;
+      return;
+    }
+
+    uint8_t token[9];
+    uint8_t n = 0;
+    if (dt == 0 && dh == 0) {
+      token[n++] = HISTORY_SHORT_RUN;
+    } else if (dt >= -1 && dt <= 1 && dh >= -1 && dh <= 1) {
+      uint8_t combo = (dt + 1) * 3 + (dh + 1);
+      token[n++] = combo < 4 ? combo : combo - 1; // (0,0) has no code
+    } else {
+      token[n++] = HISTORY_ESCAPE;
+      n += varint(dt, token + n);
+      n += varint(dh, token + n);
+    }
+
+    // Make room by dropping old blocks; if the current block alone fills
+    // the ring, start over with a keyframe
+    while (free() < n && blockCount > 1) dropOldest();
+    if (free() < n) {
+      startBlock(t, h);
+      return;
+    }
+
+    for (uint8_t i = 0; i < n; i++) put(token[i]);
+    runPos = (token[0] == HISTORY_SHORT_RUN) ? prev(head) : HISTORY_NO_RUN;
+    runLong = false;
+    lastT = t;
+    lastH = h;
+    blockLen[lastBlock()]++;
+  }
+
+  // The next sample starts a new block (e.g. after a gap in sampling).
+  void breakBlock() { closed = true; }
+
+  uint16_t samples() const {
+    uint16_t n = 0;
+    for (uint8_t i = 0; i < blockCount; i++) n += blockLen[(firstBlock + i) % HISTORY_MAX_BLOCKS];
+    return n;
+  }
+
+  uint16_t bytesUsed() const { return (used + 1) / 2; }
+
+  // Samples appended since clear(); changes with every append.
+  uint16_t appendCount() const { return appended; }
+
+  // Raw state (sizeof(HistoryLog) bytes), for checkpointing to EEPROM.
+  uint8_t* data() { return reinterpret_cast<uint8_t*>(this); }
+
+  // Sanity check after loading raw state.
+  bool consistent() const {
+    if (blockCount > HISTORY_MAX_BLOCKS || firstBlock >= HISTORY_MAX_BLOCKS) return false;
+    if (head >= 2 * HISTORY_BYTES || used > 2 * HISTORY_BYTES) return false;
+    for (uint8_t i = 0; i < blockCount; i++) {
+      uint8_t b = (firstBlock + i) % HISTORY_MAX_BLOCKS;
+      if (blockStart[b] >= 2 * HISTORY_BYTES || blockLen[b] == 0 ||
+          blockLen[b] > HISTORY_BLOCK_SAMPLES) return false;
+    }
+    return runPos == HISTORY_NO_RUN || runPos < 2 * HISTORY_BYTES;
+  }
+
+private:
+  friend class HistoryReader;
+
+  static int16_t quantize(int16_t v, int16_t step) {
+    return (v >= 0 ? v + step / 2 : v - step / 2) / step;
+  }
+
+  static uint16_t zigzag(int16_t v) { return ((uint16_t)v << 1) ^ (uint16_t)(v >> 15); }
+
+  static uint8_t varint(int16_t v, uint8_t* out) {
+    uint16_t z = zigzag(v);
+    uint8_t n = 0;
+    do {
+      uint8_t bits = z & 0x7;
+      z >>= 3;
+      out[n++] = z ? (bits | 0x8) : bits;
+    } while (z);
+    return n;
+  }
+
+  uint8_t nibble(uint16_t pos) const {
+    uint8_t b = ring[pos >> 1];
+    return (pos & 1) ? (b & 0xF) : (b >> 4);
+  }
+
+  void setNibble(uint16_t pos, uint8_t v) {
+    uint8_t& b = ring[pos >> 1];
+    b = (pos & 1) ? ((b & 0xF0) | v) : ((b & 0x0F) | (v << 4));
+  }
+
+  static uint16_t next(uint16_t pos) { return pos + 1 < 2 * HISTORY_BYTES ? pos + 1 : 0; }
+  static uint16_t prev(uint16_t pos) { return pos ? pos - 1 : 2 * HISTORY_BYTES - 1; }
+
+  uint16_t free() const { return 2 * HISTORY_BYTES - used; }
+
+  // Count one more unchanged sample in the open run; false if there is
+  // none or it is full.
+  bool extendRun() {
+    if (runPos == HISTORY_NO_RUN) return false;
+    uint8_t v = nibble(runPos);
+    if (runLong) {
+      if (v == 0xF) return false;
+      setNibble(runPos, v + 1);
+      return true;
+    }
+    if (v < HISTORY_SHORT_RUN + HISTORY_SHORT_MAX - 1) {
+      setNibble(runPos, v + 1);
+      return true;
+    }
+    // Short run is full: widen it to the long form (it is the newest token)
+    while (free() < 1 && blockCount > 1) dropOldest();
+    if (free() < 1) return false;
+    setNibble(runPos, HISTORY_LONG_RUN);
+    put(0);
+    runPos = prev(head);
+    runLong = true;
+    return true;
+  }
+  uint8_t lastBlock() const { return (firstBlock + blockCount - 1) % HISTORY_MAX_BLOCKS; }
+
+  void put(uint8_t v) {
+    setNibble(head, v);
+    head = next(head);
+    used++;
+  }
+
+  void dropOldest() {
+    uint8_t second = (firstBlock + 1) % HISTORY_MAX_BLOCKS;
+    uint16_t tail = (head + 2 * HISTORY_BYTES - used) % (2 * HISTORY_BYTES);
+    used -= (blockStart[second] + 2 * HISTORY_BYTES - tail) % (2 * HISTORY_BYTES);
+    firstBlock = second;
+    blockCount--;
+  }
+
+  void startBlock(int16_t t, int16_t h) {
+    uint8_t key[8];
+    uint8_t n = varint(t, key);
+    n += varint(h, key + n);
+    if (blockCount == HISTORY_MAX_BLOCKS) dropOldest();
+    while (free() < n && blockCount > 0) {
+      if (blockCount == 1) { used = 0; blockCount = 0; }
+      else dropOldest();
+    }
+    uint8_t b = (firstBlock + blockCount) % HISTORY_MAX_BLOCKS;
+    blockCount++;
+    blockStart[b] = head;
+    blockLen[b] = 1;
+    for (uint8_t i = 0; i < n; i++) put(key[i]);
+    runPos = HISTORY_NO_RUN;
+    runLong = false;
+    closed = false;
+    lastT = t;
+    lastH = h;
+  }
+
+  uint8_t  ring[HISTORY_BYTES];
+  uint16_t blockStart[HISTORY_MAX_BLOCKS]; // nibble position of each keyframe
+  uint8_t  blockLen[HISTORY_MAX_BLOCKS];   // samples in each block
+  uint8_t  firstBlock;
+  uint8_t  blockCount;
+  uint16_t head;      // next nibble to write
+  uint16_t used;      // nibbles in use
+  uint16_t runPos;    // count nibble of an open zero run, or HISTORY_NO_RUN
+  bool     runLong;   // runPos is the count of a 0xE token
+  bool     closed;    // breakBlock(): the next sample starts a new block
+  int16_t  lastT;     // last sample, quantized
+  int16_t  lastH;
+  uint16_t appended;
+};
+
+// Decodes samples oldest first, starting at any index.
+class HistoryReader {
+public:
+  explicit HistoryReader(const HistoryLog& log, uint16_t index = 0) : log(log) {
+    seek(index);
+  }
+
+  // Restart at sample `index` (0 = oldest).
+  void seek(uint16_t index) {
+    block = 0;
+    remaining = 0;
+    // Find the block holding `index`, then decode up to it
+    while (block < log.blockCount) {
+      uint8_t len = log.blockLen[(log.firstBlock + block) % HISTORY_MAX_BLOCKS];
+      if (index < len) break;
+      index -= len;
+      block++;
+    }
+    startBlock();
+    int16_t t, h;
+    while (index-- > 0 && next(t, h)) {}
+  }
+
+  // Next sample in tenths; false at the end.
+  bool next(int16_t& temperature, int16_t& humidity) {
+    if (remaining == 0) {
+      block++;
+      if (!startBlock()) return false;
+    }
+    if (first) {
+      first = false; // the keyframe is the block's first sample
+    } else if (zeros > 0) {
+      zeros--;
+    } else {
+      uint8_t token = read();
+      if (token == HISTORY_LONG_RUN) {
+        zeros = HISTORY_LONG_MIN - 1 + read();
+      } else if (token >= HISTORY_SHORT_RUN && token != HISTORY_ESCAPE) {
+        zeros = token - HISTORY_SHORT_RUN;
+      } else if (token == HISTORY_ESCAPE) {
+        t += readVarint();
+        h += readVarint();
+      } else {
+        uint8_t combo = token < 4 ? token : token + 1;
+        t += combo / 3 - 1;
+        h += combo % 3 - 1;
+      }
+    }
+    remaining--;
+    temperature = t * HISTORY_TEMP_STEP;
+    humidity = h * HISTORY_HUMIDITY_STEP;
+    return true;
+  }
+
+private:
+  bool startBlock() {
+    if (block >= log.blockCount) return false;
+    uint8_t b = (log.firstBlock + block) % HISTORY_MAX_BLOCKS;
+    pos = log.blockStart[b];
+    remaining = log.blockLen[b];
+    zeros = 0;
+    t = readVarint();
+    h = readVarint();
+    first = true;
+    return true;
+  }
+
+  uint8_t read() {
+    uint8_t v = log.nibble(pos);
+    pos = HistoryLog::next(pos);
+    return v;
+  }
+
+  int16_t readVarint() {
+    uint16_t z = 0;
+    uint8_t shift = 0;
+    uint8_t v;
+    do {
+      v = read();
+      z |= (uint16_t)(v & 0x7) << shift;
+      shift += 3;
+    } while ((v & 0x8) && shift < 18);
+    return (int16_t)((z >> 1) ^ -(int16_t)(z & 1));
+  }
+
+  const HistoryLog& log;
+  uint16_t pos;
+  uint8_t  block;     // index from the oldest block
+  uint8_t  remaining; // samples left in the block
+  uint8_t  zeros;     // unchanged samples left in the current run
+  bool     first;
+  int16_t  t, h;      // quantized
+};
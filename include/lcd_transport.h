@@ -0,0 +1,56 @@
+// =============================================================================
+// Coalesced LCD transport
+// =============================================================================
+// rgb_lcd sends every character as its own I2C transaction (start, address,
+// 0x40, character, stop). CoalescedLcd overrides the buffer write behind
+// print(const char*), so a string goes out as one transaction: address,
+// control byte 0x40 (Co = 0, RS = 1: every following byte is data), then up
+// to LCD_DATA_MAX characters, limited by the Wire buffer.
+//
+// The core's print(const __FlashStringHelper*) writes one character at a
+// time, so flash strings are copied through a row-sized RAM buffer first.
+// =============================================================================
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include "rgb_lcd.h"
+
+const uint8_t LCD_CONTROL_DATA = 0x40;
+const uint8_t LCD_DATA_MAX     = BUFFER_LENGTH - 1;
+
+class CoalescedLcd : public rgb_lcd {
+public:
+  using rgb_lcd::write;
+  using rgb_lcd::print;
+
+  size_t write(const uint8_t* buffer, size_t size) override {
+    size_t sent = 0;
+    while (sent < size) {
+      uint8_t chunk = (size - sent > LCD_DATA_MAX) ? LCD_DATA_MAX : size - sent;
+      Wire.beginTransmission(LCD_ADDRESS);
+      Wire.write(LCD_CONTROL_DATA);
+      Wire.write(buffer + sent, chunk);
+      if (Wire.endTransmission() != 0) break;
+      sent += chunk;
+    }
+    return sent;
+  }
+
+  size_t print(const __FlashStringHelper* s) {
+    PGM_P p = reinterpret_cast<PGM_P>(s);
+    char row[17];
+    size_t n = 0;
+    for (;;) {
+      strncpy_P(row, p, sizeof(row) - 1);
+      row[sizeof(row) - 1] = '\0';
+      size_t len = strlen(row);
+      if (len == 0) break;
+      n += write(reinterpret_cast<const uint8_t*>(row), len);
+      p += len;
+    }
+    return n;
+  }
+};
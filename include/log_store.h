@@ -0,0 +1,281 @@
+// =============================================================================
+// Log Store — append-only record log on NOR flash
+// =============================================================================
+// Records are collected in RAM a page at a time and written out as whole
+// log pages, so a flash program happens once per LOG_RECORDS_PER_PAGE
+// records (or on flush()). With BufferPages > 1, further pages fill while
+// sealed ones wait for the flash, so fewer records are dropped while it is
+// busy erasing. The flash is used as a ring of 4 KB sectors: the
+// sector ahead of the write position is erased in advance, which wears all
+// sectors evenly and means an append never has to wait for an erase.
+//
+// Log page (LOG_PAGE_SIZE bytes, aligned inside a 256-byte NOR page):
+//   magic | count | seq u32 | CRC-16 u16 | count x record
+//   (CRC over the first 6 header bytes and the records; unused tail stays
+//    erased. seq increases by one per page, across wrap-around.)
+// Record (LOG_RECORD_SIZE bytes, little-endian):
+//   time u32 (s since boot) | type u8 | data 3 bytes
+//
+// Nothing in here blocks on the flash: append() only touches RAM and
+// service() starts at most one erase or program, and only when the chip is
+// idle. The Flash type provides:
+//   uint32_t size();  bool busy();
+//   void read(uint32_t addr, uint8_t* buf, uint16_t len);
+//   void program(uint32_t addr, const uint8_t* buf, uint16_t len); // starts
+//   void eraseSector(uint32_t addr);                                // starts
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "crc16.h"
+
+const uint16_t LOG_PAGE_SIZE        = 64;
+const uint16_t LOG_SECTOR_SIZE      = 4096;
+const uint8_t  LOG_HEADER_SIZE      = 8;
+const uint8_t  LOG_RECORD_SIZE      = 8;
+const uint8_t  LOG_RECORDS_PER_PAGE = (LOG_PAGE_SIZE - LOG_HEADER_SIZE) / LOG_RECORD_SIZE;
+const uint8_t  LOG_PAGES_PER_SECTOR = LOG_SECTOR_SIZE / LOG_PAGE_SIZE;
+const uint8_t  LOG_PAGE_MAGIC       = 0xA5;
+
+enum LogType : uint8_t {
+  LOG_BOOT     = 1, // value: unused
+  LOG_SENSOR   = 2, // a: temperature, b: humidity (0.1 units)
+  LOG_PUMP_ON  = 3, // value: planned run time (s), | LOG_PUMP_BY_FLOAT
+  LOG_PUMP_OFF = 4, // value: actual run time (s)
+  LOG_SYNC     = 5, // value: RS-485 site time (s, 24 bits) at this record's time
+  LOG_ALARM    = 6, // a: AlarmId + 1, negated when it clears, b: value (0.1 units)
+  LOG_DENIED   = 7, // value: why a pump start was denied (DutyVerdict: 1 rest, 2 budget)
+  LOG_FLOAT    = 8, // value: 1 float switch taken as stuck, 2 as silent, 0 working again
+};
+
+const uint32_t LOG_PUMP_BY_FLOAT = 1UL << 23; // LOG_PUMP_ON: started by the float switch
+
+struct LogRecord {
+  uint32_t time;
+  uint8_t  type;
+  uint8_t  data[3];
+
+  // One 24-bit unsigned value
+  static LogRecord value(uint32_t time, uint8_t type, uint32_t v) {
+    LogRecord r = { time, type, { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16) } };
+    return r;
+  }
+  // Two 12-bit signed values (-2048..2047)
+  static LogRecord pair(uint32_t time, uint8_t type, int16_t a, int16_t b) {
+    return value(time, type, ((uint32_t)(b & 0xFFF) << 12) | (a & 0xFFF));
+  }
+
+  uint32_t value() const { return data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16); }
+  int16_t a() const { return (int16_t)((value() & 0xFFF) << 4) >> 4; }
+  int16_t b() const { return (int16_t)(((value() >> 12) & 0xFFF) << 4) >> 4; }
+};
+
+struct LogStats {
+  unsigned long pagesWritten;
+  unsigned long sectorsErased;
+  unsigned long recordsDropped; // buffer full while the flash was busy
+};
+
+template <typename Flash, uint8_t BufferPages = 1>
+class LogStore {
+public:
+  explicit LogStore(Flash& flash) : flash(flash) {}
+
+  // Find the newest valid page and continue after it. Reads one page per
+  // sector plus the pages of the newest sector; call once, at boot.
+  void begin() {
+    pageCount = flash.size() / LOG_PAGE_SIZE;
+    sectorCount = flash.size() / LOG_SECTOR_SIZE;
+    if (sectorCount < 2) {
+      pageCount = 0; // need one sector to write and one to erase ahead
+      return;
+    }
+
+    uint8_t* buf = bufs[0]; // scratch until the first append
+    bool found = false;
+    uint16_t newestSector = 0;
+    uint32_t newestSeq = 0;
+    for (uint16_t s = 0; s < sectorCount; s++) {
+      uint32_t pageSeq;
+      if (readValidPage((uint32_t)s * LOG_PAGES_PER_SECTOR, buf, pageSeq) &&
+          (!found || (int32_t)(pageSeq - newestSeq) > 0)) {
+        found = true;
+        newestSector = s;
+        newestSeq = pageSeq;
+      }
+    }
+
+    if (!found) {
+      head = 0;
+      seq = 0;
+    } else {
+      // Walk the newest sector to its last page in sequence
+      uint32_t page = (uint32_t)newestSector * LOG_PAGES_PER_SECTOR;
+      uint32_t last = page;
+      for (uint8_t i = 1; i < LOG_PAGES_PER_SECTOR; i++) {
+        uint32_t pageSeq;
+        if (!readValidPage(page + i, buf, pageSeq) || pageSeq != newestSeq + 1) break;
+        last = page + i;
+        newestSeq = pageSeq;
+      }
+      head = (last + 1) % pageCount;
+      seq = newestSeq + 1;
+      // Skip pages a power cut left half-programmed (and any written after
+      // them); seq still counts them so page and seq stay in step
+      while (head % LOG_PAGES_PER_SECTOR != 0 && !pageBlank(head)) {
+        head = (head + 1) % pageCount;
+        seq++;
+      }
+    }
+
+    // A sector is only written after it has been erased in this session
+    eraseCount = 0;
+    if (head % LOG_PAGES_PER_SECTOR == 0) queueErase(sectorOf(head));
+    queueErase((sectorOf(head) + 1) % sectorCount);
+    count = 0;
+    firstSealed = 0;
+    sealedPages = 0;
+  }
+
+  bool ready() const { return pageCount != 0; }
+
+  // Queue a record. Only touches RAM; false if it had to be dropped.
+  bool append(const LogRecord& r) {
+    if (!pageCount) return false;
+    if (sealedPages == BufferPages) {
+      counters.recordsDropped++;
+      return false;
+    }
+    uint8_t* p = bufs[fillPage()] + LOG_HEADER_SIZE + count * LOG_RECORD_SIZE;
+    p[0] = r.time; p[1] = r.time >> 8; p[2] = r.time >> 16; p[3] = r.time >> 24;
+    p[4] = r.type;
+    memcpy(p + 5, r.data, 3);
+    if (++count == LOG_RECORDS_PER_PAGE) seal();
+    return true;
+  }
+
+  // Write out a partly filled page at the next opportunity.
+  void flush() {
+    if (pageCount && count > 0 && sealedPages < BufferPages) seal();
+  }
+
+  // Start the next erase or page program if the flash is idle.
+  // Call every loop pass.
+  void service() {
+    if (!pageCount || (eraseCount == 0 && sealedPages == 0)) return;
+    if (flash.busy()) return;
+
+    if (eraseCount > 0) {
+      flash.eraseSector((uint32_t)eraseQueue[0] * LOG_SECTOR_SIZE);
+      eraseQueue[0] = eraseQueue[1];
+      eraseCount--;
+      counters.sectorsErased++;
+      return;
+    }
+
+    const uint8_t* buf = bufs[firstSealed];
+    flash.program(head * LOG_PAGE_SIZE, buf, LOG_HEADER_SIZE + buf[1] * LOG_RECORD_SIZE);
+    counters.pagesWritten++;
+    firstSealed = (firstSealed + 1) % BufferPages;
+    sealedPages--;
+    seq++;
+    head = (head + 1) % pageCount;
+    // Entered a fresh sector: erase the one after it (the oldest data)
+    if (head % LOG_PAGES_PER_SECTOR == 0) queueErase((sectorOf(head) + 1) % sectorCount);
+  }
+
+  // Read the page written `back` pages before the newest one (0 = newest).
+  // Returns its record count; 0 for a skipped page or one past the oldest
+  // still on flash.
+  uint8_t readPage(uint32_t back, uint8_t* page) {
+    if (!pageCount || back >= seq || back >= pageCount) return 0;
+    uint32_t index = (head + pageCount - 1 - back % pageCount) % pageCount;
+    uint32_t pageSeq;
+    if (!readValidPage(index, page, pageSeq) || pageSeq != seq - 1 - back) return 0;
+    return page[1];
+  }
+
+  static LogRecord record(const uint8_t* page, uint8_t i) {
+    const uint8_t* p = page + LOG_HEADER_SIZE + i * LOG_RECORD_SIZE;
+    LogRecord r;
+    r.time = p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    r.type = p[4];
+    memcpy(r.data, p + 5, 3);
+    return r;
+  }
+
+  uint32_t headPage() const { return head; }
+  uint32_t nextSeq() const { return seq; }
+  // Pages readPage() can reach: those written, up to the size of the ring
+  uint32_t storedPages() const { return seq < pageCount ? seq : pageCount; }
+  // Records not on the flash yet
+  uint8_t pending() const {
+    uint8_t n = count;
+    for (uint8_t i = 0; i < sealedPages; i++) n += bufs[(firstSealed + i) % BufferPages][1];
+    return n;
+  }
+  const LogStats& stats() const { return counters; }
+
+private:
+  uint16_t sectorOf(uint32_t page) const { return page / LOG_PAGES_PER_SECTOR; }
+
+  void queueErase(uint16_t sector) {
+    if (eraseCount < 2) eraseQueue[eraseCount++] = sector;
+  }
+
+  static uint16_t pageCrc(const uint8_t* page, uint8_t records) {
+    uint16_t crc = crc16(page, 6);
+    return crc16(page + LOG_HEADER_SIZE, records * LOG_RECORD_SIZE, crc);
+  }
+
+  uint8_t fillPage() const { return (firstSealed + sealedPages) % BufferPages; }
+
+  void seal() {
+    uint8_t* buf = bufs[fillPage()];
+    uint32_t pageSeq = seq + sealedPages;
+    buf[0] = LOG_PAGE_MAGIC;
+    buf[1] = count;
+    buf[2] = pageSeq; buf[3] = pageSeq >> 8; buf[4] = pageSeq >> 16; buf[5] = pageSeq >> 24;
+    uint16_t crc = pageCrc(buf, count);
+    buf[6] = crc & 0xFF;
+    buf[7] = crc >> 8;
+    sealedPages++;
+    count = 0;
+  }
+
+  bool readValidPage(uint32_t index, uint8_t* page, uint32_t& pageSeq) {
+    flash.read(index * LOG_PAGE_SIZE, page, LOG_PAGE_SIZE);
+    uint8_t n = page[1];
+    if (page[0] != LOG_PAGE_MAGIC || n == 0 || n > LOG_RECORDS_PER_PAGE) return false;
+    if ((page[6] | (page[7] << 8)) != pageCrc(page, n)) return false;
+    pageSeq = page[2] | ((uint32_t)page[3] << 8) | ((uint32_t)page[4] << 16) | ((uint32_t)page[5] << 24);
+    return true;
+  }
+
+  bool pageBlank(uint32_t index) {
+    uint8_t chunk[LOG_HEADER_SIZE];
+    for (uint16_t off = 0; off < LOG_PAGE_SIZE; off += sizeof(chunk)) {
+      flash.read(index * LOG_PAGE_SIZE + off, chunk, sizeof(chunk));
+      for (uint8_t i = 0; i < sizeof(chunk); i++) {
+        if (chunk[i] != 0xFF) return false;
+      }
+    }
+    return true;
+  }
+
+  Flash&   flash;
+  uint32_t pageCount = 0;   // 0 = no usable flash
+  uint16_t sectorCount = 0;
+  uint32_t head = 0;        // next page to program
+  uint32_t seq = 0;         // sequence number of that page
+  uint16_t eraseQueue[2];
+  uint8_t  eraseCount = 0;
+  uint8_t  bufs[BufferPages][LOG_PAGE_SIZE];
+  uint8_t  count = 0;       // records in the page being filled
+  uint8_t  firstSealed = 0; // oldest page waiting to be programmed
+  uint8_t  sealedPages = 0; // complete pages waiting; the next one fills
+  LogStats counters = {};
+};
@@ -0,0 +1,102 @@
+// =============================================================================
+// Metrics
+// =============================================================================
+// Counters, gauges and histograms declared in one list, like the string
+// pool. All values live in one contiguous block (metricSlots); a metric's ID
+// is its slot number, so updating a counter is a single increment:
+//
+//   metricAdd(MET_SENSOR_READS);            // counter
+//   metricSet(MET_RAM_FREE, bytes);         // gauge
+//   metricObserve(MET_LOOP_TIME, micros);   // histogram
+//
+// A histogram takes METRIC_BUCKETS slots: counts of values below 8, 64, 512,
+// 4096, 32768 and the rest. Names and units stay in flash (METRIC_INFO);
+// tools/check_strings.py treats this file as part of the string pool.
+// =============================================================================
+
+#pragma once
+
+#include <Arduino.h>
+
+// COUNTER(id, name, unit) GAUGE(id, name, unit) HISTOGRAM(id, name, unit)
+#define METRICS(COUNTER, GAUGE, HISTOGRAM) \
+  COUNTER(MET_LOOP_PASSES,    "loop.passes",   "") \
+  COUNTER(MET_SENSOR_READS,   "sensor.reads",  "") \
+  COUNTER(MET_SENSOR_ERRORS,  "sensor.errors", "") \
+  COUNTER(MET_PROBE_MISSES,   "i2c.misses",    "") \
+  COUNTER(MET_COMMAND_ERRORS, "cmd.errors",    "") \
+  COUNTER(MET_EEPROM_WRITES,  "eeprom.writes", "B") \
+  COUNTER(MET_LOG_DROPPED,    "log.dropped",   "rec") \
+  COUNTER(MET_PUMP_DENIED,    "pump.denied",   "") \
+  COUNTER(MET_ALARMS_RAISED,  "alarm.raised",  "") \
+  GAUGE(MET_ALARMS_LATCHED,   "alarm.latched", "") \
+  GAUGE(MET_EEPROM_PENDING,   "eeprom.pending", "B") \
+  GAUGE(MET_RAM_FREE,         "ram.free",      "B") \
+  HISTOGRAM(MET_LOOP_TIME,    "loop.time",     "us") \
+  HISTOGRAM(MET_RELAY_LATE,   "relay.late",    "ms")
+
+const uint8_t METRIC_BUCKETS = 6;
+
+enum MetricKind : uint8_t { METRIC_COUNTER, METRIC_GAUGE, METRIC_HISTOGRAM };
+
+// Slot numbers; a histogram also owns the METRIC_BUCKETS - 1 slots after it
+enum MetricSlot : uint8_t {
+#define METRIC_SLOT_ONE(id, name, unit) id,
+#define METRIC_SLOT_HISTOGRAM(id, name, unit) id, id##_LAST = id + METRIC_BUCKETS - 1,
+  METRICS(METRIC_SLOT_ONE, METRIC_SLOT_ONE, METRIC_SLOT_HISTOGRAM)
+#undef METRIC_SLOT_ONE
+#undef METRIC_SLOT_HISTOGRAM
+  METRIC_SLOTS
+};
+
+#define METRIC_COUNT_ONE(id, name, unit) + 1
+#define METRIC_COUNT_NONE(id, name, unit)
+const uint8_t METRIC_COUNT = 0 METRICS(METRIC_COUNT_ONE, METRIC_COUNT_ONE, METRIC_COUNT_ONE);
+const uint8_t METRIC_GAUGE_COUNT = 0 METRICS(METRIC_COUNT_NONE, METRIC_COUNT_ONE, METRIC_COUNT_NONE);
+#undef METRIC_COUNT_ONE
+#undef METRIC_COUNT_NONE
+
+struct MetricInfo {
+  const char* name;  // flash
+  const char* unit;  // flash, "" if none
+  uint8_t     kind;
+  uint8_t     slot;
+};
+
+namespace metric_names {
+#define METRIC_TEXT(id, name, unit) \
+  const char id##_NAME[] PROGMEM = name; \
+  const char id##_UNIT[] PROGMEM = unit;
+  METRICS(METRIC_TEXT, METRIC_TEXT, METRIC_TEXT)
+#undef METRIC_TEXT
+} // namespace metric_names
+
+const MetricInfo METRIC_INFO[METRIC_COUNT] PROGMEM = {
+#define METRIC_ENTRY_COUNTER(id, name, unit)   { metric_names::id##_NAME, metric_names::id##_UNIT, METRIC_COUNTER, id },
+#define METRIC_ENTRY_GAUGE(id, name, unit)     { metric_names::id##_NAME, metric_names::id##_UNIT, METRIC_GAUGE, id },
+#define METRIC_ENTRY_HISTOGRAM(id, name, unit) { metric_names::id##_NAME, metric_names::id##_UNIT, METRIC_HISTOGRAM, id },
+  METRICS(METRIC_ENTRY_COUNTER, METRIC_ENTRY_GAUGE, METRIC_ENTRY_HISTOGRAM)
+#undef METRIC_ENTRY_COUNTER
+#undef METRIC_ENTRY_GAUGE
+#undef METRIC_ENTRY_HISTOGRAM
+};
+
+extern uint32_t metricSlots[METRIC_SLOTS];
+
+inline void metricAdd(MetricSlot id, uint32_t n = 1) { metricSlots[id] += n; }
+inline void metricSet(MetricSlot id, uint32_t value) { metricSlots[id] = value; }
+
+// Upper bound (exclusive) of histogram bucket b; the last one has none.
+inline uint32_t metricBucketLimit(uint8_t b) { return 8UL << (3 * b); }
+
+inline void metricObserve(MetricSlot id, uint32_t value) {
+  uint8_t b = 0;
+  while (b < METRIC_BUCKETS - 1 && value >= metricBucketLimit(b)) b++;
+  metricSlots[id + b]++;
+}
+
+inline MetricInfo metricInfo(uint8_t index) {
+  MetricInfo info;
+  memcpy_P(&info, &METRIC_INFO[index], sizeof(info));
+  return info;
+}
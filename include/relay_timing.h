@@ -0,0 +1,26 @@
+// =============================================================================
+// Relay timing — how late the pump relay switches
+// =============================================================================
+// The loop only notices that a switch is due on its next pass, so a slow
+// pass (a sensor read, a hung I2C transaction) delays the relay. updatePump()
+// records how long after its due time each switch happened; the "relay"
+// serial command and the host simulator's end-of-run report print it.
+// =============================================================================
+
+#pragma once
+
+struct RelayTiming {
+  unsigned long switches;
+  unsigned long lateTotal; // ms
+  unsigned long lateMax;   // ms
+
+  void record(unsigned long late) {
+    switches++;
+    lateTotal += late;
+    if (late > lateMax) lateMax = late;
+  }
+
+  unsigned long lateMean() const { return switches ? lateTotal / switches : 0; }
+};
+
+extern RelayTiming relayTiming;
@@ -0,0 +1,196 @@
+// =============================================================================
+// Rule VM
+// =============================================================================
+// A tiny stack machine that decides, at each scheduled pump start, whether
+// to run, skip, or run for a different duration. Rules are compiled on the
+// host by tools/rulec.py and stored in EEPROM.
+//
+// Bounded by construction: jumps may only go forward, so every instruction
+// executes at most once and a program of at most RULE_MAX_CODE bytes runs
+// in at most RULE_MAX_CODE steps. All arithmetic is int16_t; overflow wraps
+// (-32768 / -1 is -32768) and division by zero yields 0.
+//
+// Encoding (operands little-endian):
+//   PUSH8 i8 | PUSH16 i16 | LOAD var
+//   ADD SUB MUL DIV NEG       (pop b, pop a, push a op b)
+//   LT LE GT GE EQ NE AND OR NOT
+//   JZ off | JMP off          (off counted from the next instruction)
+//   RUN | SKIP | RUN_FOR      (RUN_FOR pops the run time in seconds)
+// Falling off the end of the program means RUN.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+const uint8_t RULE_MAX_CODE  = 64;
+const uint8_t RULE_MAX_STACK = 8;
+
+enum RuleOp : uint8_t {
+  OP_PUSH8   = 0x01,
+  OP_PUSH16  = 0x02,
+  OP_LOAD    = 0x03,
+  OP_ADD     = 0x10,
+  OP_SUB     = 0x11,
+  OP_MUL     = 0x12,
+  OP_DIV     = 0x13,
+  OP_NEG     = 0x14,
+  OP_LT      = 0x20,
+  OP_LE      = 0x21,
+  OP_GT      = 0x22,
+  OP_GE      = 0x23,
+  OP_EQ      = 0x24,
+  OP_NE      = 0x25,
+  OP_AND     = 0x26,
+  OP_OR      = 0x27,
+  OP_NOT     = 0x28,
+  OP_JZ      = 0x30,
+  OP_JMP     = 0x31,
+  OP_RUN     = 0x40,
+  OP_SKIP    = 0x41,
+  OP_RUN_FOR = 0x42,
+};
+
+// Inputs visible to LOAD
+enum RuleVar : uint8_t {
+  VAR_TEMPERATURE,    // 0.1 C
+  VAR_HUMIDITY,       // 0.1 %RH
+  VAR_MINUTE_OF_DAY,  // 0..1439, -1 while the clock is not set
+  VAR_UPTIME_HOURS,
+  VAR_RUN_COUNT,      // pump runs since boot (saturating)
+  VAR_SKIP_COUNT,     // consecutive skipped cycles
+  VAR_PRESET,         // 1-based, as on the LCD
+  VAR_ON_SECONDS,     // preset run time
+  VAR_CYCLE_MINUTES,  // preset cycle interval
+  RULE_VAR_COUNT
+};
+
+enum RuleDecision : uint8_t {
+  RULE_RUN,
+  RULE_SKIP,
+  RULE_ERROR,  // malformed program or stack fault — caller runs as scheduled
+};
+
+struct RuleResult {
+  RuleDecision decision;
+  uint16_t     runSeconds;  // 0 = preset duration
+};
+
+// Truncate to int16_t, wrapping. Results are computed in int32_t first: on
+// AVR int is 16 bits, so int16_t arithmetic that overflows would be
+// undefined rather than wrap.
+inline int16_t ruleWrap(int32_t v) {
+  return (int16_t)(uint16_t)v;
+}
+
+// Operand bytes following each opcode; -1 for an unknown opcode.
+inline int8_t ruleOperandSize(uint8_t op) {
+  switch (op) {
+    case OP_PUSH8: case OP_LOAD: case OP_JZ: case OP_JMP: return 1;
+    case OP_PUSH16: return 2;
+    case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_NEG:
+    case OP_LT: case OP_LE: case OP_GT: case OP_GE: case OP_EQ: case OP_NE:
+    case OP_AND: case OP_OR: case OP_NOT:
+    case OP_RUN: case OP_SKIP: case OP_RUN_FOR: return 0;
+    default: return -1;
+  }
+}
+
+// Check a program once, at load time: known opcodes, complete operands,
+// valid variables, and jump targets that are the start of an instruction
+// or the end of the program (never the middle of an operand).
+template <typename Fetch>
+bool ruleVerify(Fetch fetch, uint8_t len) {
+  if (len > RULE_MAX_CODE) return false;
+  uint8_t starts[RULE_MAX_CODE / 8 + 1] = {};   // bit per pc; len counts as one
+  uint8_t targets[RULE_MAX_CODE / 8 + 1] = {};
+  uint8_t pc = 0;
+  while (pc < len) {
+    starts[pc / 8] |= 1 << (pc % 8);
+    uint8_t op = fetch(pc);
+    int8_t operands = ruleOperandSize(op);
+    if (operands < 0 || pc + 1 + operands > len) return false;
+    uint8_t next = pc + 1 + operands;
+    if (op == OP_LOAD && fetch(pc + 1) >= RULE_VAR_COUNT) return false;
+    if (op == OP_JZ || op == OP_JMP) {
+      uint16_t target = next + fetch(pc + 1);
+      if (target > len) return false;
+      targets[target / 8] |= 1 << (target % 8);
+    }
+    pc = next;
+  }
+  starts[len / 8] |= 1 << (len % 8);
+  for (uint8_t i = 0; i < sizeof(starts); i++) {
+    if (targets[i] & ~starts[i]) return false;
+  }
+  return true;
+}
+
+// Run a verified program. fetch(pc) returns the code byte at pc, so the
+// program can execute straight from EEPROM.
+template <typename Fetch>
+RuleResult ruleEvaluate(Fetch fetch, uint8_t len, const int16_t* vars) {
+  int16_t stack[RULE_MAX_STACK];
+  uint8_t sp = 0;
+  uint8_t pc = 0;
+  const RuleResult error = { RULE_ERROR, 0 };
+
+  while (pc < len) {
+    uint8_t op = fetch(pc++);
+
+    if (op == OP_PUSH8 || op == OP_PUSH16 || op == OP_LOAD) {
+      if (sp >= RULE_MAX_STACK) return error;
+      int16_t v;
+      if (op == OP_PUSH8)       v = (int8_t)fetch(pc++);
+      else if (op == OP_PUSH16) { v = (int16_t)(fetch(pc) | (fetch(pc + 1) << 8)); pc += 2; }
+      else {
+        uint8_t var = fetch(pc++);
+        if (var >= RULE_VAR_COUNT) return error;
+        v = vars[var];
+      }
+      stack[sp++] = v;
+      continue;
+    }
+
+    if (op == OP_JMP) {
+      pc += fetch(pc) + 1;
+      continue;
+    }
+    if (op == OP_RUN)  return { RULE_RUN, 0 };
+    if (op == OP_SKIP) return { RULE_SKIP, 0 };
+
+    // Everything below pops at least one value
+    if (sp < 1) return error;
+    int16_t b = stack[--sp];
+
+    if (op == OP_JZ) {
+      uint8_t off = fetch(pc++);
+      if (b == 0) pc += off;
+      continue;
+    }
+    if (op == OP_RUN_FOR) return { RULE_RUN, (uint16_t)(b > 0 ? b : 0) };
+    if (op == OP_NEG) { stack[sp++] = ruleWrap(-(int32_t)b); continue; }
+    if (op == OP_NOT) { stack[sp++] = !b; continue; }
+
+    if (sp < 1) return error;
+    int16_t a = stack[sp - 1];
+    int16_t r;
+    switch (op) {
+      case OP_ADD: r = ruleWrap((int32_t)a + b); break;
+      case OP_SUB: r = ruleWrap((int32_t)a - b); break;
+      case OP_MUL: r = ruleWrap((int32_t)a * b); break;
+      case OP_DIV: r = (b == 0) ? 0 : ruleWrap((int32_t)a / b); break;
+      case OP_LT:  r = a < b; break;
+      case OP_LE:  r = a <= b; break;
+      case OP_GT:  r = a > b; break;
+      case OP_GE:  r = a >= b; break;
+      case OP_EQ:  r = a == b; break;
+      case OP_NE:  r = a != b; break;
+      case OP_AND: r = a && b; break;
+      case OP_OR:  r = a || b; break;
+      default:     return error;
+    }
+    stack[sp - 1] = r;
+  }
+  return { RULE_RUN, 0 };
+}
@@ -0,0 +1,46 @@
+// =============================================================================
+// Pump run response statistics
+// =============================================================================
+// Running mean and variance of how far humidity and temperature moved over
+// a pump run, one RunResponse per preset. Welford's method updates both in
+// constant memory and stays accurate over thousands of runs, where a plain
+// sum of squares in float would not:
+//
+//   response.add(humidityDelta, temperatureDelta);   // tenths
+//   response.humidity.mean / sqrt(response.humidity.variance(response.runs))
+//
+// A RunResponse is stored in EEPROM as its raw bytes, followed by a CRC.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+// Mean and sum of squared deviations of one series
+struct RunningStat {
+  float mean;
+  float m2;
+
+  // Add the nth value (n counts it, so n >= 1)
+  void add(float x, uint16_t n) {
+    float delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+  }
+
+  // Sample variance of n values
+  float variance(uint16_t n) const { return n > 1 ? m2 / (n - 1) : 0.0f; }
+};
+
+struct RunResponse {
+  RunningStat humidity;     // tenths of %RH
+  RunningStat temperature;  // tenths of a degree C
+  uint16_t    runs;         // saturates; later runs are then ignored
+
+  void add(int16_t humidityDelta, int16_t temperatureDelta) {
+    if (runs == 0xFFFF) return;
+    runs++;
+    humidity.add(humidityDelta, runs);
+    temperature.add(temperatureDelta, runs);
+  }
+};
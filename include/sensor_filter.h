@@ -0,0 +1,95 @@
+// =============================================================================
+// Sensor Spike Filter
+// =============================================================================
+// Integer filter stage for one sensor channel: median of the last N samples,
+// followed by a slew-rate limit on the published value.
+//
+// Samples are fixed-point integers (e.g. tenths of a degree), so the filter
+// costs no floating point. A small ring keeps the samples in arrival order
+// and a parallel array keeps the same samples sorted; each update removes
+// the oldest sample from the sorted array and inserts the new one in a
+// single O(N) pass.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+template <uint8_t N>
+class SpikeFilter {
+  static_assert(N >= 1 && N <= 15, "median window must be 1..15 samples");
+
+public:
+  // maxStep: largest change of the output per update (0 = unlimited)
+  explicit SpikeFilter(int16_t maxStep) : maxStep(maxStep) {}
+
+  // Feed one raw sample; returns the new filtered value.
+  int16_t update(int16_t sample) {
+    if (count < N) {
+      insertSorted(count, sample);
+      ring[count++] = sample;
+    } else {
+      replaceSorted(ring[head], sample);
+      ring[head] = sample;
+      head = (head + 1) % N;
+    }
+
+    int16_t median = sorted[(count - 1) / 2];
+    if (!hasOutput) {
+      output = median;
+      hasOutput = true;
+    } else if (maxStep > 0) {
+      int16_t delta = median - output;
+      if (delta > maxStep)        output += maxStep;
+      else if (delta < -maxStep)  output -= maxStep;
+      else                        output = median;
+    } else {
+      output = median;
+    }
+    return output;
+  }
+
+  int16_t value() const     { return output; }
+  bool    hasValue() const  { return hasOutput; }
+
+  void reset() {
+    count = 0;
+    head = 0;
+    hasOutput = false;
+  }
+
+private:
+  // Insert into sorted[0..len) keeping ascending order.
+  void insertSorted(uint8_t len, int16_t sample) {
+    uint8_t i = len;
+    while (i > 0 && sorted[i - 1] > sample) {
+      sorted[i] = sorted[i - 1];
+      i--;
+    }
+    sorted[i] = sample;
+  }
+
+  // Replace one occurrence of oldSample with newSample, keeping order.
+  // Shifts only the elements between the old and new positions.
+  void replaceSorted(int16_t oldSample, int16_t newSample) {
+    uint8_t i = 0;
+    while (i < N - 1 && sorted[i] != oldSample) i++;
+    while (i > 0 && sorted[i - 1] > newSample) {
+      sorted[i] = sorted[i - 1];
+      i--;
+    }
+    while (i < N - 1 && sorted[i + 1] < newSample) {
+      sorted[i] = sorted[i + 1];
+      i++;
+    }
+    sorted[i] = newSample;
+  }
+
+  int16_t ring[N];
+  int16_t sorted[N];
+  uint8_t head = 0;
+  uint8_t count = 0;
+  int16_t output = 0;
+  bool    hasOutput = false;
+  int16_t maxStep;
+};
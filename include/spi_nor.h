@@ -0,0 +1,104 @@
+// =============================================================================
+// SPI NOR flash driver (W25Qxx / compatible, 3-byte addressing)
+// =============================================================================
+// Minimal command set for LogStore: JEDEC ID for the capacity, read,
+// page program and 4 KB sector erase. program() and eraseSector() only
+// start the operation; poll busy() before issuing the next one.
+// =============================================================================
+
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+
+class SpiNorFlash {
+public:
+  explicit SpiNorFlash(uint8_t csPin) : cs(csPin) {}
+
+  // Returns false if no chip answers; size() is 0 in that case.
+  bool begin() {
+    pinMode(cs, OUTPUT);
+    digitalWrite(cs, HIGH);
+    SPI.begin();
+
+    select();
+    SPI.transfer(CMD_JEDEC_ID);
+    uint8_t maker = SPI.transfer(0);
+    SPI.transfer(0); // memory type
+    uint8_t capacity = SPI.transfer(0);
+    deselect();
+
+    // Capacity code is log2(bytes); accept 64 KB .. 16 MB
+    bytes = (maker != 0x00 && maker != 0xFF && capacity >= 16 && capacity <= 24)
+            ? (uint32_t)1 << capacity : 0;
+    return bytes != 0;
+  }
+
+  uint32_t size() const { return bytes; }
+
+  bool busy() {
+    select();
+    SPI.transfer(CMD_READ_STATUS);
+    uint8_t status = SPI.transfer(0);
+    deselect();
+    return status & STATUS_BUSY;
+  }
+
+  void read(uint32_t addr, uint8_t* buf, uint16_t len) {
+    select();
+    command(CMD_READ, addr);
+    while (len--) *buf++ = SPI.transfer(0);
+    deselect();
+  }
+
+  // len must not cross a 256-byte page boundary
+  void program(uint32_t addr, const uint8_t* buf, uint16_t len) {
+    writeEnable();
+    select();
+    command(CMD_PAGE_PROGRAM, addr);
+    while (len--) SPI.transfer(*buf++);
+    deselect();
+  }
+
+  void eraseSector(uint32_t addr) {
+    writeEnable();
+    select();
+    command(CMD_SECTOR_ERASE, addr);
+    deselect();
+  }
+
+private:
+  static const uint8_t CMD_WRITE_ENABLE  = 0x06;
+  static const uint8_t CMD_READ_STATUS   = 0x05;
+  static const uint8_t CMD_READ          = 0x03;
+  static const uint8_t CMD_PAGE_PROGRAM  = 0x02;
+  static const uint8_t CMD_SECTOR_ERASE  = 0x20;
+  static const uint8_t CMD_JEDEC_ID      = 0x9F;
+  static const uint8_t STATUS_BUSY       = 0x01;
+
+  void select() {
+    SPI.beginTransaction(SPISettings(8000000, MSBFIRST, SPI_MODE0));
+    digitalWrite(cs, LOW);
+  }
+
+  void deselect() {
+    digitalWrite(cs, HIGH);
+    SPI.endTransaction();
+  }
+
+  void command(uint8_t cmd, uint32_t addr) {
+    SPI.transfer(cmd);
+    SPI.transfer(addr >> 16);
+    SPI.transfer(addr >> 8);
+    SPI.transfer(addr);
+  }
+
+  void writeEnable() {
+    select();
+    SPI.transfer(CMD_WRITE_ENABLE);
+    deselect();
+  }
+
+  uint8_t  cs;
+  uint32_t bytes = 0;
+};
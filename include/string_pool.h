@@ -0,0 +1,148 @@
+// =============================================================================
+// String Pool
+// =============================================================================
+// Every user-visible string (LCD text, format strings, serial log lines and
+// command keywords) lives here, in flash (PROGMEM), addressed by a typed ID.
+// Nothing in this table is ever copied to SRAM at startup.
+//
+//   Serial.print(fstr(STR_BANNER));                         // prints from flash
+//   snprintf_P(buf, sizeof(buf), pstr(STR_FMT_PUMP_ON), s); // format from flash
+//
+// tools/check_strings.py fails the build if a string literal outside F(),
+// PSTR() or this file appears in src/.
+// =============================================================================
+
+#pragma once
+
+#include <Arduino.h>
+
+// X(id, text)
+#define STRING_POOL(X) \
+  /* --- LCD --- */ \
+  X(STR_INITIALIZING,      "Initializing...") \
+  X(STR_NO_SENSOR,         "No sensor") \
+  X(STR_PRESET_TITLE,      "Preset:") \
+  X(STR_FMT_CLIMATE,       "T:%sC H:%s%%") \
+  X(STR_FMT_PUMP_ON,       "Pump on %lus") \
+  X(STR_FMT_PUMP_OFF_S,    "Pump off %lus") \
+  X(STR_FMT_PUMP_OFF_M,    "Pump off %lum") \
+  X(STR_FMT_PUMP_OFF_H,    "Pump off %luh") \
+  X(STR_PUMP_OFF_FLOAT,    "Pump off (float)") \
+  X(STR_FMT_PRESET_LABEL,  "%u: %lus / %lu%s") \
+  X(STR_UNIT_DAY,          "day") \
+  X(STR_UNIT_H,            "h") \
+  X(STR_UNIT_MIN,          "min") \
+  X(STR_UNIT_S,            "s") \
+  /* --- Serial log --- */ \
+  X(STR_BANNER,            "Cellar Pump Controller started") \
+  X(STR_LOG_PUMP_ON,       "Pump ON  | Temp: ") \
+  X(STR_LOG_PUMP_OFF,      "Pump OFF | Temp: ") \
+  X(STR_LOG_HUMIDITY,      "C | Hum: ") \
+  X(STR_LOG_PERCENT,       "%") \
+  X(STR_LOG_BY_FLOAT,      " | float") \
+  X(STR_LOG_FLOAT_OK,      "Float switch ok: demand mode") \
+  X(STR_LOG_FLOAT_STUCK,   "Float switch stuck: timed preset") \
+  X(STR_LOG_FLOAT_SILENT,  "Float switch silent: pump off") \
+  X(STR_LOG_PRESET,        "Preset -> ") \
+  X(STR_LOG_DENIED,        "Pump start denied: ") \
+  X(STR_DUTY_REST,         "rest") \
+  X(STR_DUTY_BUDGET,       "budget") \
+  X(STR_FMT_RUN,           "RUN %u t=%d,%d,%d h=%d,%d,%d") \
+  X(STR_LOG_RULE,          "Rule -> ") \
+  X(STR_LOG_ALARM,         "Alarm ") \
+  /* alarm names, in AlarmId order */ \
+  X(STR_ALARM_TEMP_LOW,    "temp-low") \
+  X(STR_ALARM_TEMP_HIGH,   "temp-high") \
+  X(STR_ALARM_HUMIDITY_HIGH, "humidity-high") \
+  X(STR_ALARM_DEW_MARGIN_LOW, "dew-margin-low") \
+  X(STR_ALARM_ON,          " on ") \
+  X(STR_ALARM_OFF,         " off ") \
+  X(STR_RULE_RUN,          "run") \
+  X(STR_RULE_SKIP,         "skip") \
+  X(STR_RULE_ERROR,        "error") \
+  /* --- Serial commands --- */ \
+  X(STR_CMD_CFG_EXPORT,    "cfg export") \
+  X(STR_CMD_CFG_IMPORT,    "cfg import ") \
+  X(STR_REPLY_CFG,         "CFG ") \
+  X(STR_REPLY_CFG_OK,      "CFG OK") \
+  X(STR_REPLY_CFG_ERR,     "CFG ERR ") \
+  X(STR_CMD_RULE_LOAD,     "rule load ") \
+  X(STR_CMD_RULE_CLEAR,    "rule clear") \
+  X(STR_CMD_RULE_SHOW,     "rule show") \
+  X(STR_CMD_TIME,          "time ") \
+  X(STR_REPLY_RULE,        "RULE ") \
+  X(STR_REPLY_RULE_OK,     "RULE OK") \
+  X(STR_REPLY_RULE_ERR,    "RULE ERR ") \
+  X(STR_RULE_NONE,         "none") \
+  X(STR_RULE_US,           " us=") \
+  X(STR_REPLY_TIME_OK,     "TIME OK") \
+  X(STR_CMD_METRICS,       "metrics") \
+  X(STR_CMD_METRICS_EVERY, "metrics every ") \
+  X(STR_REPLY_METRIC,      "M ") \
+  X(STR_REPLY_METRIC_DELTA, "MD ") \
+  X(STR_METRIC_OVER,       ">=") \
+  X(STR_METRIC_END,        "END") \
+  X(STR_CMD_RELAY,         "relay") \
+  X(STR_FMT_RELAY,         "RELAY switches=%lu late=%lu/%lu ms") \
+  X(STR_CMD_DEV,           "dev") \
+  X(STR_FMT_DEVICES,       "DEV display=%u sensor=%u") \
+  X(STR_CMD_EE,            "ee") \
+  X(STR_FMT_EE_INFO,       "EE pending=%u writes=%lu coalesced=%lu evictions=%u up=%lu") \
+  X(STR_REPLY_EE_WEAR,     "EE wear") \
+  X(STR_CMD_LCD,           "lcd") \
+  X(STR_REPLY_LCD,         "LCD us=") \
+  X(STR_CMD_HIST,          "hist") \
+  X(STR_FMT_HIST_INFO,     "HIST %u %u") \
+  X(STR_FMT_HIST_SAMPLE,   "HIST %lu,%d,%d") \
+  X(STR_REPLY_HIST_END,    "HIST END") \
+  X(STR_CMD_RUNS,          "runs") \
+  X(STR_FMT_RUNS,          "RUNS %u n=%u h=%d/%d t=%d/%d") \
+  X(STR_REPLY_RUNS_END,    "RUNS END") \
+  X(STR_CMD_BUS,           "bus") \
+  X(STR_FMT_BUS,           "BUS addr=%u nodes=%u synced=%u offset=%ld frames=%u errors=%u steps=%u") \
+  X(STR_CMD_DUTY,          "duty") \
+  X(STR_FMT_DUTY,          "DUTY on=%u/%u s denied=%u last=%u") \
+  X(STR_CMD_FLOAT,         "float") \
+  X(STR_FMT_FLOAT,         "FLOAT level=%u failed=%u long=%u") \
+  X(STR_CMD_ALARM,         "alarm") \
+  X(STR_CMD_ALARM_ACK,     "alarm ack") \
+  X(STR_FMT_ALARM,         "ALARM active=%u latched=%u") \
+  X(STR_CMD_LOG_INFO,      "log info") \
+  X(STR_CMD_LOG_DUMP,      "log dump ") \
+  X(STR_REPLY_LOG,         "LOG ") \
+  X(STR_FMT_LOG_INFO,      "LOG head=%lu seq=%lu pending=%u written=%lu erased=%lu dropped=%lu") \
+  X(STR_FMT_LOG_VALUE,     "LOG %lu,%u,%lu") \
+  X(STR_FMT_LOG_PAIR,      "LOG %lu,%u,%d,%d") \
+  X(STR_REPLY_LOG_END,     "LOG END") \
+  X(STR_ERR_BAD_TIME,      "ERR bad time") \
+  X(STR_ERR_TOO_LONG,      "ERR command too long") \
+  X(STR_ERR_UNKNOWN,       "ERR unknown command")
+
+enum StrId : uint8_t {
+#define STRING_POOL_ID(id, text) id,
+  STRING_POOL(STRING_POOL_ID)
+#undef STRING_POOL_ID
+  STR_COUNT
+};
+
+namespace string_pool {
+#define STRING_POOL_TEXT(id, text) const char id[] PROGMEM = text;
+  STRING_POOL(STRING_POOL_TEXT)
+#undef STRING_POOL_TEXT
+
+  const char* const TABLE[STR_COUNT] PROGMEM = {
+#define STRING_POOL_ENTRY(id, text) id,
+    STRING_POOL(STRING_POOL_ENTRY)
+#undef STRING_POOL_ENTRY
+  };
+} // namespace string_pool
+
+// Flash address of a pooled string, for the *_P functions.
+inline PGM_P pstr(StrId id) {
+  return (PGM_P)pgm_read_ptr(&string_pool::TABLE[id]);
+}
+
+// Pooled string for Print::print(), which reads it straight from flash.
+inline const __FlashStringHelper* fstr(StrId id) {
+  return reinterpret_cast<const __FlashStringHelper*>(pstr(id));
+}
@@ -0,0 +1,62 @@
+// =============================================================================
+// Target profiles
+// =============================================================================
+// Buffer capacities that scale with the MCU, so one source uses whatever
+// RAM and EEPROM the board has. The profile follows the MCU the build
+// targets (platformio.ini: env:uno, env:megaatmega2560); host builds (the
+// simulator) default to the Uno and take -DCELLARPUMP_TARGET_MEGA2560 to
+// act as a Mega (env:native_mega).
+//
+//   capacity                    Uno (328P)   Mega 2560
+//   SRAM / EEPROM               2 / 1 KB     8 / 4 KB
+//   history ring (RAM, EEPROM)  128 B        2 KB      ~2.5 vs ~40 days
+//   history blocks (8 h each)   8            128
+//   log pages buffered in RAM   1            4         while the flash is busy
+//   EEPROM cache lines (16 B)   7            16        pending EEPROM writes
+//   run statistics, metrics     -            yes       ENABLE_RUN_STATS, ENABLE_METRICS
+//
+// Uno SRAM budget (.data + .bss, estimated per object; "pio run -e uno -t
+// stack" has the real figures):
+//
+//   config double buffer        176   EEPROM cache (7 lines, wear)   220
+//   history ring and index      168   data log (1 page)              100
+//   import blob                  94   sensor filters                  56
+//   duty limiter (12 buckets)    48   other firmware state          ~270
+//   Serial, Wire, TWI buffers  ~360   rest of the core and libraries  ~75
+//   total                     ~1570   left for the stack            ~480
+//
+// The run statistics (~145 B) and the metrics table (~150 B) would leave
+// less than the ~300 B the deepest call path needs, so they are Mega only.
+// Everything else (the sensor, the relay, the presets) is the same on both.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__)
+  #ifndef CELLARPUMP_TARGET_MEGA2560
+    #define CELLARPUMP_TARGET_MEGA2560
+  #endif
+#endif
+
+#ifdef CELLARPUMP_TARGET_MEGA2560
+
+constexpr uint16_t TARGET_EEPROM_SIZE    = 4096;
+constexpr uint16_t TARGET_HISTORY_BYTES  = 2048;
+constexpr uint8_t  TARGET_HISTORY_BLOCKS = 128;
+constexpr uint8_t  TARGET_LOG_PAGES      = 4;
+constexpr uint8_t  TARGET_EEPROM_LINES   = 16;
+
+#else // ATmega328P (Uno)
+
+constexpr uint16_t TARGET_EEPROM_SIZE    = 1024;
+constexpr uint16_t TARGET_HISTORY_BYTES  = 128;
+constexpr uint8_t  TARGET_HISTORY_BLOCKS = 8;
+constexpr uint8_t  TARGET_LOG_PAGES      = 1;
+constexpr uint8_t  TARGET_EEPROM_LINES   = 7;
+
+#endif
+
+static_assert(TARGET_EEPROM_LINES >= 7, "a config blob spans 6 cache lines");
+static_assert(TARGET_LOG_PAGES >= 1, "the log needs a page to fill");
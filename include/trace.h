@@ -0,0 +1,30 @@
+// =============================================================================
+// Trace scopes
+// =============================================================================
+// TRACE_SCOPE("name") marks the rest of the enclosing block as one span in
+// the host simulator's timeline (--trace FILE, Chrome trace-event JSON). On
+// the target it compiles to nothing, so the name never reaches flash or RAM.
+// =============================================================================
+
+#pragma once
+
+#ifdef CELLARPUMP_SIM
+
+// Implemented in sim/sim_trace.cpp
+void traceBegin(const char* name);
+void traceEnd();
+
+struct TraceScope {
+  explicit TraceScope(const char* name) { traceBegin(name); }
+  ~TraceScope() { traceEnd(); }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name)   TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#else
+
+#define TRACE_SCOPE(name)   do {} while (0)
+
+#endif
@@ -0,0 +1,171 @@
+// =============================================================================
+// Host Arduino core — virtual clock, GPIO, Print and Serial
+// =============================================================================
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_trace.h"
+
+#include <deque>
+#include <unistd.h>
+
+static uint64_t nowUs = 0;
+static bool     pinLevel[SIM_PIN_COUNT];
+static uint8_t  pinModes[SIM_PIN_COUNT];
+static volatile uint8_t portInputs[PD + 1]; // indexed by port, as PINx
+
+static std::deque<uint8_t> serialRx;
+static bool serialEcho = true;
+static SimPinHook pinHook = nullptr;
+static int      busFd = -1;
+static uint8_t  busDePin = 0;
+
+HardwareSerial Serial;
+
+// =============================================================================
+// Simulator control
+// =============================================================================
+
+static void setPinLevel(uint8_t pin, bool level) {
+  pinLevel[pin] = level;
+  uint8_t port = digitalPinToPort(pin), mask = digitalPinToBitMask(pin);
+  portInputs[port] = level ? (portInputs[port] | mask) : (portInputs[port] & ~mask);
+}
+
+uint64_t simNow() { return nowUs; }
+void simAdvance(uint64_t us) { nowUs += us; }
+
+void simSetInput(uint8_t pin, bool level) {
+  if (pin < SIM_PIN_COUNT) setPinLevel(pin, level);
+}
+
+bool simGetOutput(uint8_t pin) {
+  return pin < SIM_PIN_COUNT && pinLevel[pin];
+}
+
+void simOnPinWrite(SimPinHook hook) { pinHook = hook; }
+
+void simSerialInject(const char* text) {
+  while (*text) serialRx.push_back(static_cast<uint8_t>(*text++));
+}
+
+void simSerialEcho(bool enabled) { serialEcho = enabled; }
+
+void simSerialBus(int fd, uint8_t dePin) {
+  busFd = fd;
+  busDePin = dePin;
+}
+
+void simSerialBusPoll() {
+  if (busFd < 0) return;
+  uint8_t buf[256];
+  ssize_t n;
+  while ((n = ::read(busFd, buf, sizeof(buf))) > 0) serialRx.insert(serialRx.end(), buf, buf + n);
+}
+
+// =============================================================================
+// Time and GPIO
+// =============================================================================
+
+unsigned long millis() { return static_cast<unsigned long>(nowUs / 1000); }
+unsigned long micros() { return static_cast<unsigned long>(nowUs); }
+
+void delay(unsigned long ms) {
+  uint64_t start = nowUs;
+  nowUs += static_cast<uint64_t>(ms) * 1000;
+  simTraceWait("delay", start);
+}
+
+void delayMicroseconds(unsigned int us) { nowUs += us; }
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= SIM_PIN_COUNT) return;
+  pinModes[pin] = mode;
+  if (mode == INPUT_PULLUP) setPinLevel(pin, true);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin >= SIM_PIN_COUNT) return;
+  setPinLevel(pin, val != LOW);
+  if (pinHook) pinHook(pin, pinLevel[pin]);
+  simTracePin(pin, pinLevel[pin]);
+}
+
+int digitalRead(uint8_t pin) {
+  return (pin < SIM_PIN_COUNT && pinLevel[pin]) ? HIGH : LOW;
+}
+
+uint8_t digitalPinToPort(uint8_t pin) {
+  if (pin >= SIM_PIN_COUNT) return NOT_A_PORT;
+  return pin < 8 ? PD : (pin < 14 ? PB : PC);
+}
+
+uint8_t digitalPinToBitMask(uint8_t pin) {
+  return 1 << (pin < 8 ? pin : (pin < 14 ? pin - 8 : pin - 14));
+}
+
+volatile uint8_t* portInputRegister(uint8_t port) { return &portInputs[port]; }
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* sout) {
+  sprintf(sout, "%*.*f", width, prec, val);
+  return sout;
+}
+
+// =============================================================================
+// Print
+// =============================================================================
+
+size_t Print::print(long n, int base) {
+  if (base == DEC && n < 0) {
+    size_t t = print('-');
+    return t + printNumber(static_cast<unsigned long>(-n), DEC);
+  }
+  return printNumber(static_cast<unsigned long>(n), base);
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char* str = &buf[sizeof(buf) - 1];
+  *str = '\0';
+  if (base < 2) base = 10;
+  do {
+    char c = static_cast<char>(n % base);
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+  return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, number);
+  return write(buf);
+}
+
+// =============================================================================
+// Serial
+// =============================================================================
+
+void HardwareSerial::begin(unsigned long) {}
+
+int HardwareSerial::available() { return static_cast<int>(serialRx.size()); }
+
+int HardwareSerial::read() {
+  if (serialRx.empty()) return -1;
+  uint8_t c = serialRx.front();
+  serialRx.pop_front();
+  return c;
+}
+
+int HardwareSerial::peek() { return serialRx.empty() ? -1 : serialRx.front(); }
+
+int HardwareSerial::availableForWrite() { return 63; }
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serialEcho && c != '\r') fputc(c, stdout);
+  if (busFd >= 0 && busDePin < SIM_PIN_COUNT && pinLevel[busDePin]) {
+    ssize_t n = ::write(busFd, &c, 1);
+    (void)n;
+  }
+  return 1;
+}
@@ -0,0 +1,143 @@
+// =============================================================================
+// Host Arduino core (native simulator build)
+// =============================================================================
+// Just enough of the Arduino API for src/main.cpp to compile and run on a
+// desktop. Time is virtual: millis()/micros() read a simulated clock that
+// only advances through delay(), bus transfers and the simulator main loop.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// =============================================================================
+// Flash (PROGMEM) emulation — on the host, flash and RAM are the same thing
+// =============================================================================
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+
+#define pgm_read_byte(addr)  (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word(addr)  (*reinterpret_cast<const uint16_t*>(addr))
+#define pgm_read_dword(addr) (*reinterpret_cast<const uint32_t*>(addr))
+#define pgm_read_ptr(addr)   (*reinterpret_cast<const void* const*>(addr))
+
+#define strlen_P   strlen
+#define strcpy_P   strcpy
+#define strncpy_P  strncpy
+#define strcmp_P   strcmp
+#define strncmp_P  strncmp
+#define memcpy_P   memcpy
+#define snprintf_P snprintf
+
+char* dtostrf(double val, signed char width, unsigned char prec, char* sout);
+
+// =============================================================================
+// Time and GPIO
+// =============================================================================
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+// Port input registers, with the ATmega328P pin mapping (D0-D7 port D,
+// D8-D13 port B, A0-A5 port C); they follow the pin levels
+#define NOT_A_PORT 0
+#define PB 2
+#define PC 3
+#define PD 4
+
+uint8_t digitalPinToPort(uint8_t pin);
+uint8_t digitalPinToBitMask(uint8_t pin);
+volatile uint8_t* portInputRegister(uint8_t port);
+
+// =============================================================================
+// Print / Serial
+// =============================================================================
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char* str) {
+    return str ? write(reinterpret_cast<const uint8_t*>(str), strlen(str)) : 0;
+  }
+  size_t write(const char* buffer, size_t size) {
+    return write(reinterpret_cast<const uint8_t*>(buffer), size);
+  }
+
+  // Like the AVR core: one write(uint8_t) per character read from flash
+  size_t print(const __FlashStringHelper* s) {
+    size_t n = 0;
+    for (const char* p = reinterpret_cast<const char*>(s); *p; p++) n += write(static_cast<uint8_t>(*p));
+    return n;
+  }
+  size_t print(const char* s)                 { return write(s); }
+  size_t print(char c)                        { return write(static_cast<uint8_t>(c)); }
+  size_t print(unsigned char n, int base = DEC) { return printNumber(n, base); }
+  size_t print(int n, int base = DEC)         { return print(static_cast<long>(n), base); }
+  size_t print(unsigned int n, int base = DEC) { return printNumber(n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC) { return printNumber(n, base); }
+  size_t print(double n, int digits = 2)      { return printFloat(n, digits); }
+
+  size_t println()                            { return write("\r\n"); }
+  template <typename T>
+  size_t println(T v)                         { size_t n = print(v); return n + println(); }
+  template <typename T>
+  size_t println(T v, int fmt)                { size_t n = print(v, fmt); return n + println(); }
+
+private:
+  size_t printNumber(unsigned long n, uint8_t base);
+  size_t printFloat(double number, uint8_t digits);
+};
+
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long baud);
+  int  available();
+  int  read();
+  int  peek();
+  int  availableForWrite();
+  void flush() {}
+  size_t write(uint8_t c) override;
+  using Print::write;
+  explicit operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
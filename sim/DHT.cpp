@@ -0,0 +1,56 @@
+// =============================================================================
+// Host DHT20 driver
+// =============================================================================
+
+#include "DHT.h"
+#include "Wire.h"
+
+static const uint8_t DHT20_ADDRESS = 0x38;
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0xFF;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x31) : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+void DHT::begin() {
+  Wire.begin();
+  delay(100); // power-on settling, as the real driver does
+}
+
+int DHT::readTempAndHumidity(float* values) {
+  const uint8_t trigger[3] = { 0xAC, 0x33, 0x00 };
+  Wire.beginTransmission(DHT20_ADDRESS);
+  Wire.write(trigger, sizeof(trigger));
+  if (Wire.endTransmission() != 0) return -1;
+
+  delay(80); // measurement time
+
+  uint8_t buf[7];
+  if (Wire.requestFrom(DHT20_ADDRESS, sizeof(buf)) != sizeof(buf)) return -1;
+  for (uint8_t i = 0; i < sizeof(buf); i++) buf[i] = static_cast<uint8_t>(Wire.read());
+
+  if (buf[0] & 0x80) return -1;               // still busy
+  if (crc8(buf, 6) != buf[6]) return -1;      // corrupted frame
+
+  uint32_t rawHum  = (static_cast<uint32_t>(buf[1]) << 12) | (static_cast<uint32_t>(buf[2]) << 4) | (buf[3] >> 4);
+  uint32_t rawTemp = (static_cast<uint32_t>(buf[3] & 0x0F) << 16) | (static_cast<uint32_t>(buf[4]) << 8) | buf[5];
+  values[0] = rawHum * 100.0f / 1048576.0f;
+  values[1] = rawTemp * 200.0f / 1048576.0f - 50.0f;
+  return 0;
+}
+
+float DHT::readTemperature() {
+  float v[2];
+  return readTempAndHumidity(v) == 0 ? v[1] : NAN;
+}
+
+float DHT::readHumidity() {
+  float v[2];
+  return readTempAndHumidity(v) == 0 ? v[0] : NAN;
+}
@@ -0,0 +1,25 @@
+// =============================================================================
+// Host stand-in for the Seeed Grove DHT library (DHT20 over I2C only)
+// =============================================================================
+// Talks to the simulated DHT20 at 0x38 through the host Wire, using the
+// same trigger / 80 ms wait / 7-byte read sequence as the real driver.
+// =============================================================================
+
+#pragma once
+
+#include "Arduino.h"
+
+#define DHT20 20
+
+class DHT {
+public:
+  explicit DHT(uint8_t type) : _type(type) {}
+  void begin();
+  // values[0] = humidity (%), values[1] = temperature (C). 0 on success.
+  int readTempAndHumidity(float* values);
+  float readTemperature();
+  float readHumidity();
+
+private:
+  uint8_t _type;
+};
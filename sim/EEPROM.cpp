@@ -0,0 +1,27 @@
+// =============================================================================
+// Host EEPROM
+// =============================================================================
+
+#include "EEPROM.h"
+#include "sim.h"
+#include "sim_trace.h"
+
+EEPROMClass EEPROM;
+
+static const uint64_t WRITE_TIME_US = 3300;
+static uint64_t busyUntil = 0;
+
+bool eeprom_is_ready() { return simNow() >= busyUntil; }
+
+// Like avr-libc's eeprom_write_byte(): wait for the previous write, then
+// start this one and return.
+void EEPROMClass::write(int idx, uint8_t val) {
+  if (simNow() < busyUntil) {
+    uint64_t start = simNow();
+    simAdvance(busyUntil - simNow());
+    simTraceWait("eeprom wait", start);
+  }
+  cells[idx % SIM_EEPROM_SIZE] = val;
+  writes++;
+  busyUntil = simNow() + WRITE_TIME_US;
+}
@@ -0,0 +1,51 @@
+// =============================================================================
+// Host EEPROM — byte array of the target's EEPROM size (include/
+// target_profile.h), optionally persisted to a file by the sim
+// =============================================================================
+// Writes take effect at once but keep the EEPROM busy for 3.3 ms, like the
+// ATmega328P: eeprom_is_ready() is false meanwhile, and another write
+// waits for the previous one to finish.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include "target_profile.h"
+
+const int SIM_EEPROM_SIZE = TARGET_EEPROM_SIZE;
+
+// <avr/eeprom.h>
+bool eeprom_is_ready();
+
+class EEPROMClass {
+public:
+  EEPROMClass() { memset(cells, 0xFF, sizeof(cells)); }
+
+  uint8_t read(int idx) const { return cells[idx % SIM_EEPROM_SIZE]; }
+  void write(int idx, uint8_t val);
+  void update(int idx, uint8_t val) {
+    if (read(idx) != val) write(idx, val);
+  }
+  uint16_t length() const { return SIM_EEPROM_SIZE; }
+
+  template <typename T> T& get(int idx, T& t) const {
+    memcpy(&t, &cells[idx], sizeof(T));
+    return t;
+  }
+  template <typename T> const T& put(int idx, const T& t) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&t);
+    for (size_t i = 0; i < sizeof(T); i++) update(idx + static_cast<int>(i), p[i]);
+    return t;
+  }
+
+  uint8_t*      raw()         { return cells; }
+  unsigned long writeCount()  const { return writes; }
+
+private:
+  uint8_t cells[SIM_EEPROM_SIZE];
+  unsigned long writes = 0;
+};
+
+extern EEPROMClass EEPROM;
@@ -0,0 +1,39 @@
+// =============================================================================
+// Host SPI master
+// =============================================================================
+
+#include "SPI.h"
+#include "sim.h"
+
+SPIClass SPI;
+
+static SimSpiDevice* devices[SIM_PIN_COUNT];
+static SimSpiDevice* selected = nullptr;
+static SimSpiStats stats;
+
+static void onPinWrite(uint8_t pin, bool level) {
+  SimSpiDevice* dev = devices[pin];
+  if (!dev) return;
+  if (!level && selected != dev) {
+    selected = dev;
+    dev->select();
+  } else if (level && selected == dev) {
+    selected = nullptr;
+    dev->deselect();
+  }
+}
+
+void simSpiAttach(uint8_t csPin, SimSpiDevice* device) {
+  if (csPin >= SIM_PIN_COUNT) return;
+  devices[csPin] = device;
+  simOnPinWrite(onPinWrite);
+}
+
+const SimSpiStats& simSpiStats() { return stats; }
+
+// Nothing selected reads as a floating-high MISO line.
+uint8_t SPIClass::transfer(uint8_t data) {
+  simAdvance(2); // 1 us on the wire at 8 MHz, ~1 us of AVR loop around it
+  stats.bytes++;
+  return selected ? selected->transfer(data) : 0xFF;
+}
@@ -0,0 +1,51 @@
+// =============================================================================
+// Host SPI master — routes transfers to the device whose chip select is low
+// =============================================================================
+// Chip select is an ordinary digitalWrite() on the device's CS pin; the
+// device model sees select()/deselect() on the falling/rising edge.
+// Each byte is charged on the virtual clock at 8 MHz plus loop overhead.
+// =============================================================================
+
+#pragma once
+
+#include "Arduino.h"
+
+#ifndef MSBFIRST
+#define MSBFIRST 1
+#define LSBFIRST 0
+#endif
+#define SPI_MODE0 0x00
+
+class SPISettings {
+public:
+  SPISettings() {}
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+// A device model attached to the simulated bus.
+class SimSpiDevice {
+public:
+  virtual ~SimSpiDevice() {}
+  virtual void select() = 0;                   // CS went low
+  virtual uint8_t transfer(uint8_t mosi) = 0;  // one full-duplex byte
+  virtual void deselect() = 0;                 // CS went high
+};
+
+// Bus-wide traffic counters (cumulative since boot).
+struct SimSpiStats {
+  unsigned long bytes;
+};
+
+void simSpiAttach(uint8_t csPin, SimSpiDevice* device);
+const SimSpiStats& simSpiStats();
+
+class SPIClass {
+public:
+  void begin() {}
+  void end() {}
+  void beginTransaction(SPISettings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data);
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,105 @@
+// =============================================================================
+// Host Wire (I2C master)
+// =============================================================================
+
+#include "Wire.h"
+#include "sim.h"
+#include "sim_faults.h"
+#include "sim_trace.h"
+
+TwoWire Wire;
+
+static SimI2cDevice* devices[128];
+static SimI2cStats stats;
+
+// 100 kHz: 10 us per bit, 9 bits per byte (8 data + ACK), ~20 us start/stop
+static void chargeBusTime(size_t bytesIncludingAddress) {
+  simAdvance(20 + bytesIncludingAddress * 90);
+}
+
+void simI2cAttach(uint8_t address, SimI2cDevice* device) {
+  devices[address & 0x7F] = device;
+}
+
+const SimI2cStats& simI2cStats() { return stats; }
+
+void TwoWire::beginTransmission(uint8_t address) {
+  txAddress = address;
+  txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+  if (txLength >= BUFFER_LENGTH) return 0;
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+  size_t n = 0;
+  while (len-- && write(*data++)) n++;
+  return n;
+}
+
+// Returns 0 on success, 2 on address NAK, 3 on data NAK, 5 on timeout
+// (same codes as the AVR Wire library).
+static uint8_t transmit(uint8_t address, const uint8_t* data, uint8_t len) {
+  stats.transactions++;
+  SimI2cDevice* dev = devices[address & 0x7F];
+  if (dev && simFault(SIM_FAULT_I2C_HANG)) {
+    simAdvance(SIM_I2C_HANG_US);
+    stats.timeouts++;
+    return 5;
+  }
+  if (!dev || simFault(SIM_FAULT_I2C_NAK)) {
+    chargeBusTime(1);
+    stats.naks++;
+    return 2;
+  }
+  chargeBusTime(1 + len);
+  stats.bytes += len;
+  if (!dev->onWrite(data, len)) {
+    stats.naks++;
+    return 3;
+  }
+  return 0;
+}
+
+// Returns the number of bytes read; 0 on NAK or timeout.
+static uint8_t receive(uint8_t address, uint8_t* data, uint8_t quantity) {
+  stats.transactions++;
+  SimI2cDevice* dev = devices[address & 0x7F];
+  if (dev && simFault(SIM_FAULT_I2C_HANG)) {
+    simAdvance(SIM_I2C_HANG_US);
+    stats.timeouts++;
+    return 0;
+  }
+  if (!dev || simFault(SIM_FAULT_I2C_NAK)) {
+    chargeBusTime(1);
+    stats.naks++;
+    return 0;
+  }
+  uint8_t n = static_cast<uint8_t>(dev->onRead(data, quantity));
+  chargeBusTime(1 + n);
+  stats.bytes += n;
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool) {
+  uint64_t start = simNow();
+  uint8_t status = transmit(txAddress, txBuffer, txLength);
+  simTraceI2c(txAddress, false, txLength, status, start);
+  return status;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, bool) {
+  uint64_t start = simNow();
+  rxIndex = 0;
+  if (quantity > BUFFER_LENGTH) quantity = BUFFER_LENGTH;
+  rxLength = receive(address, rxBuffer, quantity);
+  simTraceI2c(address, true, rxLength, rxLength ? 0 : 2, start);
+  return rxLength;
+}
+
+int TwoWire::available() { return rxLength - rxIndex; }
+
+int TwoWire::read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
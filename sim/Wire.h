@@ -0,0 +1,59 @@
+// =============================================================================
+// Host Wire (I2C master) — routes transactions to simulated devices
+// =============================================================================
+// Every transaction is charged on the virtual clock at 100 kHz
+// (9 bit times per byte plus start/stop), so bus traffic shows up as time.
+// =============================================================================
+
+#pragma once
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+// A device model attached to the simulated bus.
+class SimI2cDevice {
+public:
+  virtual ~SimI2cDevice() {}
+  // Master wrote len bytes (one transaction). Return false to NAK.
+  virtual bool onWrite(const uint8_t* data, size_t len) = 0;
+  // Master requests up to len bytes. Return the number supplied.
+  virtual size_t onRead(uint8_t* data, size_t len) = 0;
+};
+
+// Bus-wide traffic counters (cumulative since boot).
+struct SimI2cStats {
+  unsigned long transactions;
+  unsigned long bytes;   // address byte excluded
+  unsigned long naks;
+  unsigned long timeouts; // hung transactions (fault injection)
+};
+
+void simI2cAttach(uint8_t address, SimI2cDevice* device);
+const SimI2cStats& simI2cStats();
+
+class TwoWire {
+public:
+  void begin() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  size_t write(const uint8_t* data, size_t len);
+  uint8_t endTransmission(bool sendStop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, bool sendStop = true);
+  uint8_t requestFrom(int address, int quantity) {
+    return requestFrom(static_cast<uint8_t>(address), static_cast<uint8_t>(quantity));
+  }
+  int available();
+  int read();
+
+private:
+  uint8_t txAddress = 0;
+  uint8_t txBuffer[BUFFER_LENGTH];
+  uint8_t txLength = 0;
+  uint8_t rxBuffer[BUFFER_LENGTH];
+  uint8_t rxLength = 0;
+  uint8_t rxIndex = 0;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,108 @@
+// =============================================================================
+// Host rgb_lcd driver
+// =============================================================================
+
+#include "rgb_lcd.h"
+
+void rgb_lcd::i2c_send_byteS(const uint8_t* dta, uint8_t len) {
+  _wire->beginTransmission(LCD_ADDRESS);
+  _wire->write(dta, len);
+  _wire->endTransmission();
+}
+
+void rgb_lcd::setReg(uint8_t reg, uint8_t dat) {
+  _wire->beginTransmission(rgb_chip_addr);
+  _wire->write(reg);
+  _wire->write(dat);
+  _wire->endTransmission();
+}
+
+void rgb_lcd::begin(uint8_t, uint8_t rows, uint8_t charsize, TwoWire& wire) {
+  _wire = &wire;
+  _wire->begin();
+
+  _displayfunction = charsize;
+  if (rows > 1) _displayfunction |= LCD_2LINE;
+
+  delayMicroseconds(50000);
+  command(LCD_FUNCTIONSET | _displayfunction);
+  delayMicroseconds(4500);
+  command(LCD_FUNCTIONSET | _displayfunction);
+  delayMicroseconds(150);
+  command(LCD_FUNCTIONSET | _displayfunction);
+  command(LCD_FUNCTIONSET | _displayfunction);
+
+  _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+  display();
+  clear();
+
+  _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+  command(LCD_ENTRYMODESET | _displaymode);
+
+  // Backlight controller: v5 boards answer at 0x30, older ones at 0x62
+  _wire->beginTransmission(RGB_ADDRESS_V5);
+  rgb_chip_addr = (_wire->endTransmission() == 0) ? RGB_ADDRESS_V5 : RGB_ADDRESS;
+  if (rgb_chip_addr == RGB_ADDRESS_V5) {
+    setReg(0x00, 0x07); // reset
+    delayMicroseconds(200);
+    setReg(0x04, 0x15); // all LEDs PWM controlled
+  } else {
+    setReg(0x00, 0);
+    setReg(0x08, 0xFF);
+    setReg(0x01, 0x20);
+  }
+  setColorWhite();
+}
+
+void rgb_lcd::clear() {
+  command(LCD_CLEARDISPLAY);
+  delayMicroseconds(2000);
+}
+
+void rgb_lcd::home() {
+  command(LCD_RETURNHOME);
+  delayMicroseconds(2000);
+}
+
+void rgb_lcd::noDisplay() {
+  _displaycontrol &= ~LCD_DISPLAYON;
+  command(LCD_DISPLAYCONTROL | _displaycontrol);
+}
+
+void rgb_lcd::display() {
+  _displaycontrol |= LCD_DISPLAYON;
+  command(LCD_DISPLAYCONTROL | _displaycontrol);
+}
+
+void rgb_lcd::setCursor(uint8_t col, uint8_t row) {
+  col = (row == 0 ? col | 0x80 : col | 0xC0);
+  const uint8_t dta[2] = { 0x80, col };
+  i2c_send_byteS(dta, 2);
+}
+
+void rgb_lcd::setRGB(unsigned char r, unsigned char g, unsigned char b) {
+  if (rgb_chip_addr == RGB_ADDRESS_V5) {
+    setReg(0x06, r);
+    setReg(0x07, g);
+    setReg(0x08, b);
+  } else {
+    setReg(0x04, r);
+    setReg(0x03, g);
+    setReg(0x02, b);
+  }
+}
+
+void rgb_lcd::setPWM(unsigned char color, unsigned char pwm) {
+  setReg(color, pwm);
+}
+
+void rgb_lcd::command(uint8_t value) {
+  const uint8_t dta[2] = { 0x80, value };
+  i2c_send_byteS(dta, 2);
+}
+
+size_t rgb_lcd::write(uint8_t value) {
+  const uint8_t dta[2] = { 0x40, value };
+  i2c_send_byteS(dta, 2);
+  return 1;
+}
@@ -0,0 +1,62 @@
+// =============================================================================
+// Host stand-in for the Seeed Grove rgb_lcd library
+// =============================================================================
+// Sends exactly the I2C traffic the real driver does — one transaction per
+// command or character — so the simulated bus counters match hardware.
+// =============================================================================
+
+#pragma once
+
+#include "Arduino.h"
+#include "Wire.h"
+
+#define LCD_ADDRESS     (0x7c >> 1)
+#define RGB_ADDRESS     (0xc4 >> 1)
+#define RGB_ADDRESS_V5  (0x30)
+
+// HD44780 commands
+#define LCD_CLEARDISPLAY   0x01
+#define LCD_RETURNHOME     0x02
+#define LCD_ENTRYMODESET   0x04
+#define LCD_DISPLAYCONTROL 0x08
+#define LCD_CURSORSHIFT    0x10
+#define LCD_FUNCTIONSET    0x20
+#define LCD_SETCGRAMADDR   0x40
+#define LCD_SETDDRAMADDR   0x80
+
+#define LCD_ENTRYLEFT           0x02
+#define LCD_ENTRYSHIFTDECREMENT 0x00
+#define LCD_DISPLAYON  0x04
+#define LCD_CURSOROFF  0x00
+#define LCD_BLINKOFF   0x00
+#define LCD_2LINE      0x08
+#define LCD_5x8DOTS    0x00
+
+class rgb_lcd : public Print {
+public:
+  void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS, TwoWire& wire = Wire);
+
+  void clear();
+  void home();
+  void noDisplay();
+  void display();
+  void setCursor(uint8_t col, uint8_t row);
+
+  void setRGB(unsigned char r, unsigned char g, unsigned char b);
+  void setPWM(unsigned char color, unsigned char pwm);
+  void setColorWhite() { setRGB(255, 255, 255); }
+
+  void command(uint8_t value);
+  virtual size_t write(uint8_t value) override;
+  using Print::write;
+
+protected:
+  void i2c_send_byteS(const uint8_t* dta, uint8_t len);
+  void setReg(uint8_t reg, uint8_t dat);
+
+  TwoWire* _wire = &Wire;
+  uint8_t  _displayfunction = 0;
+  uint8_t  _displaycontrol = 0;
+  uint8_t  _displaymode = 0;
+  uint8_t  rgb_chip_addr = RGB_ADDRESS_V5;
+};
@@ -0,0 +1,32 @@
+// =============================================================================
+// Simulator control interface
+// =============================================================================
+// Hooks used by sim_main.cpp and the device models to drive the virtual
+// clock, the GPIO pins and the serial port. Firmware code never includes
+// this header.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Virtual clock (microseconds since boot) ---
+uint64_t simNow();
+void     simAdvance(uint64_t us);
+
+// --- GPIO ---
+const int SIM_PIN_COUNT = 20;
+void simSetInput(uint8_t pin, bool level);   // drive an input pin
+bool simGetOutput(uint8_t pin);              // observe an output pin
+// Called after every digitalWrite() (one hook; used for SPI chip selects)
+typedef void (*SimPinHook)(uint8_t pin, bool level);
+void simOnPinWrite(SimPinHook hook);
+
+// --- Serial ---
+void simSerialInject(const char* text);       // queue bytes for Serial.read()
+void simSerialEcho(bool enabled);             // copy Serial output to stdout
+// RS-485: Serial output also goes to fd while dePin is HIGH, and
+// simSerialBusPoll() queues whatever arrived on fd for Serial.read()
+void simSerialBus(int fd, uint8_t dePin);
+void simSerialBusPoll();
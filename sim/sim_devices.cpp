@@ -0,0 +1,279 @@
+// =============================================================================
+// Simulated peripherals
+// =============================================================================
+
+#include "sim_devices.h"
+#include "sim.h"
+#include "sim_faults.h"
+
+// =============================================================================
+// LCD (HD44780 command set over the JHD1313 I2C bridge)
+// =============================================================================
+
+LcdModel::LcdModel() {
+  memset(ddram, ' ', sizeof(ddram));
+  refreshVisible();
+}
+
+// Each transaction is a sequence of control bytes followed by payload.
+// Control bit 7 (Co) set: exactly one payload byte follows, then another
+// control byte. Co clear: every remaining byte is payload. Bit 6 (RS)
+// selects data (1) or command (0).
+bool LcdModel::onWrite(const uint8_t* data, size_t len) {
+  counters.transactions++;
+  size_t i = 0;
+  while (i < len) {
+    uint8_t control = data[i++];
+    bool continuation = control & 0x80;
+    bool isData = control & 0x40;
+    size_t end = continuation ? (i < len ? i + 1 : i) : len;
+    for (; i < end; i++) {
+      if (isData) writeData(data[i]);
+      else        execCommand(data[i]);
+    }
+  }
+  refreshVisible();
+  return true;
+}
+
+void LcdModel::execCommand(uint8_t cmd) {
+  counters.commands++;
+  if (cmd & 0x80) {                       // set DDRAM address
+    addr = cmd & 0x7F;
+  } else if (cmd & 0x40) {                // set CGRAM address (ignored)
+  } else if (cmd & 0x20) {                // function set
+  } else if (cmd & 0x10) {                // cursor/display shift (ignored)
+  } else if (cmd & 0x08) {                // display on/off control
+    dispOn = cmd & 0x04;
+  } else if (cmd & 0x04) {                // entry mode
+    increment = cmd & 0x02;
+  } else if (cmd & 0x02) {                // return home
+    addr = 0;
+    simAdvance(1520);
+  } else if (cmd & 0x01) {                // clear display
+    memset(ddram, ' ', sizeof(ddram));
+    addr = 0;
+    counters.clears++;
+    simAdvance(1520);
+  }
+}
+
+void LcdModel::writeData(uint8_t c) {
+  counters.dataBytes++;
+  if (addr < sizeof(ddram)) ddram[addr] = c;
+  addr = increment ? addr + 1 : addr - 1;
+  if (addr == 0x28) addr = 0x40;          // line 1 wraps into line 2
+  if (addr >= 0x68) addr = 0x00;
+}
+
+void LcdModel::refreshVisible() {
+  for (uint8_t r = 0; r < 2; r++) {
+    for (uint8_t c = 0; c < 16; c++) {
+      uint8_t ch = ddram[(r ? 0x40 : 0x00) + c];
+      visible[r][c] = (ch >= 0x20 && ch < 0x7F) ? static_cast<char>(ch) : '?';
+    }
+    visible[r][16] = '\0';
+  }
+}
+
+// v5 backlight driver: registers 0x06/0x07/0x08 hold R/G/B PWM.
+// Older boards (PCA9633 at 0x62) use 0x04/0x03/0x02.
+bool LcdModel::Backlight::onWrite(const uint8_t* data, size_t len) {
+  if (len < 2) return true;
+  switch (data[0]) {
+    case 0x06: case 0x04: r = data[1]; break;
+    case 0x07: case 0x03: g = data[1]; break;
+    case 0x08: case 0x02: b = data[1]; break;
+    default: break;
+  }
+  return true;
+}
+
+void LcdModel::render() const {
+  unsigned br = backlight.r, bg = backlight.g, bb = backlight.b;
+  bool lit = (br | bg | bb) != 0;
+  if (!lit) { br = bg = bb = 40; }
+  for (uint8_t r = 0; r < 2; r++) {
+    printf("  \x1b[48;2;%u;%u;%um\x1b[38;2;%u;%u;%um %s \x1b[0m\n",
+           br, bg, bb,
+           lit ? 0u : 160u, lit ? 0u : 160u, lit ? 0u : 160u,
+           dispOn ? visible[r] : "                ");
+  }
+}
+
+// =============================================================================
+// DHT20
+// =============================================================================
+
+static uint8_t crc8(const uint8_t* data, size_t len) {
+  uint8_t crc = 0xFF;
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x31) : static_cast<uint8_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+bool Dht20Model::onWrite(const uint8_t* data, size_t len) {
+  if (len >= 1 && data[0] == 0xAC) triggered = true;
+  return true;
+}
+
+size_t Dht20Model::onRead(uint8_t* data, size_t len) {
+  if (drift) {
+    double hours = simNow() / 3.6e9 + driftPhase;
+    temperature = static_cast<float>(temperatureBase + 1.5 * sin(hours * 2 * M_PI / 24.0));
+    humidity    = static_cast<float>(humidityBase + 6.0 * sin(hours * 2 * M_PI / 7.0));
+  }
+  if (dryingRate > 0.0f) {
+    double minutes = (simNow() - driedAt) / 6e7;
+    driedAt = simNow();
+    if (pumping) dried += static_cast<float>(dryingRate * minutes);
+    else         dried *= static_cast<float>(exp(-minutes / 60.0));
+  }
+  uint32_t rawHum  = static_cast<uint32_t>((humidity - dried) / 100.0f * 1048576.0f);
+  uint32_t rawTemp = static_cast<uint32_t>((temperature + 50.0f) / 200.0f * 1048576.0f);
+  if (rawHum > 0xFFFFF) rawHum = 0xFFFFF;
+  if (rawTemp > 0xFFFFF) rawTemp = 0xFFFFF;
+
+  uint8_t frame[7];
+  frame[0] = triggered ? 0x1C : 0x9C;       // bit 7: busy
+  frame[1] = static_cast<uint8_t>(rawHum >> 12);
+  frame[2] = static_cast<uint8_t>(rawHum >> 4);
+  frame[3] = static_cast<uint8_t>(((rawHum & 0x0F) << 4) | (rawTemp >> 16));
+  frame[4] = static_cast<uint8_t>(rawTemp >> 8);
+  frame[5] = static_cast<uint8_t>(rawTemp);
+  frame[6] = crc8(frame, 6);
+  triggered = false;
+
+  if (haveFrame && simFault(SIM_FAULT_DHT_STUCK)) {
+    memcpy(frame, lastFrame, sizeof(frame));        // same reading as last time
+  } else {
+    memcpy(lastFrame, frame, sizeof(frame));
+    haveFrame = true;
+  }
+  if (simFault(SIM_FAULT_DHT_CRC)) {
+    frame[1 + simFaultRandom(5)] ^= static_cast<uint8_t>(1u << simFaultRandom(8));
+  }
+
+  if (len > sizeof(frame)) len = sizeof(frame);
+  memcpy(data, frame, len);
+  return len;
+}
+
+// =============================================================================
+// SPI NOR flash (W25Q80-style command subset)
+// =============================================================================
+
+static const uint64_t NOR_PAGE_PROGRAM_US = 700;   // tPP typical
+static const uint64_t NOR_SECTOR_ERASE_US = 45000; // tSE typical
+static const uint32_t NOR_PAGE            = 256;
+static const uint32_t NOR_SECTOR          = 4096;
+
+NorFlashModel::NorFlashModel(uint32_t size) : mem(size, 0xFF) {}
+
+NorFlashModel::~NorFlashModel() {
+  if (file) fclose(file);
+}
+
+bool NorFlashModel::open(const char* path) {
+  file = fopen(path, "r+b");
+  if (file) {
+    size_t n = fread(mem.data(), 1, mem.size(), file);
+    (void)n;
+  } else {
+    file = fopen(path, "w+b");
+    if (!file) return false;
+  }
+  persist(0, static_cast<uint32_t>(mem.size()));  // size a new or short file
+  return true;
+}
+
+void NorFlashModel::persist(uint32_t at, uint32_t len) {
+  if (!file) return;
+  fseek(file, static_cast<long>(at), SEEK_SET);
+  fwrite(&mem[at], 1, len, file);
+  fflush(file);
+}
+
+bool NorFlashModel::busy() const { return simNow() < busyUntil; }
+
+void NorFlashModel::select() {
+  pos = 0;
+  addr = 0;
+  programData.clear();
+}
+
+uint8_t NorFlashModel::transfer(uint8_t mosi) {
+  uint32_t i = pos++;
+  if (i == 0) {
+    cmd = mosi;
+    if (busy() && cmd != 0x05) counters.violations++;
+    return 0xFF;
+  }
+  if (busy() && cmd != 0x05) return 0xFF;  // ignored until ready
+
+  switch (cmd) {
+    case 0x05:                             // read status register 1
+      if (busy()) counters.busyPolls++;
+      return (busy() ? 0x01 : 0x00) | (writeEnabled ? 0x02 : 0x00);
+    case 0x9F: {                           // JEDEC ID
+      uint8_t log2size = 0;
+      while ((1UL << log2size) < mem.size()) log2size++;
+      const uint8_t id[3] = { 0xEF, 0x40, log2size };
+      return i <= 3 ? id[i - 1] : 0xFF;
+    }
+    case 0x03:                             // read
+    case 0x02:                             // page program
+    case 0x20:                             // sector erase
+      if (i <= 3) {
+        addr = (addr << 8) | mosi;
+        return 0xFF;
+      }
+      if (cmd == 0x03) return mem[(addr + (i - 4)) % mem.size()];
+      if (cmd == 0x02) programData.push_back(mosi);
+      return 0xFF;
+    default:
+      return 0xFF;
+  }
+}
+
+void NorFlashModel::deselect() {
+  if (busy() && cmd != 0x05) return;
+  addr %= mem.size();
+
+  switch (cmd) {
+    case 0x06: writeEnabled = true; break;
+    case 0x04: writeEnabled = false; break;
+    case 0x02:
+      if (!writeEnabled) { counters.violations++; break; }
+      if (pos < 4) break;
+      // Programming wraps inside the 256-byte page and can only clear bits
+      for (size_t k = 0; k < programData.size(); k++) {
+        uint32_t a = (addr & ~(NOR_PAGE - 1)) | ((addr + k) & (NOR_PAGE - 1));
+        if (programData[k] & ~mem[a]) counters.violations++;
+        mem[a] &= programData[k];
+      }
+      persist(addr & ~(NOR_PAGE - 1), NOR_PAGE);
+      counters.programs++;
+      counters.programBytes += programData.size();
+      busyUntil = simNow() + NOR_PAGE_PROGRAM_US;
+      writeEnabled = false;
+      break;
+    case 0x20: {
+      if (!writeEnabled) { counters.violations++; break; }
+      if (pos < 4) break;
+      uint32_t base = addr & ~(NOR_SECTOR - 1);
+      memset(&mem[base], 0xFF, NOR_SECTOR);
+      persist(base, NOR_SECTOR);
+      counters.erases++;
+      busyUntil = simNow() + NOR_SECTOR_ERASE_US;
+      writeEnabled = false;
+      break;
+    }
+    default:
+      break;
+  }
+}
@@ -0,0 +1,129 @@
+// =============================================================================
+// Simulated peripherals
+// =============================================================================
+// LcdModel     — JHD1313 (HD44780 behind an I2C bridge) at 0x3E plus the
+//                backlight LED driver at 0x30; decodes the command stream,
+//                keeps the 16x2 contents and counts bus work.
+// Dht20Model   — DHT20 at 0x38 producing a slowly drifting climate.
+// NorFlashModel — W25Q-style SPI NOR flash, optionally backed by a file,
+//                with NOR program/erase semantics and busy times.
+// =============================================================================
+
+#pragma once
+
+#include "SPI.h"
+#include "Wire.h"
+
+#include <stdio.h>
+#include <vector>
+
+// Display traffic counters (cumulative since boot).
+struct LcdStats {
+  unsigned long transactions;
+  unsigned long commands;
+  unsigned long dataBytes;
+  unsigned long clears;
+};
+
+class LcdModel : public SimI2cDevice {
+public:
+  LcdModel();
+
+  bool onWrite(const uint8_t* data, size_t len) override;
+  size_t onRead(uint8_t*, size_t) override { return 0; }
+
+  // 16 visible characters per row, NUL terminated.
+  const char* row(uint8_t r) const { return visible[r]; }
+  bool displayOn() const { return dispOn; }
+  const LcdStats& stats() const { return counters; }
+
+  // Backlight LED driver, attached at its own bus address.
+  class Backlight : public SimI2cDevice {
+  public:
+    bool onWrite(const uint8_t* data, size_t len) override;
+    size_t onRead(uint8_t*, size_t) override { return 0; }
+    uint8_t r = 0, g = 0, b = 0;
+  } backlight;
+
+  // Render the current screen with ANSI colors to stdout.
+  void render() const;
+
+private:
+  void execCommand(uint8_t cmd);
+  void writeData(uint8_t c);
+  void refreshVisible();
+
+  uint8_t ddram[0x68];
+  uint8_t addr = 0;
+  bool    increment = true;
+  bool    dispOn = false;
+  char    visible[2][17];
+  LcdStats counters = {};
+};
+
+class Dht20Model : public SimI2cDevice {
+public:
+  bool onWrite(const uint8_t* data, size_t len) override;
+  size_t onRead(uint8_t* data, size_t len) override;
+
+  // Current true climate; drifts with time when drift is enabled, around
+  // the base values (daily for temperature, weekly-ish for humidity).
+  float temperature = 12.0f;
+  float humidity = 78.0f;
+  bool  drift = true;
+  float temperatureBase = 12.0f;
+  float humidityBase = 78.0f;
+  double driftPhase = 0.0;    // hours added to the clock
+
+  // Effect of the pump: while pumping, humidity falls by dryingRate %RH per
+  // minute; afterwards it recovers towards the drift with a 1 h time constant.
+  float dryingRate = 0.0f;
+  bool  pumping = false;
+
+private:
+  float    dried = 0.0f;      // %RH below the drift
+  uint64_t driedAt = 0;       // when dried was last brought up to date
+  bool    triggered = false;
+  bool    haveFrame = false;
+  uint8_t lastFrame[7];     // for stuck-value faults
+};
+
+// Flash traffic counters (cumulative since boot).
+struct NorFlashStats {
+  unsigned long programs;
+  unsigned long programBytes;
+  unsigned long erases;
+  unsigned long busyPolls;   // status reads that found the chip busy
+  unsigned long violations;  // commands while busy or without write enable,
+                             // programs that tried to set a 0 bit back to 1
+};
+
+class NorFlashModel : public SimSpiDevice {
+public:
+  explicit NorFlashModel(uint32_t size = 1UL << 20);
+  ~NorFlashModel();
+
+  // Back the array with a file; created erased if missing. Every program
+  // and erase is written through, so an interrupted run can be resumed.
+  bool open(const char* path);
+
+  void select() override;
+  uint8_t transfer(uint8_t mosi) override;
+  void deselect() override;
+
+  const NorFlashStats& stats() const { return counters; }
+
+private:
+  bool busy() const;
+  void persist(uint32_t addr, uint32_t len);
+
+  std::vector<uint8_t> mem;
+  FILE*    file = nullptr;
+  uint8_t  cmd = 0;
+  uint32_t pos = 0;           // bytes clocked in this transaction
+  uint32_t addr = 0;
+  bool     writeEnabled = false;
+  uint64_t busyUntil = 0;
+  std::vector<uint8_t> programData;
+  NorFlashStats counters = {};
+};
@@ -0,0 +1,123 @@
+// =============================================================================
+// Fault injection
+// =============================================================================
+
+#include "sim_faults.h"
+#include "sim.h"
+#include "EEPROM.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+struct FaultWindow {
+  SimFaultKind kind;
+  double       rate;
+  uint64_t     from;   // us
+  uint64_t     until;  // us, exclusive
+};
+
+static const char* const NAMES[SIM_FAULT_KINDS] = {
+  "i2c-nak", "i2c-hang", "dht-crc", "dht-stuck", "eeprom", "serial", "chatter",
+};
+
+static std::vector<FaultWindow> schedule;
+static unsigned long counts[SIM_FAULT_KINDS];
+static uint32_t rng = 0x2545F491;
+static uint64_t lastTick = 0;
+
+uint32_t simFaultRandom(uint32_t n) {
+  // xorshift32
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return n ? rng % n : 0;
+}
+
+static double uniform() { return simFaultRandom(1u << 30) / static_cast<double>(1u << 30); }
+
+void simFaultSeed(uint32_t seed) { rng = seed ? seed : 1; }
+
+static void add(SimFaultKind kind, double rate, double from, double until) {
+  schedule.push_back({ kind, rate, static_cast<uint64_t>(from * 1e6),
+                       until > 0 ? static_cast<uint64_t>(until * 1e6) : UINT64_MAX });
+}
+
+bool simFaultParse(const char* spec) {
+  const char* colon = strchr(spec, ':');
+  if (!colon) return false;
+  size_t nameLen = static_cast<size_t>(colon - spec);
+  for (uint8_t k = 0; k < SIM_FAULT_KINDS; k++) {
+    if (strlen(NAMES[k]) != nameLen || strncmp(spec, NAMES[k], nameLen) != 0) continue;
+    char* end;
+    double rate = strtod(colon + 1, &end);
+    double from = 0, until = 0;
+    if (*end == ':') from = strtod(end + 1, &end);
+    if (*end == ':') until = strtod(end + 1, &end);
+    if (*end != '\0' || rate < 0) return false;
+    add(static_cast<SimFaultKind>(k), rate, from, until);
+    return true;
+  }
+  return false;
+}
+
+bool simFaultProfile(const char* name) {
+  if (strcmp(name, "standard") != 0) return false;
+  add(SIM_FAULT_I2C_NAK,   0.01,   0, 0);
+  add(SIM_FAULT_I2C_HANG,  0.0005, 0, 0);
+  add(SIM_FAULT_DHT_CRC,   0.05,   0, 0);
+  add(SIM_FAULT_DHT_STUCK, 1.0,    1800, 2400);  // stuck for 10 minutes
+  add(SIM_FAULT_EEPROM,    1 / 3600.0, 0, 0);    // about one bit flip an hour
+  add(SIM_FAULT_SERIAL,    0.2,    0, 0);
+  add(SIM_FAULT_CHATTER,   0.5,    0, 0);
+  return true;
+}
+
+// Combined rate of the windows of this kind open now.
+static double rateNow(SimFaultKind kind) {
+  uint64_t now = simNow();
+  double rate = 0;
+  for (const FaultWindow& w : schedule) {
+    if (w.kind == kind && now >= w.from && now < w.until) rate += w.rate;
+  }
+  return rate;
+}
+
+bool simFault(SimFaultKind kind) {
+  double rate = rateNow(kind);
+  if (rate <= 0 || (rate < 1 && uniform() >= rate)) return false;
+  counts[kind]++;
+  return true;
+}
+
+void simFaultTick() {
+  uint64_t now = simNow();
+  double seconds = (now - lastTick) / 1e6;
+  lastTick = now;
+
+  // At most one event per kind per pass; passes are far shorter than the
+  // mean time between events
+  double eeprom = rateNow(SIM_FAULT_EEPROM);
+  if (eeprom > 0 && uniform() < 1 - exp(-eeprom * seconds)) {
+    EEPROM.raw()[simFaultRandom(SIM_EEPROM_SIZE)] ^= static_cast<uint8_t>(1u << simFaultRandom(8));
+    counts[SIM_FAULT_EEPROM]++;
+  }
+  double serial = rateNow(SIM_FAULT_SERIAL);
+  if (serial > 0 && uniform() < 1 - exp(-serial * seconds)) {
+    char garbage[2] = { static_cast<char>(1 + simFaultRandom(255)), '\0' };
+    simSerialInject(garbage);
+    counts[SIM_FAULT_SERIAL]++;
+  }
+}
+
+bool simFaultScheduled(SimFaultKind kind) {
+  for (const FaultWindow& w : schedule) {
+    if (w.kind == kind) return true;
+  }
+  return false;
+}
+
+unsigned long simFaultCount(SimFaultKind kind) { return counts[kind]; }
+
+const char* simFaultName(SimFaultKind kind) { return NAMES[kind]; }
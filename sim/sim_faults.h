@@ -0,0 +1,58 @@
+// =============================================================================
+// Fault injection
+// =============================================================================
+// A schedule of faults the simulated hardware consults as it runs. Each
+// entry is a fault kind, a rate and an optional time window:
+//
+//   i2c-nak     a transaction is not acknowledged      (chance per transaction)
+//   i2c-hang    the bus hangs until the Wire timeout   (chance per transaction)
+//   dht-crc     a DHT20 frame fails its CRC            (chance per read)
+//   dht-stuck   the DHT20 repeats its last frame       (chance per read)
+//   eeprom      a bit flips in a random EEPROM byte    (events per second)
+//   serial      a random byte arrives on the serial RX (events per second)
+//   chatter     the button bounces on press/release    (chance per edge)
+//
+// Random draws come from a seeded generator, so a run with the same options
+// injects the same faults at the same times.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+enum SimFaultKind : uint8_t {
+  SIM_FAULT_I2C_NAK,
+  SIM_FAULT_I2C_HANG,
+  SIM_FAULT_DHT_CRC,
+  SIM_FAULT_DHT_STUCK,
+  SIM_FAULT_EEPROM,
+  SIM_FAULT_SERIAL,
+  SIM_FAULT_CHATTER,
+  SIM_FAULT_KINDS
+};
+
+// Wire timeout a hung transaction costs (AVR Wire default, 25 ms)
+const uint64_t SIM_I2C_HANG_US = 25000;
+
+// Add "kind:rate[:from[:until]]" (times in seconds). False if malformed.
+bool simFaultParse(const char* spec);
+
+// Add a named set of faults ("standard"). False if the name is unknown.
+bool simFaultProfile(const char* name);
+
+void simFaultSeed(uint32_t seed);
+
+// One opportunity for a fault of this kind at the current time; true (and
+// counted) if it strikes.
+bool simFault(SimFaultKind kind);
+
+// Time-based faults (EEPROM bit flips, serial garbage) since the last call.
+// Called once per loop pass.
+void simFaultTick();
+
+// Uniform random number in [0, n), from the fault generator.
+uint32_t simFaultRandom(uint32_t n);
+
+bool          simFaultScheduled(SimFaultKind kind);
+unsigned long simFaultCount(SimFaultKind kind);
+const char*   simFaultName(SimFaultKind kind);
@@ -0,0 +1,441 @@
+// =============================================================================
+// Fleet simulation
+// =============================================================================
+
+#include "sim_fleet.h"
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "sim.h"
+#include "sim_devices.h"
+#include "sim_faults.h"
+#include "crc16.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static const uint8_t  RELAY_PIN = 4;
+static const uint8_t  RS485_DE_PIN = 5;
+static const uint32_t COLLISION_MS = 1000;   // starts this close count as together
+static const unsigned BUS_NODES_MAX = 247;   // BUS_ADDRESS_MAX
+static const uint16_t BUS_PASS_MAX = 512;    // bytes one node can send per pass
+
+// The firmware's fallback layout: magic, then the preset index
+static const uint8_t LEGACY_MAGIC = 0xC7;
+
+// Bus mode gives every controller a config blob instead, in the layout of
+// encodeConfig() (see also tools/cellarcfg.py), cut short after the bus
+// fields; the alarm and demand fields keep their defaults
+static const uint8_t  CONFIG_VERSION = 1;
+static const uint32_t DEFAULT_GREEN_THRESHOLD = 5 * 60000;
+static const uint32_t DEFAULT_PRESETS[][2] = {
+  { 60000, 30 * 60000 }, { 60000, 2 * 3600000 }, { 60000, 6 * 3600000 }, { 60000, 24 * 3600000 },
+  { 60000, 60000 },      { 60000, 4 * 60000 },   { 60000, 10 * 60000 },
+};
+
+struct Controller {
+  uint64_t bootUs;       // site time
+  uint8_t  preset;
+  float    temperatureBase;
+  float    humidityBase;
+  double   driftPhase;   // hours
+};
+
+// One per controller in shared memory, followed by `capacity` switch times
+// (site ms; even entries switch on, odd ones off)
+struct SwitchLog {
+  uint32_t count;
+  uint8_t  overflow;
+  uint8_t  done;
+};
+
+// Bus mode: the shared line. Each pass, every node puts what it sent (DE
+// high) in its own outbox; after the pass barrier the others read it, so a
+// frame arrives one pass after it went out. Outboxes and driver counts
+// rotate over three passes: one being written, one being read, and one
+// that node 0 clears for the next pass.
+struct Outbox {
+  uint16_t len;
+  uint8_t  data[BUS_PASS_MAX];
+};
+
+struct FleetBus {
+  pthread_barrier_t pass;
+  uint32_t drivers[3];     // nodes that sent in the pass
+  uint32_t driver[3];      // one of them
+  uint32_t trafficPasses;  // passes in which one node sent (counted by node 0)
+  uint32_t collisions;     // passes in which several did
+  uint32_t overruns;       // bytes beyond BUS_PASS_MAX, dropped
+};
+
+static uint32_t nextRandom(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+static double uniform(uint32_t& state) {
+  return (nextRandom(state) >> 8) / static_cast<double>(1u << 24);
+}
+
+static void putLe(uint8_t*& p, uint32_t v, int bytes) {
+  while (bytes--) {
+    *p++ = v & 0xFF;
+    v >>= 8;
+  }
+}
+
+// Config slot 0: sequence byte, then the blob
+static void writeBusConfig(const FleetOptions& o, unsigned index, const Controller& c) {
+  uint8_t* cell = EEPROM.raw();
+  uint8_t* blob = cell + 1;
+  uint8_t* p = blob;
+  *p++ = 'C';
+  *p++ = 'P';
+  *p++ = CONFIG_VERSION;
+  uint8_t* payloadLen = p++;
+  putLe(p, c.preset, 1);
+  putLe(p, 0, 1);                          // SCHEDULE_TIMED
+  putLe(p, DEFAULT_GREEN_THRESHOLD, 4);
+  putLe(p, 0, 2);                          // temperature offset
+  putLe(p, 0, 2);                          // humidity offset
+  for (const auto& t : DEFAULT_PRESETS) {
+    putLe(p, t[0], 4);
+    putLe(p, t[1], 4);
+  }
+  putLe(p, index + 1, 1);                  // address; 1 is the coordinator
+  putLe(p, o.controllers, 1);              // nodes, used by the coordinator
+  *payloadLen = static_cast<uint8_t>(p - blob - 4);
+  putLe(p, crc16(blob, p - blob), 2);
+  cell[0] = 1;
+}
+
+// Hand the bytes the other nodes sent in the previous pass to this node's
+// serial port. Several senders at once garble each other: the node gets
+// the bitwise AND of their bytes, which fails the frame CRC as on the line.
+static void busDeliver(FleetBus* bus, Outbox* boxes, const FleetOptions& o, unsigned index,
+                       uint64_t pass, int line) {
+  unsigned slot = (pass + 2) % 3;
+  uint32_t drivers = bus->drivers[slot];
+  if (index == 0) {
+    if (drivers == 1) bus->trafficPasses++;
+    else if (drivers > 1) bus->collisions++;
+    bus->drivers[(pass + 1) % 3] = 0;
+  }
+  if (drivers == 0 || line < 0) return;
+  Outbox* sent = boxes + slot * o.controllers;
+  if (sent[index].len) return;  // our receiver was off while we drove the line
+  uint8_t heard[BUS_PASS_MAX];
+  uint16_t len = 0;
+  if (drivers == 1) {
+    const Outbox& from = sent[bus->driver[slot]];
+    len = from.len;
+    memcpy(heard, from.data, len);
+  } else {
+    memset(heard, 0xFF, sizeof(heard));
+    for (unsigned i = 0; i < o.controllers; i++) {
+      for (uint16_t k = 0; k < sent[i].len; k++) heard[k] &= sent[i].data[k];
+      len = std::max(len, sent[i].len);
+    }
+  }
+  ssize_t n = ::write(line, heard, len);
+  (void)n;
+}
+
+// Collect what this node sent during the pass
+static void busCollect(FleetBus* bus, Outbox* boxes, const FleetOptions& o, unsigned index,
+                       uint64_t pass, int line) {
+  unsigned slot = pass % 3;
+  Outbox& box = boxes[slot * o.controllers + index];
+  box.len = 0;
+  if (line < 0) return;
+  uint8_t buf[256];
+  ssize_t n;
+  while ((n = ::read(line, buf, sizeof(buf))) > 0) {
+    uint16_t room = BUS_PASS_MAX - box.len;
+    uint16_t take = std::min<uint16_t>(room, static_cast<uint16_t>(n));
+    memcpy(box.data + box.len, buf, take);
+    box.len += take;
+    if (take < n) __atomic_add_fetch(&bus->overruns, static_cast<uint32_t>(n - take), __ATOMIC_RELAXED);
+  }
+  if (box.len) {
+    __atomic_add_fetch(&bus->drivers[slot], 1, __ATOMIC_RELAXED);
+    bus->driver[slot] = index;
+  }
+}
+
+static void attachDevices(const FleetOptions& o, unsigned index, const Controller& c,
+                          LcdModel& lcd, Dht20Model& dht) {
+  dht.temperatureBase = c.temperatureBase;
+  dht.humidityBase = c.humidityBase;
+  dht.driftPhase = c.driftPhase;
+  simI2cAttach(0x3E, &lcd);
+  simI2cAttach(0x30, &lcd.backlight);
+  simI2cAttach(0x38, &dht);
+  simFaultSeed(o.seed * 7919u + index + 1);
+}
+
+// Bus mode: runs in the forked child, in lockstep with every other node.
+// Each pass ends at the same site time for all of them; a node whose pass
+// took longer (EEPROM waits, I2C) carries the overrun into the next one.
+static void runBusNode(const FleetOptions& o, unsigned index, const Controller& c,
+                       SwitchLog* log, uint32_t* switches, uint32_t capacity,
+                       FleetBus* bus, Outbox* boxes) {
+  writeBusConfig(o, index, c);
+  LcdModel lcd;
+  Dht20Model dht;
+  attachDevices(o, index, c, lcd, dht);
+
+  int ends[2] = { -1, -1 };
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends) == 0) {
+    fcntl(ends[0], F_SETFL, O_NONBLOCK);
+    fcntl(ends[1], F_SETFL, O_NONBLOCK);
+    simSerialBus(ends[0], RS485_DE_PIN);
+  }
+
+  const uint64_t passUs = static_cast<uint64_t>(o.passMs * 1000);
+  const uint64_t passes = static_cast<uint64_t>(o.seconds * 1e6) / passUs;
+  const uint64_t bootPass = (c.bootUs + passUs - 1) / passUs;
+  bool relay = false;
+  for (uint64_t pass = 0; pass < passes; pass++) {
+    bool powered = pass >= bootPass;
+    busDeliver(bus, boxes, o, index, pass, powered ? ends[1] : -1);
+    if (powered) {
+      if (pass == bootPass) setup();
+      if (simGetOutput(RELAY_PIN) != relay) {
+        relay = !relay;
+        uint32_t ms = static_cast<uint32_t>((bootPass * passUs + simNow()) / 1000);
+        if (log->count < capacity) switches[log->count++] = ms;
+        else log->overflow = 1;
+      }
+      simSerialBusPoll();
+      simFaultTick();
+      loop();
+      uint64_t end = (pass + 1 - bootPass) * passUs;
+      if (simNow() < end) simAdvance(end - simNow());
+    }
+    busCollect(bus, boxes, o, index, pass, powered ? ends[1] : -1);
+    pthread_barrier_wait(&bus->pass);
+  }
+  log->done = 1;
+}
+
+// Runs in the forked child, on its own copy of every global
+static void runController(const FleetOptions& o, unsigned index, const Controller& c,
+                          SwitchLog* log, uint32_t* switches, uint32_t capacity) {
+  EEPROM.raw()[0] = LEGACY_MAGIC;
+  EEPROM.raw()[1] = c.preset;
+
+  LcdModel lcd;
+  Dht20Model dht;
+  attachDevices(o, index, c, lcd, dht);
+
+  const uint64_t endUs = static_cast<uint64_t>(o.seconds * 1e6) - c.bootUs;
+  const uint64_t passUs = static_cast<uint64_t>(o.passMs * 1000);
+  bool relay = false;
+  setup();
+  while (true) {
+    if (simGetOutput(RELAY_PIN) != relay) {
+      relay = !relay;
+      if (log->count < capacity) switches[log->count++] = static_cast<uint32_t>((c.bootUs + simNow()) / 1000);
+      else log->overflow = 1;
+    }
+    if (simNow() >= endUs) break;
+    simFaultTick();
+    loop();
+    simAdvance(passUs);
+  }
+  log->done = 1;
+}
+
+int simFleetRun(const FleetOptions& o) {
+  if (o.controllers == 0 || o.seconds <= 0 || o.seconds * 1000 >= UINT32_MAX) {
+    fprintf(stderr, "fleet: need 1 or more controllers and 0 < seconds < 49 days\n");
+    return 2;
+  }
+  if (o.bus && (o.controllers > BUS_NODES_MAX || o.passMs < 1)) {
+    fprintf(stderr, "fleet: the bus takes 1 to %u controllers and --pass-ms 1 or more\n", BUS_NODES_MAX);
+    return 2;
+  }
+  unsigned workers = o.workers ? o.workers : static_cast<unsigned>(sysconf(_SC_NPROCESSORS_ONLN));
+  if (workers < 1) workers = 1;
+  if (o.bus) workers = o.controllers;  // lockstep: all at once
+  std::vector<uint8_t> presets = o.presets;
+  if (presets.empty()) presets.push_back(0);
+
+  uint32_t state = o.seed ? o.seed : 1;
+  std::vector<Controller> fleet(o.controllers);
+  for (unsigned i = 0; i < o.controllers; i++) {
+    Controller& c = fleet[i];
+    c.bootUs = static_cast<uint64_t>(uniform(state) * o.bootSpread * 1e6);
+    c.preset = presets[i % presets.size()];
+    c.temperatureBase = static_cast<float>(10.0 + 4.0 * uniform(state));
+    c.humidityBase = static_cast<float>(70.0 + 16.0 * uniform(state));
+    c.driftPhase = 24.0 * 7.0 * uniform(state);
+  }
+
+  // The fastest preset switches twice per two minutes; leave room for boot
+  const uint32_t capacity = static_cast<uint32_t>(o.seconds / 60) + 8;
+  const size_t slot = sizeof(SwitchLog) + capacity * sizeof(uint32_t);
+  const size_t slotAligned = (slot + 7) & ~static_cast<size_t>(7);
+  size_t bytes = slotAligned * o.controllers;
+  uint8_t* shared = static_cast<uint8_t*>(mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED | MAP_ANONYMOUS, -1, 0));
+  if (shared == MAP_FAILED) {
+    perror("fleet: mmap");
+    return 1;
+  }
+  auto logOf = [&](unsigned i) { return reinterpret_cast<SwitchLog*>(shared + i * slotAligned); };
+  auto switchesOf = [&](unsigned i) {
+    return reinterpret_cast<uint32_t*>(shared + i * slotAligned + sizeof(SwitchLog));
+  };
+
+  FleetBus* bus = nullptr;
+  Outbox* boxes = nullptr;
+  size_t busBytes = sizeof(FleetBus) + 3 * o.controllers * sizeof(Outbox);
+  if (o.bus) {
+    void* area = mmap(nullptr, busBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) {
+      perror("fleet: mmap");
+      return 1;
+    }
+    bus = static_cast<FleetBus*>(area);
+    boxes = reinterpret_cast<Outbox*>(bus + 1);
+    pthread_barrierattr_t attr;
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&bus->pass, &attr, o.controllers);
+    pthread_barrierattr_destroy(&attr);
+  }
+
+  auto started = std::chrono::steady_clock::now();
+  unsigned next = 0, running = 0, failed = 0;
+  std::vector<pid_t> pids;
+  fflush(nullptr);
+  while (next < o.controllers || running > 0) {
+    if (next < o.controllers && running < workers) {
+      pid_t pid = fork();
+      if (pid < 0) {
+        perror("fleet: fork");
+        for (pid_t p : pids) kill(p, SIGKILL);
+        return 1;
+      }
+      if (pid == 0) {
+        if (bus) runBusNode(o, next, fleet[next], logOf(next), switchesOf(next), capacity, bus, boxes);
+        else runController(o, next, fleet[next], logOf(next), switchesOf(next), capacity);
+        _exit(0);
+      }
+      pids.push_back(pid);
+      next++;
+      running++;
+      continue;
+    }
+    int status = 0;
+    if (wait(&status) < 0) break;
+    running--;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      failed++;
+      // The others would wait for it at the next pass barrier forever
+      if (bus) for (pid_t p : pids) kill(p, SIGKILL);
+    }
+  }
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  // Merge: +1 at every switch on, -1 at every switch off
+  struct Edge {
+    uint32_t ms;
+    int8_t   delta;
+  };
+  std::vector<Edge> edges;
+  std::vector<uint32_t> starts;
+  unsigned overflowed = 0, unfinished = 0;
+  for (unsigned i = 0; i < o.controllers; i++) {
+    const SwitchLog* log = logOf(i);
+    const uint32_t* sw = switchesOf(i);
+    if (log->overflow) overflowed++;
+    if (!log->done) unfinished++;
+    for (uint32_t k = 0; k < log->count; k++) {
+      edges.push_back({ sw[k], static_cast<int8_t>(k % 2 ? -1 : 1) });
+      if (k % 2 == 0) starts.push_back(sw[k]);
+    }
+  }
+  munmap(shared, bytes);
+  // Simultaneous on and off count as overlapping: the supply sees both
+  std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+    return a.ms != b.ms ? a.ms < b.ms : a.delta > b.delta;
+  });
+
+  FILE* load = o.loadPath ? fopen(o.loadPath, "w") : nullptr;
+  if (o.loadPath && !load) fprintf(stderr, "cannot open %s\n", o.loadPath);
+  const uint32_t endMs = static_cast<uint32_t>(o.seconds * 1000);
+  std::vector<double> timeAt(1, 0.0);   // ms spent with exactly k pumps on
+  int on = 0, peak = 0;
+  uint32_t peakMs = 0, lastMs = 0;
+  for (size_t e = 0; e < edges.size(); e++) {
+    timeAt[on] += edges[e].ms - lastMs;
+    lastMs = edges[e].ms;
+    on += edges[e].delta;
+    if (on >= static_cast<int>(timeAt.size())) timeAt.resize(on + 1, 0.0);
+    if (on > peak) {
+      peak = on;
+      peakMs = lastMs;
+    }
+    bool last = e + 1 == edges.size() || edges[e + 1].ms != lastMs;
+    if (load && last) fprintf(load, "%lu,%d\n", static_cast<unsigned long>(lastMs), on);
+  }
+  timeAt[on] += endMs - lastMs;
+  if (load) fclose(load);
+
+  double pumpMs = 0;
+  for (size_t k = 1; k < timeAt.size(); k++) pumpMs += k * timeAt[k];
+
+  std::sort(starts.begin(), starts.end());
+  size_t together = 0;
+  for (size_t i = 0; i < starts.size(); i++) {
+    bool before = i > 0 && starts[i] - starts[i - 1] < COLLISION_MS;
+    bool after = i + 1 < starts.size() && starts[i + 1] - starts[i] < COLLISION_MS;
+    if (before || after) together++;
+  }
+
+  printf("fleet: %u controllers, %u workers, %.0f s simulated in %.1f s\n",
+         o.controllers, workers, o.seconds, wall);
+  if (failed || unfinished || overflowed) {
+    printf("fleet: %u failed, %u unfinished, %u ran out of switch log\n", failed, unfinished, overflowed);
+  }
+  if (bus) {
+    printf("bus: addresses 1-%u, %lu passes carried a frame, %lu had several senders",
+           o.controllers, static_cast<unsigned long>(bus->trafficPasses),
+           static_cast<unsigned long>(bus->collisions));
+    if (bus->overruns) printf(", %lu bytes dropped", static_cast<unsigned long>(bus->overruns));
+    printf("\n");
+    pthread_barrier_destroy(&bus->pass);
+    munmap(bus, busBytes);
+  }
+  printf("runs: %zu, %.1f pump-hours\n", starts.size(), pumpMs / 3.6e6);
+  printf("load: mean %.2f pumps on, peak %d at %.1f s (%.0f W at %.1f W each)\n",
+         pumpMs / endMs, peak, peakMs / 1000.0, peak * o.pumpWatts, o.pumpWatts);
+  std::string shares;
+  for (int k = 1; k <= peak; k *= 2) {
+    double atLeast = 0;
+    for (size_t j = k; j < timeAt.size(); j++) atLeast += timeAt[j];
+    char item[40];
+    snprintf(item, sizeof(item), "%s%d+ on %.3g%%", shares.empty() ? "" : ", ", k, 100.0 * atLeast / endMs);
+    shares += item;
+  }
+  if (!shares.empty()) printf("load: %s of the time\n", shares.c_str());
+  printf("starts: %zu within %.0f s of another start\n", together, COLLISION_MS / 1000.0);
+  return failed || unfinished ? 1 : 0;
+}
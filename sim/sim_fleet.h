@@ -0,0 +1,49 @@
+// =============================================================================
+// Fleet simulation
+// =============================================================================
+// Runs many controllers over the same stretch of site time and reports what
+// they add up to: how many pumps run at once (power supply sizing) and how
+// often runs start together.
+//
+// Every controller is the unmodified firmware in a fork()ed copy of this
+// process, so each starts from pristine globals and its own simulated
+// hardware; `workers` copies run at a time, one per host core by default.
+// Each copy records its relay switches in shared memory, and the parent
+// merges them onto the common clock once all have finished.
+//
+// Controllers differ in preset (assigned round robin), boot time (uniform
+// over bootSpread seconds; each boot starts a run, as after a power cut) and
+// climate (sensor base values and drift phase), all drawn from the seed.
+//
+// Without `bus` the controllers know nothing of each other: each runs on its
+// own clock and is not on a bus, so the report shows what unsynchronised
+// units add up to. With `bus`, controller i gets a config with bus address
+// i + 1 (1 is the coordinator) and busNodes = controllers, and all of them
+// run at once in lockstep, one loop() pass per barrier on a shared site
+// clock. What a node sends with DE high reaches the others' serial ports
+// at the next pass; several senders in one pass garble each other. Clock
+// sync, run staggering and bus contention are then part of the result. The
+// line itself is idealised: a frame takes one pass whatever its length, and
+// the controllers' crystals do not drift.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+struct FleetOptions {
+  unsigned    controllers = 0;
+  unsigned    workers = 0;           // 0 = one per host core
+  double      seconds = 3600;        // site time
+  double      bootSpread = 0;        // seconds
+  double      passMs = 10;           // simulated time per loop() pass
+  double      pumpWatts = 4.8;
+  uint32_t    seed = 1;
+  std::vector<uint8_t> presets;      // preset indexes, round robin (default: 0)
+  const char* loadPath = nullptr;    // "<ms>,<pumps on>" at every change
+  bool        bus = false;           // all on one RS-485 bus, in lockstep
+};
+
+// Run the fleet and print the report. Returns the process exit code.
+int simFleetRun(const FleetOptions& options);
@@ -0,0 +1,485 @@
+// =============================================================================
+// Cellar Pump Controller — native simulator entry point
+// =============================================================================
+// Runs setup()/loop() from src/main.cpp against simulated peripherals on a
+// virtual clock, much faster than real time.
+//
+// Usage: program [options]
+//   --seconds N         simulated run time (default 3600)
+//   --render            draw the LCD (ANSI colors) whenever it changes
+//   --live              like --render, but redraw in place at the top of
+//                       the terminal, paced to real time
+//   --frames            print every new screen as one plain-text line:
+//                       "<ms> <r>,<g>,<b> |<row 0>|<row 1>|" — deterministic,
+//                       so two runs can be diffed byte for byte
+//   --quiet             hide the firmware's serial output
+//   --press T           press the preset button at T seconds (repeatable)
+//   --float A:B         raise the float switch (pull D6 low) from A to B
+//                       seconds (repeatable)
+//   --send T:TEXT       type TEXT + newline on the serial port at T seconds
+//   --eeprom FILE       load/save EEPROM contents from/to FILE
+//   --flash FILE        attach a 1 MB SPI NOR flash on D10, backed by FILE
+//   --power-fail T      pull the power-fail input (D2) low from T seconds on
+//   --unplug DEV:T      disconnect DEV (lcd or sensor) from the I2C bus at T
+//                       seconds (0 = missing from boot; repeatable)
+//   --plug DEV:T        reconnect DEV at T seconds (repeatable)
+//   --fault K:R[:A[:B]] inject faults of kind K at rate R, from A to B
+//                       seconds (repeatable; kinds and rates in sim_faults.h)
+//   --faults standard   inject the standard fault profile
+//   --seed N            seed for the fault generator
+//   --trace FILE        write a timeline (Chrome trace-event JSON, for
+//                       Perfetto or chrome://tracing) of the firmware's
+//                       TRACE_SCOPE spans, delays, I2C transactions and
+//                       relay switches; see sim_trace.h
+//   --drying R          pump runs lower the humidity by R %RH per minute
+//                       of pumping, recovering over about an hour
+//   --bus-pty           put the serial port on an RS-485 bus through a
+//                       pseudo-terminal, whose path is printed on stderr;
+//                       runs in real time, so several simulators can be
+//                       wired together with tools/rs485hub.py
+//
+// Fleet mode (see sim_fleet.h) runs N controllers instead of one and prints
+// their combined pump load; --seconds, --seed and --fault(s) apply to all:
+//   --fleet N           number of controllers
+//   --workers K         controllers simulated at once (default: host cores)
+//   --presets LIST      presets as on the LCD, e.g. 1,2,7, assigned round
+//                       robin (default 1)
+//   --boot-spread S     boot times spread over S seconds (default 0)
+//   --pass-ms N         simulated time per loop() pass (default 10)
+//   --pump-watts W      power of one pump (default 4.8)
+//   --load FILE         write "<ms>,<pumps on>" at every change
+//   --bus               put them on one simulated RS-485 bus, addresses
+//                       1..N, on a shared clock (at most 247; --workers is
+//                       ignored, all run at once)
+//
+// The end-of-run report includes loop() latency (percentiles of the time
+// one pass takes) and how late the relay switched against its schedule.
+//   --stats N           print bus/display rates every N simulated seconds
+// =============================================================================
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "sim.h"
+#include "sim_devices.h"
+#include "sim_faults.h"
+#include "sim_fleet.h"
+#include "sim_trace.h"
+#include "relay_timing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+void setup();
+void loop();
+
+static const uint8_t  SIM_BUTTON_PIN     = 3;
+static const uint8_t  SIM_FLOAT_PIN      = 6;
+static const uint8_t  SIM_RELAY_PIN      = 4;
+static const uint8_t  SIM_POWER_FAIL_PIN = 2;
+static const uint8_t  SIM_FLASH_CS_PIN   = 10;
+static const uint8_t  SIM_RS485_DE_PIN   = 5;
+static const uint64_t LOOP_OVERHEAD_US   = 100;   // cost of one bare loop() pass
+static const uint64_t PRESS_LENGTH_US    = 150000;
+static const uint64_t BOUNCE_MAX_US      = 10000;   // longest contact bounce
+
+struct SerialEvent {
+  uint64_t    at;
+  std::string text;
+};
+
+struct FloatSpan {
+  uint64_t from;
+  uint64_t to;
+};
+
+struct PlugEvent {
+  uint64_t    at;
+  std::string device;
+  bool        connect;
+};
+
+// Pass-time histogram: exact below 16 us, then 16 buckets per power of
+// two (within ~6%), so runs of any length take the same memory
+struct LatencyHistogram {
+  uint64_t counts[29 * 16] = {};
+  uint64_t passes = 0;
+  double   totalUs = 0;
+  uint32_t maxUs = 0;
+
+  static size_t bucket(uint32_t us) {
+    if (us < 16) return us;
+    int e = 31 - __builtin_clz(us);
+    return static_cast<size_t>(e - 3) * 16 + ((us >> (e - 4)) & 15);
+  }
+  // Upper end of a bucket
+  static uint32_t limit(size_t b) {
+    if (b < 16) return static_cast<uint32_t>(b);
+    int e = static_cast<int>(b / 16) + 3;
+    return ((16u + b % 16 + 1) << (e - 4)) - 1;
+  }
+
+  void add(uint32_t us) {
+    counts[bucket(us)]++;
+    passes++;
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+
+  uint32_t percentile(double p) const {
+    uint64_t rank = static_cast<uint64_t>(p * (passes - 1));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < sizeof(counts) / sizeof(counts[0]); b++) {
+      seen += counts[b];
+      if (seen > rank) return std::min(limit(b), maxUs);
+    }
+    return maxUs;
+  }
+};
+
+static void usage() {
+  fprintf(stderr,
+          "usage: program [--seconds N] [--render] [--live] [--frames] [--quiet]\n"
+          "               [--press T]... [--float A:B]...\n"
+          "               [--send T:TEXT]... [--eeprom FILE] [--flash FILE] [--stats N]\n"
+          "               [--power-fail T] [--unplug DEV:T]... [--plug DEV:T]...\n"
+          "               [--fault K:R[:A[:B]]]... [--faults standard] [--seed N]\n"
+          "               [--trace FILE] [--drying R] [--bus-pty]\n"
+          "       program --fleet N [--workers K] [--presets LIST] [--boot-spread S]\n"
+          "               [--pass-ms N] [--pump-watts W] [--load FILE] [--bus] [--seconds N]\n");
+}
+
+static void loadEeprom(const char* path) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return;
+  size_t n = fread(EEPROM.raw(), 1, SIM_EEPROM_SIZE, f);
+  (void)n;
+  fclose(f);
+}
+
+static void saveEeprom(const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (!f) return;
+  fwrite(EEPROM.raw(), 1, SIM_EEPROM_SIZE, f);
+  fclose(f);
+}
+
+// Open a pseudo-terminal for the bus and print the path of its other end.
+// That end is kept open in raw mode, so bytes pass unchanged, nothing is
+// echoed back, and writes before a hub attaches are simply buffered.
+static int openBusPty() {
+  int fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) return -1;
+  const char* path = ptsname(fd);
+  int peer = path ? open(path, O_RDWR | O_NOCTTY) : -1;
+  if (peer < 0) return -1;
+  termios t;
+  tcgetattr(peer, &t);
+  cfmakeraw(&t);
+  tcsetattr(peer, TCSANOW, &t);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  fprintf(stderr, "bus: %s\n", path);
+  return fd;
+}
+
+int main(int argc, char** argv) {
+  double seconds = 3600;
+  double statsEvery = 0;
+  bool render = false;
+  bool live = false;
+  bool frames = false;
+  const char* eepromPath = nullptr;
+  const char* flashPath = nullptr;
+  const char* tracePath = nullptr;
+  uint64_t powerFailAt = UINT64_MAX;
+  std::vector<uint64_t> presses;
+  std::vector<FloatSpan> floats;
+  std::vector<SerialEvent> sends;
+  std::vector<PlugEvent> plugs;
+  float dryingRate = 0.0f;
+  bool busPty = false;
+  FleetOptions fleet;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--seconds" && hasValue)      seconds = atof(argv[++i]);
+    else if (arg == "--render")              render = true;
+    else if (arg == "--live")                render = live = true;
+    else if (arg == "--frames")              frames = true;
+    else if (arg == "--quiet")               simSerialEcho(false);
+    else if (arg == "--press" && hasValue)   presses.push_back(static_cast<uint64_t>(atof(argv[++i]) * 1e6));
+    else if (arg == "--eeprom" && hasValue)  eepromPath = argv[++i];
+    else if (arg == "--flash" && hasValue)   flashPath = argv[++i];
+    else if (arg == "--power-fail" && hasValue) powerFailAt = static_cast<uint64_t>(atof(argv[++i]) * 1e6);
+    else if (arg == "--stats" && hasValue)   statsEvery = atof(argv[++i]);
+    else if (arg == "--trace" && hasValue)   tracePath = argv[++i];
+    else if (arg == "--drying" && hasValue)  dryingRate = static_cast<float>(atof(argv[++i]));
+    else if (arg == "--bus-pty")             busPty = true;
+    else if (arg == "--seed" && hasValue) {
+      fleet.seed = static_cast<uint32_t>(atol(argv[++i]));
+      simFaultSeed(fleet.seed);
+    }
+    else if (arg == "--fleet" && hasValue)   fleet.controllers = static_cast<unsigned>(atol(argv[++i]));
+    else if (arg == "--workers" && hasValue) fleet.workers = static_cast<unsigned>(atol(argv[++i]));
+    else if (arg == "--boot-spread" && hasValue) fleet.bootSpread = atof(argv[++i]);
+    else if (arg == "--pass-ms" && hasValue) fleet.passMs = atof(argv[++i]);
+    else if (arg == "--pump-watts" && hasValue) fleet.pumpWatts = atof(argv[++i]);
+    else if (arg == "--load" && hasValue)    fleet.loadPath = argv[++i];
+    else if (arg == "--bus")                 fleet.bus = true;
+    else if (arg == "--presets" && hasValue) {
+      for (const char* p = argv[++i]; *p;) {
+        long n = strtol(p, const_cast<char**>(&p), 10);
+        if (n < 1 || n > 255 || (*p && *p++ != ',')) { usage(); return 2; }
+        fleet.presets.push_back(static_cast<uint8_t>(n - 1));
+      }
+    }
+    else if (arg == "--fault" && hasValue) {
+      if (!simFaultParse(argv[++i])) { usage(); return 2; }
+    }
+    else if (arg == "--faults" && hasValue) {
+      if (!simFaultProfile(argv[++i])) { usage(); return 2; }
+    }
+    else if ((arg == "--unplug" || arg == "--plug") && hasValue) {
+      std::string spec = argv[++i];
+      size_t colon = spec.find(':');
+      std::string device = spec.substr(0, colon);
+      if (colon == std::string::npos || (device != "lcd" && device != "sensor")) { usage(); return 2; }
+      plugs.push_back({ static_cast<uint64_t>(atof(spec.substr(colon + 1).c_str()) * 1e6),
+                        device, arg == "--plug" });
+    }
+    else if (arg == "--float" && hasValue) {
+      std::string spec = argv[++i];
+      size_t colon = spec.find(':');
+      if (colon == std::string::npos) { usage(); return 2; }
+      floats.push_back({ static_cast<uint64_t>(atof(spec.substr(0, colon).c_str()) * 1e6),
+                         static_cast<uint64_t>(atof(spec.substr(colon + 1).c_str()) * 1e6) });
+    }
+    else if (arg == "--send" && hasValue) {
+      std::string spec = argv[++i];
+      size_t colon = spec.find(':');
+      if (colon == std::string::npos) { usage(); return 2; }
+      sends.push_back({ static_cast<uint64_t>(atof(spec.substr(0, colon).c_str()) * 1e6),
+                        spec.substr(colon + 1) + "\n" });
+    } else {
+      usage();
+      return 2;
+    }
+  }
+
+  if (fleet.controllers) {
+    fleet.seconds = seconds;
+    simSerialEcho(false);
+    return simFleetRun(fleet);
+  }
+
+  if (eepromPath) loadEeprom(eepromPath);
+
+  LcdModel lcd;
+  Dht20Model dht;
+  dht.dryingRate = dryingRate;
+  // Connect or disconnect a device; the LCD answers on two addresses
+  auto connect = [&](const std::string& device, bool on) {
+    if (device == "lcd") {
+      simI2cAttach(0x3E, on ? &lcd : nullptr);
+      simI2cAttach(0x30, on ? &lcd.backlight : nullptr);
+    } else {
+      simI2cAttach(0x38, on ? &dht : nullptr);
+    }
+  };
+  connect("lcd", true);
+  connect("sensor", true);
+  std::stable_sort(plugs.begin(), plugs.end(),
+                   [](const PlugEvent& a, const PlugEvent& b) { return a.at < b.at; });
+  size_t nextPlug = 0;
+  while (nextPlug < plugs.size() && plugs[nextPlug].at == 0) {
+    connect(plugs[nextPlug].device, plugs[nextPlug].connect);
+    nextPlug++;
+  }
+
+  NorFlashModel flash;
+  if (flashPath) {
+    if (!flash.open(flashPath)) {
+      fprintf(stderr, "cannot open %s\n", flashPath);
+      return 1;
+    }
+    simSpiAttach(SIM_FLASH_CS_PIN, &flash);
+  }
+
+  if (tracePath) {
+    if (!simTraceOpen(tracePath)) {
+      fprintf(stderr, "cannot open %s\n", tracePath);
+      return 1;
+    }
+    simTraceNamePin(SIM_RELAY_PIN, "relay");
+  }
+
+  if (busPty) {
+    int fd = openBusPty();
+    if (fd < 0) {
+      perror("bus pty");
+      return 1;
+    }
+    simSerialBus(fd, SIM_RS485_DE_PIN);
+  }
+
+  if (live) printf("\x1b[2J\x1b[5;1H");  // clear; log scrolls below the LCD
+
+  setup();
+
+  const uint64_t endUs = static_cast<uint64_t>(seconds * 1e6);
+  const uint64_t statsUs = static_cast<uint64_t>(statsEvery * 1e6);
+  uint64_t nextStats = statsUs;
+  LcdStats lastLcd = lcd.stats();
+  SimI2cStats lastBus = simI2cStats();
+  std::string lastFrame;
+  size_t nextPress = 0;
+  bool lastPressed = false;
+  uint64_t bounceUntil = 0;
+  LatencyHistogram passes;
+  size_t nextSend = 0;
+
+  while (simNow() < endUs) {
+    uint64_t now = simNow();
+
+    // Button: held HIGH for PRESS_LENGTH_US from each requested time
+    bool pressed = false;
+    for (uint64_t t : presses) {
+      if (now >= t && now < t + PRESS_LENGTH_US) pressed = true;
+    }
+    // Chatter: the contact bounces for a while after an edge
+    if (pressed != lastPressed) {
+      lastPressed = pressed;
+      if (simFault(SIM_FAULT_CHATTER)) bounceUntil = now + 1000 + simFaultRandom(BOUNCE_MAX_US - 1000);
+    }
+    if (now < bounceUntil) pressed = simFaultRandom(2);
+    simSetInput(SIM_BUTTON_PIN, pressed);
+    while (nextPress < presses.size() && presses[nextPress] + PRESS_LENGTH_US <= now) nextPress++;
+
+    if (!floats.empty()) {
+      bool up = false;
+      for (const FloatSpan& f : floats) {
+        if (now >= f.from && now < f.to) up = true;
+      }
+      simSetInput(SIM_FLOAT_PIN, !up);  // active low
+    }
+
+    if (now >= powerFailAt) simSetInput(SIM_POWER_FAIL_PIN, LOW);
+
+    while (nextPlug < plugs.size() && plugs[nextPlug].at <= now) {
+      connect(plugs[nextPlug].device, plugs[nextPlug].connect);
+      nextPlug++;
+    }
+
+    while (nextSend < sends.size() && sends[nextSend].at <= now) {
+      simSerialInject(sends[nextSend].text.c_str());
+      nextSend++;
+    }
+
+    simSerialBusPoll();
+    simFaultTick();
+    dht.pumping = simGetOutput(SIM_RELAY_PIN);
+
+    uint64_t passStart = simNow();
+    loop();
+    passes.add(static_cast<uint32_t>(simNow() - passStart));
+    simAdvance(LOOP_OVERHEAD_US);
+
+    if (live || busPty) {
+      // Keep pace with the wall clock so the screen can be watched, or the
+      // other controllers on the bus keep up. Sleeping until a fixed start
+      // plus the simulated time keeps our own run time from adding up.
+      static const auto wallStart = std::chrono::steady_clock::now() - std::chrono::microseconds(simNow());
+      static uint64_t paced = 0;
+      if (simNow() - paced >= 20000) {
+        std::this_thread::sleep_until(wallStart + std::chrono::microseconds(simNow()));
+        paced = simNow();
+      }
+    }
+
+    if (render || frames) {
+      std::string frame = std::string(lcd.row(0)) + lcd.row(1) +
+                          char(lcd.backlight.r) + char(lcd.backlight.g) + char(lcd.backlight.b) +
+                          char(lcd.displayOn());
+      if (frame != lastFrame) {
+        lastFrame = frame;
+        if (frames) {
+          printf("%llu %u,%u,%u |%s|%s|\n",
+                 static_cast<unsigned long long>(simNow() / 1000),
+                 lcd.backlight.r, lcd.backlight.g, lcd.backlight.b,
+                 lcd.displayOn() ? lcd.row(0) : "", lcd.displayOn() ? lcd.row(1) : "");
+        } else if (live) {
+          printf("\x1b[s\x1b[H");             // save cursor, go to top-left
+          printf("[%10.3f s]\x1b[K\n", simNow() / 1e6);
+          lcd.render();
+          printf("\x1b[u");                   // back to the log below
+        } else {
+          printf("[%10.3f s]\n", simNow() / 1e6);
+          lcd.render();
+        }
+        fflush(stdout);
+      }
+    }
+
+    if (statsUs && simNow() >= nextStats) {
+      const LcdStats& s = lcd.stats();
+      const SimI2cStats& b = simI2cStats();
+      printf("[%10.3f s] i2c %lu tx/s %lu B/s | lcd %lu tx/s %lu cmd/s %lu data/s %lu clr/s\n",
+             simNow() / 1e6,
+             static_cast<unsigned long>((b.transactions - lastBus.transactions) / statsEvery),
+             static_cast<unsigned long>((b.bytes - lastBus.bytes) / statsEvery),
+             static_cast<unsigned long>((s.transactions - lastLcd.transactions) / statsEvery),
+             static_cast<unsigned long>((s.commands - lastLcd.commands) / statsEvery),
+             static_cast<unsigned long>((s.dataBytes - lastLcd.dataBytes) / statsEvery),
+             static_cast<unsigned long>((s.clears - lastLcd.clears) / statsEvery));
+      lastLcd = s;
+      lastBus = b;
+      nextStats += statsUs;
+    }
+  }
+
+  const LcdStats& s = lcd.stats();
+  const SimI2cStats& b = simI2cStats();
+  printf("\n--- %.0f s simulated ---\n", seconds);
+  printf("i2c: %lu transactions, %lu bytes, %lu NAKs, %lu timeouts\n",
+         b.transactions, b.bytes, b.naks, b.timeouts);
+  printf("lcd: %lu transactions, %lu commands, %lu data bytes, %lu clears\n",
+         s.transactions, s.commands, s.dataBytes, s.clears);
+  printf("eeprom: %lu byte writes\n", EEPROM.writeCount());
+  if (flashPath) {
+    const NorFlashStats& f = flash.stats();
+    printf("flash: %lu page programs (%lu bytes), %lu sector erases, %lu busy polls, %lu violations, %lu SPI bytes\n",
+           f.programs, f.programBytes, f.erases, f.busyPolls, f.violations, simSpiStats().bytes);
+  }
+
+
+  std::string injected;
+  for (uint8_t k = 0; k < SIM_FAULT_KINDS; k++) {
+    SimFaultKind kind = static_cast<SimFaultKind>(k);
+    if (!simFaultScheduled(kind)) continue;
+    char item[48];
+    snprintf(item, sizeof(item), "%s%s %lu", injected.empty() ? "" : ", ",
+             simFaultName(kind), simFaultCount(kind));
+    injected += item;
+  }
+  if (!injected.empty()) printf("faults: %s\n", injected.c_str());
+
+  if (passes.passes) {
+    // Time spent inside loop() per pass (LOOP_OVERHEAD_US not included)
+    printf("loop: %llu passes, mean %.1f us, p99 %u us, p99.9 %u us, p99.99 %u us, max %u us\n",
+           static_cast<unsigned long long>(passes.passes), passes.totalUs / passes.passes,
+           passes.percentile(0.99), passes.percentile(0.999), passes.percentile(0.9999), passes.maxUs);
+  }
+  printf("relay: %lu scheduled switches, late mean %lu ms, max %lu ms\n",
+         relayTiming.switches, relayTiming.lateMean(), relayTiming.lateMax);
+
+  simTraceClose();
+  if (eepromPath) saveEeprom(eepromPath);
+  return 0;
+}
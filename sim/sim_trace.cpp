@@ -0,0 +1,101 @@
+// =============================================================================
+// Timeline trace
+// =============================================================================
+
+#include "sim_trace.h"
+#include "sim.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <vector>
+
+static const int TRACK_LOOP = 1;
+static const int TRACK_I2C  = 2;
+
+struct OpenSpan {
+  const char* name;
+  uint64_t    start;
+};
+
+static FILE* out = nullptr;
+static bool firstEvent = true;
+static std::vector<OpenSpan> spans;
+static const char* pinNames[SIM_PIN_COUNT];
+static int8_t pinLevels[SIM_PIN_COUNT];
+
+static void separator() {
+  fputs(firstEvent ? "\n" : ",\n", out);
+  firstEvent = false;
+}
+
+static void complete(int track, const char* name, uint64_t start, const char* args) {
+  separator();
+  fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%llu%s%s%s}",
+          name, track, static_cast<unsigned long long>(start),
+          static_cast<unsigned long long>(simNow() - start),
+          args ? ",\"args\":{" : "", args ? args : "", args ? "}" : "");
+}
+
+static void trackName(int track, const char* name) {
+  separator();
+  fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+          track, name);
+}
+
+bool simTraceOpen(const char* path) {
+  out = fopen(path, "w");
+  if (!out) return false;
+  fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+  separator();
+  fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"cellarpump\"}}", out);
+  trackName(TRACK_LOOP, "loop()");
+  trackName(TRACK_I2C, "i2c");
+  for (int8_t& level : pinLevels) level = -1;
+  return true;
+}
+
+void simTraceClose() {
+  if (!out) return;
+  fputs("\n]}\n", out);
+  fclose(out);
+  out = nullptr;
+}
+
+void simTraceNamePin(uint8_t pin, const char* name) {
+  if (pin < SIM_PIN_COUNT) pinNames[pin] = name;
+}
+
+void traceBegin(const char* name) {
+  if (out) spans.push_back({ name, simNow() });
+}
+
+void traceEnd() {
+  if (!out || spans.empty()) return;
+  OpenSpan span = spans.back();
+  spans.pop_back();
+  if (simNow() > span.start) complete(TRACK_LOOP, span.name, span.start, nullptr);
+}
+
+void simTraceWait(const char* name, uint64_t start) {
+  if (out && simNow() > start) complete(TRACK_LOOP, name, start, nullptr);
+}
+
+void simTraceI2c(uint8_t address, bool read, unsigned bytes, uint8_t status, uint64_t start) {
+  if (!out) return;
+  char name[24];
+  char args[48];
+  snprintf(name, sizeof(name), "0x%02X %s", address, read ? "read" : "write");
+  snprintf(args, sizeof(args), "\"bytes\":%u,\"status\":%u", bytes, status);
+  complete(TRACK_I2C, name, start, args);
+}
+
+void simTracePin(uint8_t pin, bool level) {
+  if (!out || pin >= SIM_PIN_COUNT || !pinNames[pin] || pinLevels[pin] == level) return;
+  pinLevels[pin] = level;
+  separator();
+  fprintf(out, "{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%llu,\"args\":{\"level\":%d}}",
+          pinNames[pin], static_cast<unsigned long long>(simNow()), level ? 1 : 0);
+  separator();
+  fprintf(out, "{\"name\":\"%s %s\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%d,\"ts\":%llu}",
+          pinNames[pin], level ? "on" : "off", TRACK_LOOP, static_cast<unsigned long long>(simNow()));
+}
@@ -0,0 +1,30 @@
+// =============================================================================
+// Timeline trace
+// =============================================================================
+// Writes a Chrome trace-event JSON file (open in Perfetto or chrome://tracing)
+// on the virtual clock:
+//
+//   loop()   TRACE_SCOPE spans from the firmware, and delay() calls
+//   i2c      one span per transaction (address, direction, bytes, result)
+//   pins     a counter track per named pin (e.g. the relay)
+//
+// Span lengths are the costs the simulator charges: bus time, delay() and
+// EEPROM write waits. Plain computation is not modeled and takes no time,
+// so spans without any of those are left out; what remains are exactly the
+// sections that block the loop.
+// =============================================================================
+
+#pragma once
+
+#include <stdint.h>
+
+bool simTraceOpen(const char* path);
+void simTraceClose();
+
+// Give a pin a counter track; its level is recorded on every change
+void simTraceNamePin(uint8_t pin, const char* name);
+
+// Called by the simulated hardware
+void simTracePin(uint8_t pin, bool level);
+void simTraceI2c(uint8_t address, bool read, unsigned bytes, uint8_t status, uint64_t start);
+void simTraceWait(const char* name, uint64_t start);
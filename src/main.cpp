@@ -10,12 +10,34 @@
 #include <Wire.h>
 #include <EEPROM.h>
 
-// Feature toggles — comment out to disable
+#include "alarms.h"
+#include "bus_frame.h"
+#include "crc16.h"
+#include "relay_timing.h"
+#include "string_pool.h"
+#include "target_profile.h"
+#include "trace.h"
+
+// Feature toggles — comment out to disable. The display and sensor code is
+// only used when the device answers on I2C (see PERIPHERAL DETECTION), so
+// one image serves units with and without them; the toggles just leave the
+// code out.
 #define ENABLE_SERIAL_LOGGING
 #define ENABLE_DISPLAY
 #define ENABLE_DISPLAY_RGB
 #define ENABLE_TEMP_HUMIDITY_SENSOR
 #define ENABLE_PRESET_BUTTON
+#define ENABLE_SERIAL_COMMANDS
+#define ENABLE_RULES
+#define ENABLE_DATA_LOGGER     // inactive unless an SPI NOR flash answers on D10
+#define ENABLE_HISTORY
+#define ENABLE_POWER_FAIL_INPUT // flush pending EEPROM writes when D2 goes low
+#define ENABLE_DISPLAY_SLEEP   // blank the display when nobody has pressed the button
+#define ENABLE_RUN_STATS       // per-preset humidity/temperature response to pump runs
+#define ENABLE_RS485           // addressed frames and clock sync on the serial port (DE on D5)
+#define ENABLE_ALARMS          // temperature/humidity thresholds with hysteresis, latched
+#define ENABLE_FLOAT_SWITCH    // demand mode: a float switch on D6 starts the pump
+#define ENABLE_METRICS         // counters and histograms for the "metrics" command
 
 // ENABLE_DISPLAY_RGB implies ENABLE_DISPLAY
 #ifdef ENABLE_DISPLAY_RGB
@@ -24,6 +46,53 @@
   #endif
 #endif
 
+// ENABLE_HISTORY needs the sensor
+#if defined(ENABLE_HISTORY) && !defined(ENABLE_TEMP_HUMIDITY_SENSOR)
+  #undef ENABLE_HISTORY
+#endif
+
+// ENABLE_RUN_STATS needs the sensor
+#if defined(ENABLE_RUN_STATS) && !defined(ENABLE_TEMP_HUMIDITY_SENSOR)
+  #undef ENABLE_RUN_STATS
+#endif
+
+// ENABLE_RUN_STATS and ENABLE_METRICS only fit in the Mega's SRAM (see
+// include/target_profile.h)
+#ifndef CELLARPUMP_TARGET_MEGA2560
+  #undef ENABLE_RUN_STATS
+  #undef ENABLE_METRICS
+#endif
+
+// ENABLE_ALARMS needs the sensor
+#if defined(ENABLE_ALARMS) && !defined(ENABLE_TEMP_HUMIDITY_SENSOR)
+  #undef ENABLE_ALARMS
+#endif
+
+// ENABLE_DISPLAY_SLEEP needs the display, and the button to wake it
+#if defined(ENABLE_DISPLAY_SLEEP) && !(defined(ENABLE_DISPLAY) && defined(ENABLE_PRESET_BUTTON))
+  #undef ENABLE_DISPLAY_SLEEP
+#endif
+
+// ENABLE_RS485 needs the serial command parser, which routes frames to it
+#if defined(ENABLE_RS485) && !defined(ENABLE_SERIAL_COMMANDS)
+  #undef ENABLE_RS485
+#endif
+
+// ENABLE_PRESET_BUTTON and ENABLE_FLOAT_SWITCH imply ENABLE_DIGITAL_INPUTS
+// (debounced inputs)
+#if defined(ENABLE_PRESET_BUTTON) || defined(ENABLE_FLOAT_SWITCH)
+  #ifndef ENABLE_DIGITAL_INPUTS
+    #define ENABLE_DIGITAL_INPUTS
+  #endif
+#endif
+
+// ENABLE_SERIAL_COMMANDS implies ENABLE_SERIAL_LOGGING (serial port setup)
+#ifdef ENABLE_SERIAL_COMMANDS
+  #ifndef ENABLE_SERIAL_LOGGING
+    #define ENABLE_SERIAL_LOGGING
+  #endif
+#endif
+
 // =============================================================================
 // Pin Configuration
 // =============================================================================
@@ -34,6 +103,22 @@ const int RELAY_PIN = 4; // Grove Relay on digital pin 4
 const int BUTTON_PIN = 3; // Grove Button on digital pin 3
 #endif
 
+#ifdef ENABLE_POWER_FAIL_INPUT
+const int POWER_FAIL_PIN = 2; // active low (pulled up), e.g. a supply supervisor
+#endif
+
+#ifdef ENABLE_DATA_LOGGER
+const uint8_t FLASH_CS_PIN = 10; // SPI NOR flash chip select (SPI on D11-D13)
+#endif
+
+#ifdef ENABLE_RS485
+const int RS485_DE_PIN = 5; // transceiver DE and /RE; the bus is on D0/D1
+#endif
+
+#ifdef ENABLE_FLOAT_SWITCH
+const int FLOAT_SWITCH_PIN = 6; // closes to GND when the water is high (pulled up)
+#endif
+
 // =============================================================================
 // Duration Literals (C++11 user-defined literals, evaluated at compile time)
 // =============================================================================
@@ -48,78 +133,367 @@ constexpr unsigned long operator"" _day(unsigned long long d)  { return (unsigne
 // Timing Configuration
 // =============================================================================
 
-// Default durations (used when preset button is disabled, or as preset 0)
-const unsigned long DEFAULT_PUMP_ON_DURATION    = 60_s;
-const unsigned long DEFAULT_PUMP_CYCLE_INTERVAL = 5_min;
 const unsigned long DISPLAY_UPDATE_INTERVAL     = 500_ms;
+const unsigned long DISPLAY_SLEEP_TIMEOUT       = 10_min; // since the last button press
 const unsigned long SENSOR_READ_INTERVAL        = 2_s;
 
-// Active durations — set from preset or defaults
-unsigned long pumpOnDuration    = DEFAULT_PUMP_ON_DURATION;
-unsigned long pumpCycleInterval = DEFAULT_PUMP_CYCLE_INTERVAL;
-
 // =============================================================================
-// Backlight threshold: show green when less than 5 minutes remain
+// EEPROM Access
 // =============================================================================
+// All EEPROM reads and writes go through a write-back cache
+// (include/eeprom_cache.h): writes land in RAM and are committed a byte per
+// loop pass once EEPROM_QUIET_PERIOD has passed without further writes, so
+// stepping through presets costs one save instead of one per press. A low
+// level on POWER_FAIL_PIN (e.g. from a supply supervisor) commits everything
+// at once.
+// =============================================================================
+
+#include "eeprom_cache.h"
+
+const unsigned long EEPROM_QUIET_PERIOD = 5_s;
+
+EepromCache eepromCache(EEPROM_QUIET_PERIOD);
 
-const unsigned long GREEN_THRESHOLD = 5_min;
+#ifdef ENABLE_POWER_FAIL_INPUT
+// Commit everything on the falling edge of the power-fail warning
+void checkPowerFail() {
+  static bool lastLevel = HIGH;
+  bool level = digitalRead(POWER_FAIL_PIN);
+  if (level == LOW && lastLevel == HIGH) eepromCache.flush();
+  lastLevel = level;
+}
+#endif
 
 // =============================================================================
-// Preset Profiles (button cycles through these)
+// Persistent Configuration
+// =============================================================================
+// Everything that survives a reboot lives in one Config struct. It is kept
+// in EEPROM, and exported/imported over serial, as a versioned blob:
+//
+//   'C' 'P' | version | payload length | payload ... | CRC-16 (LE)
+//
+// All multi-byte fields are little-endian. Fields are only ever appended to
+// the payload: a shorter payload from older firmware leaves the newer fields
+// at their defaults. The version only changes for incompatible layouts.
+// tools/cellarcfg.py builds and verifies blobs on the host.
 // =============================================================================
 
-#ifdef ENABLE_PRESET_BUTTON
+const uint8_t PRESET_COUNT = 7;
 
-struct Preset {
+struct PresetTiming {
   unsigned long onDuration;     // ms
   unsigned long cycleInterval;  // ms
-  const char*   label;          // shown on LCD (max 16 chars)
 };
 
-const Preset PRESETS[] = {
-  { 60_s,  30_min,  "1: 60s / 30min"   }, // 0 — default
-  { 60_s,   2_h,    "2: 60s / 2h"      }, // 1
-  { 60_s,   6_h,    "3: 60s / 6h"      }, // 2
-  { 60_s,   1_day,  "4: 60s / 1day"    }, // 3
-  { 60_s,   1_min,  "5: 60s / 1min"    }, // 4
-  { 60_s,   4_min,  "6: 60s / 4min"    }, // 5
-  { 60_s,  10_min,  "7: 60s / 10min"   }, // 6
+// Preset profiles (button cycles through these); labels are generated from
+// the timings, e.g. "1: 60s / 30min"
+const PresetTiming DEFAULT_PRESETS[PRESET_COUNT] PROGMEM = {
+  { 60_s,  30_min }, // 0 — default
+  { 60_s,   2_h   }, // 1
+  { 60_s,   6_h   }, // 2
+  { 60_s,   1_day }, // 3
+  { 60_s,   1_min }, // 4
+  { 60_s,   4_min }, // 5
+  { 60_s,  10_min }, // 6
 };
-const uint8_t PRESET_COUNT = sizeof(PRESETS) / sizeof(PRESETS[0]);
 
-// EEPROM layout
-const int EEPROM_ADDR_MAGIC  = 0; // 1 byte: validity marker
-const int EEPROM_ADDR_PRESET = 1; // 1 byte: preset index
-const uint8_t EEPROM_MAGIC   = 0xC7; // arbitrary marker
+// Backlight threshold: show green when less than 5 minutes remain
+const unsigned long DEFAULT_GREEN_THRESHOLD = 5_min;
+
+// Alarm thresholds (tenths; see ALARMS): near freezing, and damp enough
+// for mould
+const AlarmLimit DEFAULT_ALARMS[ALARM_COUNT] PROGMEM = {
+  {        20,  5 }, // temperature below 2.0 C, clears at 2.5 C
+  { ALARM_OFF,  5 }, // temperature high
+  {       850, 20 }, // humidity above 85.0 %, clears at 83.0 %
+  { ALARM_OFF,  5 }, // temperature near the dew point
+};
 
-// Button state
-const unsigned long DEBOUNCE_MS = 50_ms;
-const unsigned long OVERLAY_DISPLAY_MS = 2_s;
+const uint8_t SCHEDULE_TIMED  = 0; // fixed on/off cycle
+const uint8_t SCHEDULE_DEMAND = 1; // run while the float switch says so (see PUMP / RELAY CONTROL)
+
+// Demand-mode run limits: a run lasts at least the minimum, however soon
+// the float drops, and stops at the maximum, however long it stays up
+const unsigned long DEFAULT_DEMAND_MIN_RUN = 20_s;
+const unsigned long DEFAULT_DEMAND_MAX_RUN = 5_min;
+
+struct Config {
+  uint8_t       preset;          // active preset index
+  uint8_t       scheduleMode;    // SCHEDULE_*
+  unsigned long greenThreshold;  // ms
+  int16_t       tempOffset;      // calibration, 0.1 C
+  int16_t       humidityOffset;  // calibration, 0.1 %RH
+  PresetTiming  presets[PRESET_COUNT];
+  uint8_t       busAddress;      // RS-485 address, 0 = not on a bus
+  uint8_t       busNodes;        // controllers sharing the cycle (coordinator only)
+  AlarmLimit    alarms[ALARM_COUNT]; // by AlarmId
+  unsigned long demandMinRun;    // ms
+  unsigned long demandMaxRun;    // ms
+};
 
-uint8_t currentPreset = 0;
-bool    lastButtonState = LOW;
-unsigned long lastDebounceTime = 0;
-unsigned long overlayStartTime = 0; // when overlay was triggered
-bool overlayShowing = false;        // true while overlay is on screen
+// Double buffer: readers only ever see configBuffers[configActive]; edits go
+// to the other (shadow) copy and are published by flipping the index. The
+// flip is a single byte store, so a reader can never observe a half-applied
+// update. See "Configuration Updates" below.
+Config  configBuffers[2];
+uint8_t configActive = 0;
+
+inline const Config& activeConfig() { return configBuffers[configActive]; }
+
+const uint8_t CONFIG_MAGIC_0      = 'C';
+const uint8_t CONFIG_MAGIC_1      = 'P';
+const uint8_t CONFIG_VERSION      = 1;
+const uint8_t CONFIG_HEADER_SIZE  = 4;
+const uint8_t CONFIG_PAYLOAD_SIZE = 1 + 1 + 4 + 2 + 2 + PRESET_COUNT * 8 + 1 + 1 + ALARM_COUNT * 3 + 4 + 4;
+const uint8_t CONFIG_BLOB_SIZE    = CONFIG_HEADER_SIZE + CONFIG_PAYLOAD_SIZE + 2;
+
+// Calibration offsets beyond these are rejected as typos
+const int16_t MAX_TEMP_OFFSET     = 100; // 10.0 C
+const int16_t MAX_HUMIDITY_OFFSET = 200; // 20.0 %RH
+
+// Alarm limits beyond the sensor's range are rejected (ALARM_OFF aside)
+const int16_t ALARM_LIMIT_MIN = -400; // -40.0
+const int16_t ALARM_LIMIT_MAX = 1000; // 100.0
+
+// Result of decoding / validating a configuration blob
+enum ConfigStatus : uint8_t {
+  CONFIG_OK,
+  CONFIG_ERR_SIZE,
+  CONFIG_ERR_MAGIC,
+  CONFIG_ERR_VERSION,
+  CONFIG_ERR_CRC,
+  CONFIG_ERR_RANGE,
+};
+
+// EEPROM layout: two slots, each a sequence byte followed by a blob. Saves
+// alternate between the slots, so a reset in the middle of a write always
+// leaves the previous copy intact; the valid slot with the newest sequence
+// number wins at boot.
+const int     EEPROM_CONFIG_SLOT_SIZE = 128;
+const int     EEPROM_ADDR_CONFIG[2]   = { 0, EEPROM_CONFIG_SLOT_SIZE };
+static_assert(CONFIG_BLOB_SIZE < EEPROM_CONFIG_SLOT_SIZE, "config blob outgrew its EEPROM slot");
+
+// Layout used before configuration blobs (preset index only)
+const int     EEPROM_ADDR_LEGACY_MAGIC  = 0;
+const int     EEPROM_ADDR_LEGACY_PRESET = 1;
+const uint8_t EEPROM_LEGACY_MAGIC       = 0xC7;
+
+uint8_t configSlot = 0; // slot holding the current config
+uint8_t configSeq  = 0; // its sequence number
+
+void setDefaultConfig(Config& c) {
+  c.preset         = 0;
+  c.scheduleMode   = SCHEDULE_TIMED;
+  c.greenThreshold = DEFAULT_GREEN_THRESHOLD;
+  c.tempOffset     = 0;
+  c.humidityOffset = 0;
+  memcpy_P(c.presets, DEFAULT_PRESETS, sizeof(c.presets));
+  c.busAddress     = 0;
+  c.busNodes       = 0;
+  memcpy_P(c.alarms, DEFAULT_ALARMS, sizeof(c.alarms));
+  c.demandMinRun   = DEFAULT_DEMAND_MIN_RUN;
+  c.demandMaxRun   = DEFAULT_DEMAND_MAX_RUN;
+}
+
+static void putU8(uint8_t*& p, uint8_t v)  { *p++ = v; }
+static void putU16(uint8_t*& p, uint16_t v) { *p++ = v & 0xFF; *p++ = v >> 8; }
+static void putU32(uint8_t*& p, uint32_t v) { putU16(p, v & 0xFFFF); putU16(p, v >> 16); }
+
+static uint8_t  getU8(const uint8_t*& p)  { return *p++; }
+static uint16_t getU16(const uint8_t*& p) { uint16_t v = p[0] | (p[1] << 8); p += 2; return v; }
+static uint32_t getU32(const uint8_t*& p) { uint32_t lo = getU16(p); return lo | ((uint32_t)getU16(p) << 16); }
+
+// Serialize c into blob (CONFIG_BLOB_SIZE bytes).
+void encodeConfig(const Config& c, uint8_t* blob) {
+  uint8_t* p = blob;
+  putU8(p, CONFIG_MAGIC_0);
+  putU8(p, CONFIG_MAGIC_1);
+  putU8(p, CONFIG_VERSION);
+  putU8(p, CONFIG_PAYLOAD_SIZE);
+  putU8(p, c.preset);
+  putU8(p, c.scheduleMode);
+  putU32(p, c.greenThreshold);
+  putU16(p, (uint16_t)c.tempOffset);
+  putU16(p, (uint16_t)c.humidityOffset);
+  for (uint8_t i = 0; i < PRESET_COUNT; i++) {
+    putU32(p, c.presets[i].onDuration);
+    putU32(p, c.presets[i].cycleInterval);
+  }
+  putU8(p, c.busAddress);
+  putU8(p, c.busNodes);
+  for (uint8_t i = 0; i < ALARM_COUNT; i++) {
+    putU16(p, (uint16_t)c.alarms[i].limit);
+    putU8(p, c.alarms[i].hysteresis);
+  }
+  putU32(p, c.demandMinRun);
+  putU32(p, c.demandMaxRun);
+  putU16(p, crc16(blob, CONFIG_HEADER_SIZE + CONFIG_PAYLOAD_SIZE));
+}
+
+ConfigStatus validateConfig(const Config& c) {
+  if (c.preset >= PRESET_COUNT) return CONFIG_ERR_RANGE;
+  if (c.scheduleMode != SCHEDULE_TIMED && c.scheduleMode != SCHEDULE_DEMAND) return CONFIG_ERR_RANGE;
+  if (c.greenThreshold > 1_day) return CONFIG_ERR_RANGE;
+  if (abs(c.tempOffset) > MAX_TEMP_OFFSET) return CONFIG_ERR_RANGE;
+  if (abs(c.humidityOffset) > MAX_HUMIDITY_OFFSET) return CONFIG_ERR_RANGE;
+  for (uint8_t i = 0; i < PRESET_COUNT; i++) {
+    const PresetTiming& t = c.presets[i];
+    if (t.onDuration < 1_s || t.onDuration > 1_day) return CONFIG_ERR_RANGE;
+    if (t.cycleInterval < 1_s || t.cycleInterval > 7_day) return CONFIG_ERR_RANGE;
+  }
+  if (c.busAddress > BUS_ADDRESS_MAX || c.busNodes > BUS_ADDRESS_MAX) return CONFIG_ERR_RANGE;
+  for (uint8_t i = 0; i < ALARM_COUNT; i++) {
+    int16_t limit = c.alarms[i].limit;
+    if (limit != ALARM_OFF && (limit < ALARM_LIMIT_MIN || limit > ALARM_LIMIT_MAX)) return CONFIG_ERR_RANGE;
+  }
+  if (c.demandMinRun < 1_s || c.demandMinRun > c.demandMaxRun || c.demandMaxRun > 1_day) return CONFIG_ERR_RANGE;
+  return CONFIG_OK;
+}
+
+// Parse and validate a blob of len bytes into c. On error, c is untouched.
+ConfigStatus decodeConfig(const uint8_t* blob, uint8_t len, Config& c) {
+  if (len < CONFIG_HEADER_SIZE + 2) return CONFIG_ERR_SIZE;
+  if (blob[0] != CONFIG_MAGIC_0 || blob[1] != CONFIG_MAGIC_1) return CONFIG_ERR_MAGIC;
+  if (blob[2] != CONFIG_VERSION) return CONFIG_ERR_VERSION;
+  uint8_t payloadLen = blob[3];
+  if (payloadLen > CONFIG_PAYLOAD_SIZE || len != CONFIG_HEADER_SIZE + payloadLen + 2) {
+    return CONFIG_ERR_SIZE;
+  }
+  const uint8_t* p = blob + CONFIG_HEADER_SIZE + payloadLen;
+  if (getU16(p) != crc16(blob, CONFIG_HEADER_SIZE + payloadLen)) return CONFIG_ERR_CRC;
+
+  // Fields missing from a shorter (older) payload keep their defaults
+  Config staged;
+  setDefaultConfig(staged);
+  p = blob + CONFIG_HEADER_SIZE;
+  const uint8_t* end = p + payloadLen;
+  if (end - p >= 2) {
+    staged.preset       = getU8(p);
+    staged.scheduleMode = getU8(p);
+  }
+  if (end - p >= 8) {
+    staged.greenThreshold = getU32(p);
+    staged.tempOffset     = (int16_t)getU16(p);
+    staged.humidityOffset = (int16_t)getU16(p);
+  }
+  for (uint8_t i = 0; i < PRESET_COUNT && end - p >= 8; i++) {
+    staged.presets[i].onDuration    = getU32(p);
+    staged.presets[i].cycleInterval = getU32(p);
+  }
+  if (end - p >= 2) {
+    staged.busAddress = getU8(p);
+    staged.busNodes   = getU8(p);
+  }
+  for (uint8_t i = 0; i < ALARM_COUNT && end - p >= 3; i++) {
+    staged.alarms[i].limit      = (int16_t)getU16(p);
+    staged.alarms[i].hysteresis = getU8(p);
+  }
+  if (end - p >= 8) {
+    staged.demandMinRun = getU32(p);
+    staged.demandMaxRun = getU32(p);
+  }
+
+  ConfigStatus status = validateConfig(staged);
+  if (status == CONFIG_OK) c = staged;
+  return status;
+}
+
+// Read and decode one EEPROM slot.
+ConfigStatus readConfigSlot(uint8_t slot, Config& c, uint8_t& seq) {
+  int addr = EEPROM_ADDR_CONFIG[slot];
+  uint8_t blob[CONFIG_BLOB_SIZE];
+  uint8_t len = CONFIG_HEADER_SIZE + eepromCache.read(addr + 1 + 3) + 2;
+  if (len > CONFIG_BLOB_SIZE) return CONFIG_ERR_SIZE;
+  seq = eepromCache.read(addr);
+  for (uint8_t i = 0; i < len; i++) blob[i] = eepromCache.read(addr + 1 + i);
+  return decodeConfig(blob, len, c);
+}
+
+// Load the newest valid configuration; falls back to the legacy preset
+// byte, then to defaults.
+// Slot 1 is decoded straight into c when it is the only valid copy or
+// the newer one, so only one Config is on the stack at boot.
+void loadConfigFromEEPROM(Config& c) {
+  Config slot0;
+  uint8_t seq0 = 0, seq1 = 0;
+  bool valid0 = readConfigSlot(0, slot0, seq0) == CONFIG_OK;
+  bool valid1 = readConfigSlot(1, c, seq1) == CONFIG_OK;
+
+  if (valid0 || valid1) {
+    uint8_t pick = (valid0 && valid1) ? ((int8_t)(seq1 - seq0) > 0 ? 1 : 0) : (valid1 ? 1 : 0);
+    if (pick == 0) c = slot0;
+    configSlot = pick;
+    configSeq = pick ? seq1 : seq0;
+    return;
+  }
+
+  setDefaultConfig(c);
+  if (eepromCache.read(EEPROM_ADDR_LEGACY_MAGIC) == EEPROM_LEGACY_MAGIC) {
+    uint8_t idx = eepromCache.read(EEPROM_ADDR_LEGACY_PRESET);
+    if (idx < PRESET_COUNT) c.preset = idx;
+  }
+  configSlot = 1; // first save goes to slot 0, replacing the legacy bytes
+}
+
+// Write c to the slot not holding the current copy. While the previous
+// save is still waiting in the EEPROM cache, overwrite that one instead:
+// the other slot still holds the last committed copy, and a burst of
+// edits ends up as a single slot write.
+void saveConfigToEEPROM(const Config& c) {
+  uint8_t blob[CONFIG_BLOB_SIZE];
+  encodeConfig(c, blob);
+  bool reuse = eepromCache.pending(EEPROM_ADDR_CONFIG[configSlot], CONFIG_BLOB_SIZE + 1);
+  uint8_t slot = reuse ? configSlot : configSlot ^ 1;
+  if (reuse) configSeq--;
+  int addr = EEPROM_ADDR_CONFIG[slot];
+  // The sequence byte goes last: until the whole blob is committed the slot
+  // keeps its older sequence number (or fails its CRC), so a torn save
+  // loses only this save
+  for (uint8_t i = 0; i < CONFIG_BLOB_SIZE; i++) eepromCache.write(addr + 1 + i, blob[i]);
+  eepromCache.writeLast(addr, configSeq + 1);
+  configSlot = slot;
+  configSeq++;
+}
 
-void applyPreset(uint8_t idx) {
-  if (idx >= PRESET_COUNT) idx = 0;
-  currentPreset    = idx;
-  pumpOnDuration   = PRESETS[idx].onDuration;
-  pumpCycleInterval = PRESETS[idx].cycleInterval;
+// Active durations — taken from the preset of the published configuration
+inline unsigned long pumpOnDuration() {
+  const Config& c = activeConfig();
+  return c.presets[c.preset].onDuration;
 }
 
-void savePresetToEEPROM(uint8_t idx) {
-  EEPROM.update(EEPROM_ADDR_MAGIC, EEPROM_MAGIC);
-  EEPROM.update(EEPROM_ADDR_PRESET, idx);
+inline unsigned long pumpCycleInterval() {
+  const Config& c = activeConfig();
+  return c.presets[c.preset].cycleInterval;
 }
 
-uint8_t loadPresetFromEEPROM() {
-  if (EEPROM.read(EEPROM_ADDR_MAGIC) != EEPROM_MAGIC) return 0;
-  uint8_t idx = EEPROM.read(EEPROM_ADDR_PRESET);
-  return (idx < PRESET_COUNT) ? idx : 0;
+// Format the label of c's active preset, such as "1: 60s / 30min"
+// (max 16 chars).
+void formatPresetLabel(char* buf, size_t size, const Config& c) {
+  uint8_t idx = c.preset;
+  const PresetTiming& t = c.presets[idx];
+  unsigned long cycle = t.cycleInterval;
+  StrId unitId;
+  if (cycle % 1_day == 0)      { cycle /= 1_day; unitId = STR_UNIT_DAY; }
+  else if (cycle % 1_h == 0)   { cycle /= 1_h;   unitId = STR_UNIT_H; }
+  else if (cycle % 1_min == 0) { cycle /= 1_min; unitId = STR_UNIT_MIN; }
+  else                         { cycle /= 1_s;   unitId = STR_UNIT_S; }
+  char unit[4];
+  strcpy_P(unit, pstr(unitId));
+  snprintf_P(buf, size, pstr(STR_FMT_PRESET_LABEL), idx + 1, t.onDuration / 1_s, cycle, unit);
 }
 
+// =============================================================================
+// Preset Button
+// =============================================================================
+
+#ifdef ENABLE_PRESET_BUTTON
+
+// Overlay state (the button itself is read in DIGITAL INPUTS)
+const unsigned long OVERLAY_DISPLAY_MS = 2_s;
+
+unsigned long overlayStartTime = 0; // when overlay was triggered
+bool overlayShowing = false;        // true while overlay is on screen
+
 #endif // ENABLE_PRESET_BUTTON
 
 // =============================================================================
@@ -135,38 +509,286 @@ unsigned long lastSensorRead = 0;
 float temperature = 0.0f;
 float humidity = 0.0f;
 
+unsigned long pumpRunDuration = 0;  // length of the current/last run (ms)
+unsigned int  pumpRunCount = 0;     // runs since boot (saturating)
+RelayTiming   relayTiming = {};     // lateness of scheduled switches
+
+// What started a pump run
+enum PumpTrigger : uint8_t {
+  TRIGGER_SCHEDULE, // the timed cycle (and the boot run)
+  TRIGGER_FLOAT,    // the float switch, in demand mode
+};
+
+PumpTrigger pumpTrigger = TRIGGER_SCHEDULE; // of the current/last run
+
+#ifdef ENABLE_FLOAT_SWITCH
+// Why the float switch is suspect (see PUMP)
+enum FloatFailure : uint8_t {
+  FLOAT_OK,
+  FLOAT_STUCK,   // still up after FLOAT_STUCK_RUNS full runs: the timed preset
+                 // runs instead, until the float is down
+  FLOAT_SILENT,  // not up for FLOAT_SILENT_CYCLES cycle intervals: reported,
+                 // the pump stays off, until the float is up
+};
+FloatFailure floatFailed = FLOAT_OK;
+#endif
+
+// True while the float switch, not the timed cycle, decides when to pump
+inline bool demandMode() {
+#ifdef ENABLE_FLOAT_SWITCH
+  return activeConfig().scheduleMode == SCHEDULE_DEMAND && floatFailed != FLOAT_STUCK;
+#else
+  return false;
+#endif
+}
+
+#ifdef ENABLE_METRICS
+#include "metrics.h"
+
+uint32_t metricSlots[METRIC_SLOTS]; // see include/metrics.h
+#else
+// Without metrics, the updates compile to nothing
+#define metricAdd(...)     ((void)0)
+#define metricSet(...)     ((void)0)
+#define metricObserve(...) ((void)0)
+#endif
+
+#ifdef ENABLE_ALARMS
+AlarmSet alarmState = {};           // see ALARMS
+#endif
+
+// I2C peripherals that answered the last probe (see PERIPHERAL DETECTION)
+enum Peripheral : uint8_t {
+  PERIPHERAL_DISPLAY = 0x01,
+  PERIPHERAL_SENSOR  = 0x02,
+};
+
+uint8_t peripherals = 0;
+
+inline bool present(uint8_t p) { return peripherals & p; }
+
+// Convert a reading to tenths, rounding to nearest.
+int16_t toTenths(float value) {
+  return (int16_t)(value * 10.0f + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// =============================================================================
+// Configuration Updates
+// =============================================================================
+// Button presses and serial imports edit the shadow copy, then commit it.
+// A commit validates and persists the shadow and publishes it either right
+// away or at the next pump-off boundary, so a run in progress keeps the
+// duration it started with.
+// =============================================================================
+
+enum ConfigCommit : uint8_t {
+  COMMIT_NOW,         // publish immediately
+  COMMIT_AT_PUMP_OFF, // publish now if the pump is off, else when it stops
+};
+
+bool configPublishPending = false; // shadow is committed, waiting for pump-off
+
+// Return the shadow copy for editing. Starts from the published config,
+// unless an earlier commit is still waiting to be published, in which case
+// edits build on top of it.
+Config& beginConfigEdit() {
+  Config& shadow = configBuffers[configActive ^ 1];
+  if (!configPublishPending) shadow = activeConfig();
+  return shadow;
+}
+
+// Flip the shadow to active. If the pump is off, its countdown restarts
+// under the new schedule.
+void publishConfig() {
+  configActive ^= 1;
+  configPublishPending = false;
+  if (!pumpRunning) pumpStopTime = millis();
+}
+
+ConfigStatus commitConfig(ConfigCommit when) {
+  const Config& shadow = configBuffers[configActive ^ 1];
+  ConfigStatus status = validateConfig(shadow);
+  if (status != CONFIG_OK) return status;
+
+  saveConfigToEEPROM(shadow);
+  if (when == COMMIT_NOW || !pumpRunning) {
+    publishConfig();
+  } else {
+    configPublishPending = true;
+  }
+  return CONFIG_OK;
+}
+
+// The configuration the next cycle will run with (shadow while pending).
+inline const Config& upcomingConfig() {
+  return configPublishPending ? configBuffers[configActive ^ 1] : activeConfig();
+}
+
 // =============================================================================
 // SERIAL LOGGING
 // =============================================================================
+// The UART also drives the RS-485 transceiver, so nothing but a frame may
+// be written while one is queued or going out (see RS-485 BUS). Streamed
+// reports skip the loop pass while serialBusy(); one-off lines call
+// serialHold() first, which lets a frame in flight finish.
+// =============================================================================
+
+#ifdef ENABLE_RS485
+bool serialBusy();
+void serialHold();
+#else
+inline bool serialBusy() { return false; }
+inline void serialHold() {}
+#endif
 
 #ifdef ENABLE_SERIAL_LOGGING
 
+const unsigned long SERIAL_BAUD = 9600;
+
 void initSerial() {
-  Serial.begin(9600);
+  Serial.begin(SERIAL_BAUD);
   while (!Serial) {
     ; // Wait for serial port (needed for some boards)
   }
-  Serial.println(F("Cellar Pump Controller started"));
+  Serial.println(fstr(STR_BANNER));
 }
 
-void logPumpOn() {
-  Serial.print(F("Pump ON  | Temp: "));
+void logPumpOn(PumpTrigger trigger) {
+  serialHold();
+  Serial.print(fstr(STR_LOG_PUMP_ON));
   Serial.print(temperature, 1);
-  Serial.print(F("C | Hum: "));
+  Serial.print(fstr(STR_LOG_HUMIDITY));
   Serial.print(humidity, 1);
-  Serial.println(F("%"));
+  Serial.print(fstr(STR_LOG_PERCENT));
+  if (trigger == TRIGGER_FLOAT) Serial.print(fstr(STR_LOG_BY_FLOAT));
+  Serial.println();
 }
 
 void logPumpOff() {
-  Serial.print(F("Pump OFF | Temp: "));
+  serialHold();
+  Serial.print(fstr(STR_LOG_PUMP_OFF));
   Serial.print(temperature, 1);
-  Serial.print(F("C | Hum: "));
+  Serial.print(fstr(STR_LOG_HUMIDITY));
   Serial.print(humidity, 1);
-  Serial.println(F("%"));
+  Serial.println(fstr(STR_LOG_PERCENT));
+}
+
+void logPreset(const Config& c) {
+  serialHold();
+  char label[17];
+  formatPresetLabel(label, sizeof(label), c);
+  Serial.print(fstr(STR_LOG_PRESET));
+  Serial.println(label);
 }
 
 #endif // ENABLE_SERIAL_LOGGING
 
+// =============================================================================
+// HISTORY
+// =============================================================================
+// About a week of 5-minute temperature/humidity samples, delta-compressed
+// in RAM (include/history.h). Checkpointed to EEPROM every few hours, one
+// byte per loop pass, as [magic][size u16][state][CRC-16 LE]; the magic is
+// cleared first and written last, so a torn checkpoint is never loaded.
+// After a restore the next sample starts a new block, marking the gap.
+// =============================================================================
+
+#ifdef ENABLE_HISTORY
+
+#include "history.h"
+
+const unsigned long HISTORY_SAMPLE_INTERVAL     = 5_min;
+const unsigned long HISTORY_CHECKPOINT_INTERVAL = 6_h;
+
+const int     EEPROM_ADDR_HISTORY  = 512; // after the config slots and the rule
+const uint8_t HISTORY_MAGIC        = 0x48;
+const uint8_t HISTORY_HEADER_SIZE  = 3;
+const int     HISTORY_STATE_SIZE   = sizeof(HistoryLog);
+const int     HISTORY_CHECKPOINT_END = EEPROM_ADDR_HISTORY + HISTORY_HEADER_SIZE + HISTORY_STATE_SIZE + 2;
+static_assert(HISTORY_CHECKPOINT_END <= TARGET_EEPROM_SIZE, "history checkpoint outgrew the EEPROM");
+
+HistoryLog history;
+unsigned long lastHistorySample = 0;
+
+// Checkpoint in progress: next byte to write, or -1 when idle
+int      checkpointPos = -1;
+uint16_t checkpointCrc = CRC16_INIT;
+uint16_t checkpointStamp = 0;     // history.appendCount() at the start
+unsigned long lastCheckpoint = 0;
+
+// Called with every filtered reading (tenths).
+void recordHistory(int16_t temperature, int16_t humidity) {
+  unsigned long now = millis();
+  if (history.appendCount() > 0 && now - lastHistorySample < HISTORY_SAMPLE_INTERVAL) return;
+  lastHistorySample = now;
+  history.append(temperature, humidity);
+}
+
+void loadHistoryFromEEPROM() {
+  int addr = EEPROM_ADDR_HISTORY;
+  uint16_t size = eepromCache.read(addr + 1) | (eepromCache.read(addr + 2) << 8);
+  if (eepromCache.read(addr) != HISTORY_MAGIC || size != HISTORY_STATE_SIZE) return;
+
+  uint8_t* state = history.data();
+  uint16_t crc = CRC16_INIT;
+  for (int i = 0; i < HISTORY_STATE_SIZE; i++) {
+    state[i] = eepromCache.read(addr + HISTORY_HEADER_SIZE + i);
+    crc = crc16Update(crc, state[i]);
+  }
+  int end = addr + HISTORY_HEADER_SIZE + HISTORY_STATE_SIZE;
+  uint16_t stored = eepromCache.read(end) | (eepromCache.read(end + 1) << 8);
+  if (stored != crc || !history.consistent()) {
+    history.clear();
+    return;
+  }
+  history.breakBlock();
+}
+
+// Advance a checkpoint by at most one EEPROM byte. Call every loop pass.
+void serviceHistoryCheckpoint(unsigned long now) {
+  TRACE_SCOPE("historyCheckpoint");
+  int addr = EEPROM_ADDR_HISTORY;
+  if (checkpointPos < 0) {
+    if (now - lastCheckpoint < HISTORY_CHECKPOINT_INTERVAL || history.appendCount() == 0) return;
+    if (!eepromCache.writeNow(addr, 0xFF)) return; // invalidate until complete
+    checkpointPos = 0;
+    checkpointCrc = CRC16_INIT;
+    checkpointStamp = history.appendCount();
+    return;
+  }
+  if (history.appendCount() != checkpointStamp) {
+    // A sample arrived mid-way: start over so the copy is consistent
+    checkpointPos = 0;
+    checkpointCrc = CRC16_INIT;
+    checkpointStamp = history.appendCount();
+  }
+
+  // Each step retries on the next pass while the EEPROM is busy
+  if (checkpointPos < HISTORY_STATE_SIZE) {
+    uint8_t b = history.data()[checkpointPos];
+    if (!eepromCache.writeNow(addr + HISTORY_HEADER_SIZE + checkpointPos, b)) return;
+    checkpointCrc = crc16Update(checkpointCrc, b);
+  } else {
+    int end = addr + HISTORY_HEADER_SIZE + HISTORY_STATE_SIZE;
+    bool done = false;
+    switch (checkpointPos - HISTORY_STATE_SIZE) {
+      case 0: done = eepromCache.writeNow(end, checkpointCrc & 0xFF); break;
+      case 1: done = eepromCache.writeNow(end + 1, checkpointCrc >> 8); break;
+      case 2: done = eepromCache.writeNow(addr + 1, HISTORY_STATE_SIZE & 0xFF); break;
+      case 3: done = eepromCache.writeNow(addr + 2, HISTORY_STATE_SIZE >> 8); break;
+      default:
+        if (!eepromCache.writeNow(addr, HISTORY_MAGIC)) return;
+        checkpointPos = -1;
+        lastCheckpoint = now;
+        return;
+    }
+    if (!done) return;
+  }
+  checkpointPos++;
+}
+
+#endif // ENABLE_HISTORY
+
 // =============================================================================
 // TEMPERATURE & HUMIDITY SENSOR (Grove DHT20, I2C)
 // =============================================================================
@@ -174,22 +796,64 @@ void logPumpOff() {
 #ifdef ENABLE_TEMP_HUMIDITY_SENSOR
 
 #include "DHT.h"
+#include "sensor_filter.h"
 
 DHT dht(DHT20);
 
+// Spike filter: median of the last N reads, then a slew-rate limit.
+// Values are in tenths (0.1 C / 0.1 %RH), one read per SENSOR_READ_INTERVAL.
+const uint8_t SENSOR_FILTER_WINDOW = 5;  // rejects up to 2 consecutive spikes
+const int16_t TEMP_MAX_STEP        = 5;  // 0.5 C per read
+const int16_t HUMIDITY_MAX_STEP    = 20; // 2.0 %RH per read
+
+// DHT20 operating range; anything outside is a corrupted read
+const int16_t TEMP_MIN_VALID     = -400; // -40.0 C
+const int16_t TEMP_MAX_VALID     = 800;  //  80.0 C
+const int16_t HUMIDITY_MAX_VALID = 1000; // 100.0 %RH
+
+SpikeFilter<SENSOR_FILTER_WINDOW> temperatureFilter(TEMP_MAX_STEP);
+SpikeFilter<SENSOR_FILTER_WINDOW> humidityFilter(HUMIDITY_MAX_STEP);
+
+const uint8_t SENSOR_ALARM_FAILURES = 5; // failed reads in a row that raise an alarm
+uint8_t sensorFailures = 0;              // failed reads in a row (saturating)
+
 void initSensor() {
   dht.begin();
 }
 
-// Reads temperature and humidity into global variables.
-void readSensor() {
+// True if the published reading is recent enough to measure against
+bool sensorReadingValid() {
+  return present(PERIPHERAL_SENSOR) && humidityFilter.hasValue() &&
+         sensorFailures < SENSOR_ALARM_FAILURES;
+}
+
+// Reads temperature and humidity, filters them and publishes the result
+// into the global variables. False if the read failed (nothing published).
+bool readSensor() {
+  TRACE_SCOPE("readSensor");
   float values[2];
-  if (!dht.readTempAndHumidity(values)) {
-    // values[0] = humidity, values[1] = temperature (DHT20 convention)
-    humidity = values[0];
-    temperature = values[1];
+  metricAdd(MET_SENSOR_READS);
+  // On failure, or a reading out of range, keep previous values
+  // (values[0] = humidity, values[1] = temperature: DHT20 convention)
+  if (dht.readTempAndHumidity(values) ||
+      !(values[0] >= 0.0f && values[0] <= HUMIDITY_MAX_VALID / 10.0f) ||
+      !(values[1] >= TEMP_MIN_VALID / 10.0f && values[1] <= TEMP_MAX_VALID / 10.0f)) {
+    metricAdd(MET_SENSOR_ERRORS);
+    if (sensorFailures < 0xFF) sensorFailures++;
+    return false;
   }
-  // On failure, keep previous values
+  sensorFailures = 0;
+
+  const Config& c = activeConfig();
+  int16_t rawHumidity    = toTenths(values[0]) + c.humidityOffset;
+  int16_t rawTemperature = toTenths(values[1]) + c.tempOffset;
+  humidity    = humidityFilter.update(rawHumidity) / 10.0f;
+  temperature = temperatureFilter.update(rawTemperature) / 10.0f;
+
+#ifdef ENABLE_HISTORY
+  recordHistory(temperatureFilter.value(), humidityFilter.value());
+#endif
+  return true;
 }
 
 #endif // ENABLE_TEMP_HUMIDITY_SENSOR
@@ -200,16 +864,28 @@ void readSensor() {
 
 #ifdef ENABLE_DISPLAY
 
-#include "rgb_lcd.h"
+#include "lcd_transport.h"
+
+CoalescedLcd lcd;
+
+unsigned int lastDisplayMicros = 0; // cost of the last updateDisplay()
+unsigned int maxDisplayMicros = 0;  // worst since boot
 
-rgb_lcd lcd;
+#ifdef ENABLE_DISPLAY_SLEEP
+bool displayAsleep = false;
+unsigned long displayIdleSince = 0; // last button press (or display start)
+#endif
 
 void initDisplay() {
   lcd.begin(16, 2);
 #ifdef ENABLE_DISPLAY_RGB
   lcd.setRGB(0, 0, 0);
 #endif
-  lcd.print("Initializing...");
+  lcd.print(fstr(STR_INITIALIZING));
+#ifdef ENABLE_DISPLAY_SLEEP
+  displayAsleep = false;
+  displayIdleSince = millis();
+#endif
 }
 
 #ifdef ENABLE_DISPLAY_RGB
@@ -229,27 +905,38 @@ void setBacklightOff() {
   lcd.setRGB(0, 0, 0);
 }
 
+#ifdef ENABLE_ALARMS
+// Set backlight to amber (an alarm has been raised)
+void setBacklightAmber() {
+  lcd.setRGB(100, 40, 0);
+}
+#endif
+
 #endif // ENABLE_DISPLAY_RGB
 
 // Update the LCD with current status.
 void updateDisplay() {
+  TRACE_SCOPE("updateDisplay");
   lcd.clear();
   delay(2); // LCD needs brief delay after clear
 
   // --- Line 1: Temperature & Humidity ---
 #ifdef ENABLE_TEMP_HUMIDITY_SENSOR
-  char line1[17];
-  // Format: "T:xx.xC H:xx.x%"
-  dtostrf(temperature, 4, 1, line1);
-  char humStr[6];
-  dtostrf(humidity, 4, 1, humStr);
-
-  char buf1[17];
-  snprintf(buf1, sizeof(buf1), "T:%sC H:%s%%", line1, humStr);
-  lcd.print(buf1);
-#else
-  lcd.print("No sensor");
+  if (present(PERIPHERAL_SENSOR)) {
+    char line1[17];
+    // Format: "T:xx.xC H:xx.x%"
+    dtostrf(temperature, 4, 1, line1);
+    char humStr[6];
+    dtostrf(humidity, 4, 1, humStr);
+
+    char buf1[17];
+    snprintf_P(buf1, sizeof(buf1), pstr(STR_FMT_CLIMATE), line1, humStr);
+    lcd.print(buf1);
+  } else
 #endif
+  {
+    lcd.print(fstr(STR_NO_SENSOR));
+  }
 
   // --- Line 2: Pump status & countdown ---
   lcd.setCursor(0, 1);
@@ -259,27 +946,30 @@ void updateDisplay() {
     // Show seconds remaining until pump turns off
     unsigned long elapsed = millis() - pumpStartTime;
     unsigned long remaining = 0;
-    if (elapsed < pumpOnDuration) {
-      remaining = (pumpOnDuration - elapsed) / 1000;
+    if (elapsed < pumpRunDuration) {
+      remaining = (pumpRunDuration - elapsed) / 1000;
     }
-    snprintf(line2, sizeof(line2), "Pump on %lus", remaining);
+    snprintf_P(line2, sizeof(line2), pstr(STR_FMT_PUMP_ON), remaining);
+  } else if (demandMode()) {
+    // No countdown: the float switch starts the next run
+    strcpy_P(line2, pstr(STR_PUMP_OFF_FLOAT));
   } else {
     // Show time remaining until next activation
     unsigned long elapsed = millis() - pumpStopTime;
     unsigned long remainingMs = 0;
-    if (elapsed < pumpCycleInterval) {
-      remainingMs = pumpCycleInterval - elapsed;
+    if (elapsed < pumpCycleInterval()) {
+      remainingMs = pumpCycleInterval() - elapsed;
     }
     unsigned long remainingSec = remainingMs / 1000;
     if (remainingSec <= 120) {
-      snprintf(line2, sizeof(line2), "Pump off %lus", remainingSec);
+      snprintf_P(line2, sizeof(line2), pstr(STR_FMT_PUMP_OFF_S), remainingSec);
     } else {
       unsigned long remainingMin = (remainingSec + 30) / 60;
       if (remainingMin > 120) {
         unsigned long remainingHours = (remainingMin + 30) / 60;
-        snprintf(line2, sizeof(line2), "Pump off %luh", remainingHours);
+        snprintf_P(line2, sizeof(line2), pstr(STR_FMT_PUMP_OFF_H), remainingHours);
       } else {
-        snprintf(line2, sizeof(line2), "Pump off %lum", remainingMin);
+        snprintf_P(line2, sizeof(line2), pstr(STR_FMT_PUMP_OFF_M), remainingMin);
       }
     }
   }
@@ -287,15 +977,22 @@ void updateDisplay() {
 
   // --- Backlight color ---
 #ifdef ENABLE_DISPLAY_RGB
+#ifdef ENABLE_ALARMS
+  if (alarmState.latched) {
+    setBacklightAmber();
+  } else
+#endif
   if (pumpRunning) {
     setBacklightRed();
+  } else if (demandMode()) {
+    setBacklightOff();
   } else {
     unsigned long elapsed = millis() - pumpStopTime;
     unsigned long remainingMs = 0;
-    if (elapsed < pumpCycleInterval) {
-      remainingMs = pumpCycleInterval - elapsed;
+    if (elapsed < pumpCycleInterval()) {
+      remainingMs = pumpCycleInterval() - elapsed;
     }
-    if (remainingMs < GREEN_THRESHOLD) {
+    if (remainingMs < activeConfig().greenThreshold) {
       setBacklightGreen();
     } else {
       setBacklightOff();
@@ -313,6 +1010,8 @@ void updateDisplay() {
 #if defined(ENABLE_PRESET_BUTTON) && defined(ENABLE_DISPLAY)
 
 void showPresetOverlay() {
+  TRACE_SCOPE("showPresetOverlay");
+  if (!present(PERIPHERAL_DISPLAY)) return;
   overlayStartTime = millis();
   overlayShowing = true;
   lcd.clear();
@@ -320,161 +1019,1882 @@ void showPresetOverlay() {
 #ifdef ENABLE_DISPLAY_RGB
   lcd.setRGB(0, 0, 100); // blue during overlay
 #endif
-  lcd.print(F("Preset:"));
+  lcd.print(fstr(STR_PRESET_TITLE));
   lcd.setCursor(0, 1);
-  lcd.print(PRESETS[currentPreset].label);
+  char label[17];
+  formatPresetLabel(label, sizeof(label), upcomingConfig());
+  lcd.print(label);
 }
 
 #endif // ENABLE_PRESET_BUTTON && ENABLE_DISPLAY
 
 // =============================================================================
-// PUMP / RELAY CONTROL
+// PERIPHERAL DETECTION
+// =============================================================================
+// The compiled-in I2C devices are probed at boot with an address-only write
+// (a device ACKs its address) and only the ones that answer are used; an
+// absent display or sensor costs no bus time beyond one address byte per
+// PERIPHERAL_PROBE_INTERVAL. A device that turns up later is initialized
+// and used from then on; one that misses two probes in a row is dropped
+// (a single NAK can be noise on the bus).
 // =============================================================================
 
-void initRelay() {
-  pinMode(RELAY_PIN, OUTPUT);
-  digitalWrite(RELAY_PIN, LOW);
-}
+const uint8_t DISPLAY_I2C_ADDRESS = 0x3E; // LCD controller (backlight at 0x30/0x62)
+const uint8_t SENSOR_I2C_ADDRESS  = 0x38; // DHT20
 
-// Activate the pump (relay on)
-void pumpOn() {
-  if (pumpRunning) return; // Already on
+const unsigned long PERIPHERAL_PROBE_INTERVAL = 1_min;
 
-  digitalWrite(RELAY_PIN, HIGH);
-  pumpRunning = true;
-  pumpStartTime = millis();
+unsigned long lastPeripheralProbe = 0;
+uint8_t peripheralsMissed = 0;  // in use, but missed the last probe
 
-#ifdef ENABLE_SERIAL_LOGGING
-  logPumpOn();
-#endif
+bool probeI2c(uint8_t address) {
+  Wire.beginTransmission(address);
+  return Wire.endTransmission() == 0;
 }
 
-// Deactivate the pump (relay off)
-void pumpOff() {
-  if (!pumpRunning) return; // Already off
-
-  digitalWrite(RELAY_PIN, LOW);
-  pumpRunning = false;
-  pumpStopTime = millis();
-
-#ifdef ENABLE_SERIAL_LOGGING
-  logPumpOff();
+// Bitmask of the compiled-in peripherals that answer now.
+uint8_t probePeripherals() {
+  uint8_t found = 0;
+#ifdef ENABLE_DISPLAY
+  if (probeI2c(DISPLAY_I2C_ADDRESS)) found |= PERIPHERAL_DISPLAY;
 #endif
+#ifdef ENABLE_TEMP_HUMIDITY_SENSOR
+  if (probeI2c(SENSOR_I2C_ADDRESS)) found |= PERIPHERAL_SENSOR;
+#endif
+  return found;
 }
 
-// Non-blocking pump state machine.
-// Call this every loop iteration.
-void updatePump() {
-  unsigned long now = millis();
-
-  if (pumpRunning) {
-    // Turn off after pumpOnDuration
-    if (now - pumpStartTime >= pumpOnDuration) {
-      pumpOff();
-    }
-  } else {
-    // Turn on after pumpCycleInterval since last stop
-    if (now - pumpStopTime >= pumpCycleInterval) {
-      pumpOn();
-    }
-  }
-}
-
-// =============================================================================
-// SETUP
-// =============================================================================
-
-void setup() {
 #ifdef ENABLE_SERIAL_LOGGING
-  initSerial();
+void logPeripherals() {
+  serialHold();
+  char line[28];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_DEVICES),
+             present(PERIPHERAL_DISPLAY) ? 1 : 0, present(PERIPHERAL_SENSOR) ? 1 : 0);
+  Serial.println(line);
+}
 #endif
 
-  Wire.begin();
-
+// Probe and start whatever answers. At boot, and again on every change.
+void startPeripherals(uint8_t found) {
+  uint8_t arrived = found & ~peripherals;
+  peripherals = found;
 #ifdef ENABLE_TEMP_HUMIDITY_SENSOR
-  initSensor();
+  if (arrived & PERIPHERAL_SENSOR) {
+    temperatureFilter.reset(); // old readings may be long stale
+    humidityFilter.reset();
+    initSensor();
+  }
 #endif
-
 #ifdef ENABLE_DISPLAY
-  initDisplay();
+  if (arrived & PERIPHERAL_DISPLAY) {
+    initDisplay();
+    lastDisplayUpdate = millis() - DISPLAY_UPDATE_INTERVAL; // full repaint next pass
+  }
 #endif
+}
 
-#ifdef ENABLE_PRESET_BUTTON
-  pinMode(BUTTON_PIN, INPUT);
-  applyPreset(loadPresetFromEEPROM());
-#ifdef ENABLE_DISPLAY
-  showPresetOverlay();
-#endif
+// Re-probe every PERIPHERAL_PROBE_INTERVAL. Call every loop pass.
+void servicePeripherals(unsigned long now) {
+  TRACE_SCOPE("servicePeripherals");
+  if (now - lastPeripheralProbe < PERIPHERAL_PROBE_INTERVAL) return;
+  lastPeripheralProbe = now;
+  uint8_t found = probePeripherals();
+  uint8_t missing = peripherals & ~found;
+  metricAdd(MET_PROBE_MISSES, __builtin_popcount(missing));
+  found |= missing & ~peripheralsMissed; // first miss: keep it for now
+  peripheralsMissed = missing;
+  if (found == peripherals) return;
+  startPeripherals(found);
 #ifdef ENABLE_SERIAL_LOGGING
-  Serial.print(F("Preset -> "));
-  Serial.println(PRESETS[currentPreset].label);
-#endif
+  logPeripherals();
 #endif
-
-  initRelay();
-
-  // Upon startup, turn the pump on immediately.
-  // pumpStopTime is 0 so the first cycle triggers right away,
-  // but we explicitly call pumpOn() for clarity.
-  pumpOn();
 }
 
 // =============================================================================
-// MAIN LOOP
+// RULE ENGINE
+// =============================================================================
+// Optional site-specific rule, compiled on the host (tools/rulec.py) and
+// stored in EEPROM as [length][bytecode ...][CRC-16 LE over length+code].
+// It runs from EEPROM at every scheduled pump start and decides run, skip
+// or run time; see include/rule_vm.h. Without a valid rule, every cycle
+// runs as the preset says.
 // =============================================================================
 
-void loop() {
-  unsigned long now = millis();
+#ifdef ENABLE_RULES
 
-  // --- Check preset button ---
-#ifdef ENABLE_PRESET_BUTTON
-  {
-    bool reading = digitalRead(BUTTON_PIN);
-    if (reading != lastButtonState) {
-      lastDebounceTime = now;
-    }
-    if ((now - lastDebounceTime) >= DEBOUNCE_MS) {
-      // Stable reading — detect rising edge (press)
-      static bool stableState = LOW;
-      if (reading != stableState) {
-        stableState = reading;
-        if (stableState == HIGH) {
-          // Button just pressed — cycle to next preset
-          uint8_t next = (currentPreset + 1) % PRESET_COUNT;
-          applyPreset(next);
-          savePresetToEEPROM(next);
-
-          // Reset pump timers: turn pump off and restart countdown
-          if (pumpRunning) {
-            digitalWrite(RELAY_PIN, LOW);
-            pumpRunning = false;
-          }
-          pumpStopTime = now;
-
-          // Show overlay on LCD
-#ifdef ENABLE_DISPLAY
-          showPresetOverlay();
-#endif
+#include "rule_vm.h"
 
-#ifdef ENABLE_SERIAL_LOGGING
-          Serial.print(F("Preset -> "));
-          Serial.println(PRESETS[currentPreset].label);
-#endif
-        }
-      }
-    }
-    lastButtonState = reading;
-  }
-#endif // ENABLE_PRESET_BUTTON
+const int     EEPROM_ADDR_RULE = 2 * EEPROM_CONFIG_SLOT_SIZE;
+const uint8_t RULE_BLOB_MAX    = 1 + RULE_MAX_CODE + 2;
 
-  // --- Update pump state (non-blocking) ---
-  updatePump();
+enum RuleLoadStatus : uint8_t {
+  RULE_LOAD_OK,
+  RULE_LOAD_ERR_SIZE,
+  RULE_LOAD_ERR_CRC,
+  RULE_LOAD_ERR_PROGRAM,
+};
+
+uint8_t ruleLength = 0;           // bytes of verified code in EEPROM, 0 = none
+uint8_t ruleSkipCount = 0;        // consecutive skipped cycles
+RuleDecision lastRuleDecision = RULE_RUN;
+unsigned int lastRuleMicros = 0;  // cost of the last evaluation
+unsigned int maxRuleMicros = 0;   // worst evaluation since boot
+
+// Wall clock for time-of-day rules, set over serial ("time HH:MM")
+const int16_t CLOCK_UNSET = -1;
+int16_t       clockMinute = CLOCK_UNSET; // minute of day at clockSetAt
+unsigned long clockSetAt = 0;
+
+struct EepromRuleFetch {
+  uint8_t operator()(uint8_t pc) const { return eepromCache.read(EEPROM_ADDR_RULE + 1 + pc); }
+};
+
+struct RamRuleFetch {
+  const uint8_t* code;
+  uint8_t operator()(uint8_t pc) const { return code[pc]; }
+};
+
+int16_t clampToInt16(unsigned long v) {
+  return v > 0x7FFF ? 0x7FFF : (int16_t)v;
+}
+
+void setClock(int16_t minuteOfDay) {
+  clockMinute = minuteOfDay;
+  clockSetAt = millis();
+}
+
+int16_t minuteOfDay() {
+  if (clockMinute == CLOCK_UNSET) return CLOCK_UNSET;
+  // Re-anchor once a day so millis() wrap-around never matters
+  while (millis() - clockSetAt >= 1_day) clockSetAt += 1_day;
+  return (clockMinute + (millis() - clockSetAt) / 1_min) % (24 * 60);
+}
+
+// Check the stored rule and remember its length; 0 if absent or corrupt.
+void loadRuleFromEEPROM() {
+  ruleLength = 0;
+  uint8_t len = eepromCache.read(EEPROM_ADDR_RULE);
+  if (len == 0 || len > RULE_MAX_CODE) return;
+  uint16_t crc = crc16Update(CRC16_INIT, len);
+  for (uint8_t i = 0; i < len; i++) crc = crc16Update(crc, eepromCache.read(EEPROM_ADDR_RULE + 1 + i));
+  uint16_t stored = eepromCache.read(EEPROM_ADDR_RULE + 1 + len) |
+                    (eepromCache.read(EEPROM_ADDR_RULE + 2 + len) << 8);
+  if (crc != stored || !ruleVerify(EepromRuleFetch(), len)) return;
+  ruleLength = len;
+}
+
+// Validate a rule blob and store it. The length byte is committed after the
+// code and CRC; an interrupted store leaves code that fails the CRC of
+// either length, so no rule rather than half a rule. A zero-length blob
+// removes the rule.
+RuleLoadStatus storeRule(const uint8_t* blob, uint8_t size) {
+  if (size < 3 || blob[0] > RULE_MAX_CODE || size != blob[0] + 3) return RULE_LOAD_ERR_SIZE;
+  uint8_t len = blob[0];
+  uint16_t stored = blob[1 + len] | (blob[2 + len] << 8);
+  if (crc16(blob, 1 + len) != stored) return RULE_LOAD_ERR_CRC;
+  if (!ruleVerify(RamRuleFetch{ blob + 1 }, len)) return RULE_LOAD_ERR_PROGRAM;
+
+  for (uint8_t i = 1; i < size; i++) eepromCache.write(EEPROM_ADDR_RULE + i, blob[i]);
+  eepromCache.writeLast(EEPROM_ADDR_RULE, len);
+  loadRuleFromEEPROM();
+  ruleSkipCount = 0;
+  return RULE_LOAD_OK;
+}
+
+void clearRule() {
+  eepromCache.write(EEPROM_ADDR_RULE, 0);
+  ruleLength = 0;
+}
+
+#ifdef ENABLE_SERIAL_LOGGING
+void logRuleDecision(const RuleResult& r) {
+  serialHold();
+  Serial.print(fstr(STR_LOG_RULE));
+  if (r.decision == RULE_SKIP) {
+    Serial.println(fstr(STR_RULE_SKIP));
+  } else if (r.decision == RULE_ERROR) {
+    Serial.println(fstr(STR_RULE_ERROR));
+  } else {
+    Serial.print(fstr(STR_RULE_RUN));
+    if (r.runSeconds > 0) {
+      Serial.print(' ');
+      Serial.print(r.runSeconds);
+      Serial.print('s');
+    }
+    Serial.println();
+  }
+}
+#endif
+
+// Evaluate the rule for a cycle that is due. Returns false to skip the
+// cycle; may replace duration (ms). Errors fall back to running normally.
+bool ruleAllowsRun(unsigned long& duration) {
+  TRACE_SCOPE("ruleAllowsRun");
+  if (ruleLength == 0) return true;
+
+  const Config& c = activeConfig();
+  const PresetTiming& t = c.presets[c.preset];
+  int16_t vars[RULE_VAR_COUNT];
+  vars[VAR_TEMPERATURE]   = toTenths(temperature);
+  vars[VAR_HUMIDITY]      = toTenths(humidity);
+  vars[VAR_MINUTE_OF_DAY] = minuteOfDay();
+  vars[VAR_UPTIME_HOURS]  = (int16_t)(millis() / 1_h);
+  vars[VAR_RUN_COUNT]     = clampToInt16(pumpRunCount);
+  vars[VAR_SKIP_COUNT]    = ruleSkipCount;
+  vars[VAR_PRESET]        = c.preset + 1;
+  vars[VAR_ON_SECONDS]    = clampToInt16(t.onDuration / 1_s);
+  vars[VAR_CYCLE_MINUTES] = clampToInt16(t.cycleInterval / 1_min);
+
+  unsigned long start = micros();
+  RuleResult r = ruleEvaluate(EepromRuleFetch(), ruleLength, vars);
+  lastRuleMicros = micros() - start;
+  if (lastRuleMicros > maxRuleMicros) maxRuleMicros = lastRuleMicros;
+  lastRuleDecision = r.decision;
+
+#ifdef ENABLE_SERIAL_LOGGING
+  logRuleDecision(r);
+#endif
+
+  if (r.decision == RULE_SKIP) {
+    if (ruleSkipCount < 0xFF) ruleSkipCount++;
+    return false;
+  }
+  ruleSkipCount = 0;
+  if (r.decision == RULE_RUN && r.runSeconds > 0) duration = r.runSeconds * 1_s;
+  return true;
+}
+
+#endif // ENABLE_RULES
+
+// =============================================================================
+// DISPLAY SLEEP
+// =============================================================================
+// After DISPLAY_SLEEP_TIMEOUT without a button press the backlight goes off
+// and the LCD is blanked; nothing is rendered, so the display costs no bus
+// time until a press wakes it. That press only wakes the display (it does
+// not step the preset), and the screen is repainted from the current state
+// in the same loop pass. An alarm wakes the display and keeps it awake.
+// =============================================================================
+
+#ifdef ENABLE_DISPLAY_SLEEP
+
+// Conditions someone walking past should see
+bool displayAlarm() {
+  bool alarm = false;
+#ifdef ENABLE_TEMP_HUMIDITY_SENSOR
+  alarm = alarm || (present(PERIPHERAL_SENSOR) && sensorFailures >= SENSOR_ALARM_FAILURES);
+#endif
+#ifdef ENABLE_RULES
+  alarm = alarm || lastRuleDecision == RULE_ERROR;
+#endif
+#ifdef ENABLE_ALARMS
+  alarm = alarm || alarmState.latched;
+#endif
+#ifdef ENABLE_FLOAT_SWITCH
+  alarm = alarm || (activeConfig().scheduleMode == SCHEDULE_DEMAND && floatFailed);
+#endif
+  return alarm;
+}
+
+void wakeDisplay() {
+  displayAsleep = false;
+  lcd.display();
+  lastDisplayUpdate = millis() - DISPLAY_UPDATE_INTERVAL; // full repaint this pass
+}
+
+// Note a button press. True if it woke the display, in which case the
+// press does nothing else.
+bool displayButtonPress() {
+  displayIdleSince = millis();
+  if (!displayAsleep) return false;
+  wakeDisplay();
+  return true;
+}
+
+// Sleep on the idle timer, wake on alarms. Call every loop pass.
+void serviceDisplaySleep(unsigned long now) {
+  if (!present(PERIPHERAL_DISPLAY)) return;
+  bool alarm = displayAlarm();
+  if (displayAsleep) {
+    if (alarm) wakeDisplay();
+  } else if (!alarm && now - displayIdleSince >= DISPLAY_SLEEP_TIMEOUT) {
+    displayAsleep = true;
+#ifdef ENABLE_DISPLAY_RGB
+    setBacklightOff();
+#endif
+    lcd.noDisplay();
+  }
+}
+
+#endif // ENABLE_DISPLAY_SLEEP
+
+// =============================================================================
+// DATA LOGGER
+// =============================================================================
+// Persistent history on an external SPI NOR flash: a sensor record every
+// LOG_SENSOR_INTERVAL plus boot and pump on/off events, appended through
+// LogStore (include/log_store.h). Records reach the flash a page at a time;
+// LOG_FLUSH_INTERVAL bounds what a power cut can lose. Without a flash chip
+// the logger stays inactive.
+// =============================================================================
+
+#ifdef ENABLE_DATA_LOGGER
+
+#include "spi_nor.h"
+#include "log_store.h"
+
+const unsigned long LOG_SENSOR_INTERVAL = 1_min;
+const unsigned long LOG_FLUSH_INTERVAL  = 15_min;
+
+SpiNorFlash flash(FLASH_CS_PIN);
+typedef LogStore<SpiNorFlash, TARGET_LOG_PAGES> DataLog;
+DataLog dataLog(flash);
+unsigned long lastSensorLog = 0;
+unsigned long lastLogFlush = 0;
+
+void initLogger() {
+  if (!flash.begin()) return;
+  dataLog.begin();
+  dataLog.append(LogRecord::value(millis() / 1000, LOG_BOOT, 0));
+}
+
+void logEvent(LogType type, unsigned long value) {
+  dataLog.append(LogRecord::value(millis() / 1000, type, value));
+}
+
+// Call every loop pass; never waits for the flash.
+void serviceLogger(unsigned long now) {
+  TRACE_SCOPE("serviceLogger");
+  if (!dataLog.ready()) return;
+#ifdef ENABLE_TEMP_HUMIDITY_SENSOR
+  if (now - lastSensorLog >= LOG_SENSOR_INTERVAL && present(PERIPHERAL_SENSOR) &&
+      temperatureFilter.hasValue()) {
+    lastSensorLog = now;
+    dataLog.append(LogRecord::pair(now / 1000, LOG_SENSOR, toTenths(temperature), toTenths(humidity)));
+  }
+#endif
+  if (now - lastLogFlush >= LOG_FLUSH_INTERVAL) {
+    lastLogFlush = now;
+    dataLog.flush();
+  }
+  dataLog.service();
+}
+
+#endif // ENABLE_DATA_LOGGER
+
+// =============================================================================
+// ALARMS
+// =============================================================================
+// Threshold alarms on the filtered readings (include/alarms.h): temperature
+// low and high, humidity high, and temperature too close to the dew point.
+// Limits and hysteresis are part of the configuration. They are checked
+// once per published reading, not every loop pass. A raise or clear is
+// printed and goes to the data log; a raised alarm stays latched until
+// "alarm ack", and while latched it turns the backlight amber, keeps the
+// display awake and is reported in the RS-485 status.
+// =============================================================================
+
+#ifdef ENABLE_ALARMS
+
+#ifdef ENABLE_SERIAL_LOGGING
+// "Alarm humidity-high on 85.4"
+void logAlarm(uint8_t id, bool raised, int16_t value) {
+  serialHold();
+  Serial.print(fstr(STR_LOG_ALARM));
+  Serial.print(fstr((StrId)(STR_ALARM_TEMP_LOW + id)));
+  Serial.print(fstr(raised ? STR_ALARM_ON : STR_ALARM_OFF));
+  Serial.println(value / 10.0f, 1);
+}
+#endif
+
+// Check every alarm against a new reading (tenths)
+void checkAlarms(int16_t temperature, int16_t humidity) {
+  TRACE_SCOPE("checkAlarms");
+  int16_t values[ALARM_COUNT];
+  values[ALARM_TEMP_LOW]       = temperature;
+  values[ALARM_TEMP_HIGH]      = temperature;
+  values[ALARM_HUMIDITY_HIGH]  = humidity;
+  values[ALARM_DEW_MARGIN_LOW] = dewPointMargin(temperature, humidity);
+  const Config& c = activeConfig();
+  for (uint8_t id = 0; id < ALARM_COUNT; id++) {
+    int8_t change = alarmState.update(id, values[id], c.alarms[id]);
+    if (change == 0) continue;
+    if (change > 0) metricAdd(MET_ALARMS_RAISED);
+#ifdef ENABLE_SERIAL_LOGGING
+    logAlarm(id, change > 0, values[id]);
+#endif
+#ifdef ENABLE_DATA_LOGGER
+    dataLog.append(LogRecord::pair(millis() / 1000, LOG_ALARM, change * (id + 1), values[id]));
+#endif
+  }
+}
+
+#endif // ENABLE_ALARMS
+
+// =============================================================================
+// RUN RESPONSE
+// =============================================================================
+// How much does a preset's pumping actually move the air? For every pump
+// run the filtered humidity and temperature are taken at the start, at the
+// end and RUN_RESPONSE_DELAY after the end (or at the next start, if that
+// comes first), and logged as one line. The change from the start to the
+// last point is added to the preset's running statistics
+// (include/run_stats.h). Runs without a valid reading at every point, and
+// runs the rule lengthened or shortened, are not counted.
+//
+// EEPROM: [magic] then a [RunResponse][CRC-16 LE] record per preset. Only
+// the record of the preset that ran is rewritten; a torn record fails its
+// CRC and that preset starts over.
+// =============================================================================
+
+#ifdef ENABLE_RUN_STATS
+
+#include "run_stats.h"
+
+const unsigned long RUN_RESPONSE_DELAY = 10_min;
+
+const int     EEPROM_ADDR_RUN_STATS = 352; // between the rule and the history
+const uint8_t RUN_STATS_MAGIC       = 0x52;
+const int     RUN_STATS_RECORD_SIZE = sizeof(RunResponse) + 2;
+const int     RUN_STATS_END         = EEPROM_ADDR_RUN_STATS + 1 + PRESET_COUNT * RUN_STATS_RECORD_SIZE;
+#ifdef ENABLE_RULES
+static_assert(EEPROM_ADDR_RULE + RULE_BLOB_MAX <= EEPROM_ADDR_RUN_STATS, "run statistics overlap the rule");
+#endif
+#ifdef ENABLE_HISTORY
+static_assert(RUN_STATS_END <= EEPROM_ADDR_HISTORY, "run statistics overlap the history");
+#endif
+
+RunResponse runResponses[PRESET_COUNT];
+
+struct RunSample {
+  int16_t temperature; // tenths
+  int16_t humidity;    // tenths
+};
+
+enum RunPhase : uint8_t {
+  RUN_IDLE,      // nothing being measured
+  RUN_PUMPING,   // start taken, waiting for the pump to stop
+  RUN_SETTLING,  // end taken, waiting RUN_RESPONSE_DELAY
+};
+
+RunPhase      runPhase = RUN_IDLE;
+uint8_t       runPreset = 0;
+RunSample     runSamples[3]; // start, end, after
+unsigned long runStopTime = 0;
+
+bool takeRunSample(RunSample& sample) {
+  if (!sensorReadingValid()) return false;
+  sample.temperature = temperatureFilter.value();
+  sample.humidity = humidityFilter.value();
+  return true;
+}
+
+int runStatsRecordAddr(uint8_t preset) {
+  return EEPROM_ADDR_RUN_STATS + 1 + preset * RUN_STATS_RECORD_SIZE;
+}
+
+void loadRunStatsFromEEPROM() {
+  if (eepromCache.read(EEPROM_ADDR_RUN_STATS) != RUN_STATS_MAGIC) return;
+  for (uint8_t p = 0; p < PRESET_COUNT; p++) {
+    int addr = runStatsRecordAddr(p);
+    RunResponse r;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&r);
+    uint16_t crc = CRC16_INIT;
+    for (uint8_t i = 0; i < sizeof(r); i++) {
+      bytes[i] = eepromCache.read(addr + i);
+      crc = crc16Update(crc, bytes[i]);
+    }
+    uint16_t stored = eepromCache.read(addr + sizeof(r)) | (eepromCache.read(addr + sizeof(r) + 1) << 8);
+    if (stored == crc) runResponses[p] = r;
+  }
+}
+
+// Queue the preset's record in the EEPROM cache (unchanged bytes cost nothing)
+void saveRunStats(uint8_t preset) {
+  eepromCache.write(EEPROM_ADDR_RUN_STATS, RUN_STATS_MAGIC);
+  int addr = runStatsRecordAddr(preset);
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&runResponses[preset]);
+  uint16_t crc = CRC16_INIT;
+  for (uint8_t i = 0; i < sizeof(RunResponse); i++) {
+    eepromCache.write(addr + i, bytes[i]);
+    crc = crc16Update(crc, bytes[i]);
+  }
+  eepromCache.write(addr + sizeof(RunResponse), crc & 0xFF);
+  eepromCache.write(addr + sizeof(RunResponse) + 1, crc >> 8);
+}
+
+#ifdef ENABLE_SERIAL_LOGGING
+// "RUN <preset> t=<start>,<end>,<after> h=<start>,<end>,<after>" (0.1 units)
+void logRun() {
+  serialHold();
+  char line[48];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_RUN), runPreset + 1,
+             runSamples[0].temperature, runSamples[1].temperature, runSamples[2].temperature,
+             runSamples[0].humidity, runSamples[1].humidity, runSamples[2].humidity);
+  Serial.println(line);
+}
+#endif
+
+void finishRun() {
+  runPhase = RUN_IDLE;
+  if (!takeRunSample(runSamples[2])) return;
+  runResponses[runPreset].add(runSamples[2].humidity - runSamples[0].humidity,
+                              runSamples[2].temperature - runSamples[0].temperature);
+  saveRunStats(runPreset);
+#ifdef ENABLE_SERIAL_LOGGING
+  logRun();
+#endif
+}
+
+// Called by pumpOn() once the relay is on
+void runStarted(unsigned long duration) {
+  if (runPhase == RUN_SETTLING) finishRun(); // the next run cuts the wait short
+  runPreset = activeConfig().preset;
+  bool counted = duration == pumpOnDuration() && takeRunSample(runSamples[0]);
+  runPhase = counted ? RUN_PUMPING : RUN_IDLE;
+}
+
+// Called by pumpOff() once the relay is off
+void runStopped() {
+  if (runPhase != RUN_PUMPING) return;
+  runStopTime = millis();
+  runPhase = takeRunSample(runSamples[1]) ? RUN_SETTLING : RUN_IDLE;
+}
+
+// Take the last sample when due. Call every loop pass.
+void serviceRunResponse(unsigned long now) {
+  if (runPhase == RUN_SETTLING && now - runStopTime >= RUN_RESPONSE_DELAY) finishRun();
+}
+
+#endif // ENABLE_RUN_STATS
+
+// =============================================================================
+// RS-485 BUS
+// =============================================================================
+// Controllers at one site can share an RS-485 pair on the serial port, with
+// the transceiver's DE and /RE on RS485_DE_PIN. The config's busAddress puts
+// a unit on the bus (0 keeps it off). The coordinator, address 1, broadcasts
+// its clock every BUS_SYNC_INTERVAL; the others follow it, stepping to it
+// once and then slewing half the remaining error per sync. While synced,
+// each unit starts its runs at its own slot in the cycle (see
+// pumpStartDue()), so the runs of busNodes units spread over the interval
+// instead of colliding, and a LOG_SYNC record ties the data log to the
+// site clock. Frames are described in include/bus_frame.h.
+//
+// The transmitter is only enabled for a frame of our own: it waits for the
+// line to be quiet and the UART to be idle, and is released once the last
+// byte has left, checked once per loop pass, so sending never blocks.
+// Nothing else is written while a frame is queued or going out: streamed
+// reports wait (serialBusy()), and a one-off line first waits for the frame
+// in flight to finish (serialHold(), at most a frame: ~40 ms at 9600 baud).
+// =============================================================================
+
+#ifdef ENABLE_RS485
+
+const unsigned long BUS_SYNC_INTERVAL = 1_min;
+const unsigned long BUS_SYNC_TIMEOUT  = 10_min; // free-running again without a sync
+const unsigned long BUS_STEP_LIMIT    = 2_s;    // larger errors are stepped, not slewed
+const unsigned long BUS_QUIET         = 5_ms;   // idle line before transmitting
+
+enum BusTxState : uint8_t {
+  BUS_TX_IDLE,
+  BUS_TX_PENDING, // frame queued, waiting for the line
+  BUS_TX_SENDING, // DE raised, frame in the UART
+};
+
+BusFrameReader busRx;
+bool       busReceiving = false;   // inside a ':' line
+unsigned long busLineActive = 0;   // millis() of the last received byte
+uint8_t    busTxFrame[BUS_FRAME_MAX];
+uint8_t    busTxLen = 0;
+BusTxState busTxState = BUS_TX_IDLE;
+
+long     busClockOffset = 0;       // site time - millis()
+bool     busSynced = false;
+bool     busSyncSent = false;      // coordinator: first sync broadcast
+unsigned long lastBusSync = 0;     // sent (coordinator) or accepted (nodes)
+uint8_t  busNodeCount = 0;         // from the last sync
+unsigned int busFrames = 0;        // frames for us
+unsigned int busErrors = 0;        // malformed frames or bad CRCs
+unsigned int busSteps = 0;         // clock steps
+
+inline uint8_t busAddress() { return activeConfig().busAddress; }
+
+void initBus() {
+  pinMode(RS485_DE_PIN, OUTPUT);
+  digitalWrite(RS485_DE_PIN, LOW);
+}
+
+// The coordinator's millis(), as far as this unit knows
+inline unsigned long busSiteTime(unsigned long now) { return now + busClockOffset; }
+
+// True while runs follow this unit's slot of the site cycle
+inline bool busStaggered() { return busSynced && busNodeCount > 1; }
+
+// Where this unit's slot starts in a cycle of the given interval
+unsigned long busPhase(unsigned long interval) {
+  return ((busAddress() - 1) % busNodeCount) * (interval / busNodeCount);
+}
+
+// True once everything written has left the UART. TXC0 is set when the
+// last stop bit is out, and the core clears it on every write.
+bool serialTxIdle() {
+#ifdef CELLARPUMP_SIM
+  return true; // the host port sends immediately
+#else
+  return Serial.availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1 && (UCSR0A & _BV(TXC0));
+#endif
+}
+
+// The last byte of our frame has left: release the line.
+void busTxDone() {
+  digitalWrite(RS485_DE_PIN, LOW);
+  busTxState = BUS_TX_IDLE;
+}
+
+bool serialBusy() { return busTxState != BUS_TX_IDLE; }
+
+void serialHold() {
+  if (busTxState != BUS_TX_SENDING) return; // a queued frame waits for this line
+  while (!serialTxIdle()) {}
+  busTxDone();
+}
+
+// Queue a frame of len bytes. Frames carrying the site time get it when
+// they go out. False (and nothing queued) while another frame is waiting.
+bool busQueue(const uint8_t* frame, uint8_t len) {
+  if (busTxState != BUS_TX_IDLE) return false;
+  memcpy(busTxFrame, frame, len);
+  busTxLen = len;
+  busTxState = BUS_TX_PENDING;
+  return true;
+}
+
+void busSendStatus() {
+  uint8_t frame[BUS_FRAME_MAX];
+  uint8_t* p = frame;
+  putU8(p, BUS_COORDINATOR);
+  putU8(p, BUS_STATUS);
+  putU32(p, 0); // stamped when sent
+  putU8(p, busAddress());
+  putU8(p, (pumpRunning ? BUS_STATUS_PUMP : 0) | (busSynced ? BUS_STATUS_SYNCED : 0));
+  putU8(p, activeConfig().preset);
+#ifdef ENABLE_ALARMS
+  putU8(p, alarmState.latched);
+#else
+  putU8(p, 0);
+#endif
+  busQueue(frame, p - frame);
+}
+
+// Follow the coordinator's clock, which read site when the frame ended
+void busSyncClock(unsigned long now, unsigned long site) {
+  long error = (long)(site - busSiteTime(now));
+  if (!busSynced || labs(error) > (long)BUS_STEP_LIMIT) {
+    busClockOffset = (long)(site - now);
+    if (busSteps < 0xFFFF) busSteps++;
+#ifdef ENABLE_DATA_LOGGER
+    logEvent(LOG_SYNC, site / 1000);
+#endif
+  } else {
+    busClockOffset += error / 2;
+  }
+  busSynced = true;
+  lastBusSync = now;
+}
+
+// Called by pollSerialCommands() for a line starting with ':'
+void busLineStart() {
+  busRx.begin();
+  busReceiving = true;
+}
+
+void busLineChar(char c) { busRx.feed(c); }
+
+void busLineEnd() {
+  busReceiving = false;
+  uint8_t address = busAddress();
+  if (address == 0) return;
+  if (!busRx.finish()) {
+    if (busErrors < 0xFFFF) busErrors++;
+    return;
+  }
+  if (busRx.address() != BUS_BROADCAST && busRx.address() != address) return;
+  if (busFrames < 0xFFFF) busFrames++;
+
+  const uint8_t* p = busRx.payload();
+  if (busRx.type() == BUS_TIME && busRx.payloadLength() >= 5 && address != BUS_COORDINATOR) {
+    // The stamp was taken as the first character went out
+    unsigned long transit = (busRx.lineLength() + 2) * 10UL * 1000 / SERIAL_BAUD;
+    unsigned long site = getU32(p) + transit;
+    busNodeCount = getU8(p);
+    busSyncClock(millis(), site);
+  } else if (busRx.type() == BUS_POLL && busRx.address() == address) {
+    busSendStatus();
+  }
+}
+
+// Broadcast syncs (coordinator), notice a lost coordinator (nodes) and
+// move a queued frame along. Call every loop pass.
+void serviceBus(unsigned long now) {
+  TRACE_SCOPE("serviceBus");
+  uint8_t address = busAddress();
+  if (address == BUS_COORDINATOR) {
+    busClockOffset = 0;
+    busSynced = true;
+    busNodeCount = activeConfig().busNodes;
+    if ((!busSyncSent || now - lastBusSync >= BUS_SYNC_INTERVAL) && busTxState == BUS_TX_IDLE) {
+      uint8_t frame[BUS_FRAME_MAX];
+      uint8_t* p = frame;
+      putU8(p, BUS_BROADCAST);
+      putU8(p, BUS_TIME);
+      putU32(p, 0); // stamped when sent
+      putU8(p, busNodeCount);
+      busQueue(frame, p - frame);
+      busSyncSent = true;
+      lastBusSync = now;
+    }
+  } else if (busSynced && (address == 0 || now - lastBusSync >= BUS_SYNC_TIMEOUT)) {
+    busSynced = false;
+    busSyncSent = false;
+  }
+
+  if (busTxState == BUS_TX_PENDING && serialTxIdle() && !busReceiving &&
+      now - busLineActive >= BUS_QUIET) {
+    digitalWrite(RS485_DE_PIN, HIGH);
+    uint8_t* p = busTxFrame + 2;
+    if (busTxFrame[1] == BUS_TIME || busTxFrame[1] == BUS_STATUS) putU32(p, busSiteTime(millis()));
+    char line[BUS_LINE_MAX + 1];
+    busFormatFrame(line, busTxFrame, busTxLen);
+    Serial.println(line);
+    busTxState = BUS_TX_SENDING;
+  } else if (busTxState == BUS_TX_SENDING && serialTxIdle()) {
+    busTxDone();
+  }
+}
+
+#endif // ENABLE_RS485
+
+// =============================================================================
+// DIGITAL INPUTS
+// =============================================================================
+// Buttons and contacts, up to 8, listed in InputId. Every
+// INPUT_SAMPLE_INTERVAL the port input registers holding them are read once
+// each, the bits gathered into one sample (bit n = input n, 1 = active) and
+// debounced all together by a vertical counter (include/debounce.h): a
+// change counts once it has held for DEBOUNCE_SAMPLES samples in a row.
+// Debounced edges go to handleInputEvents(). Between ticks the loop pays
+// one time compare, however many inputs there are.
+// =============================================================================
+
+#ifdef ENABLE_DIGITAL_INPUTS
+
+#include "debounce.h"
+
+const unsigned long INPUT_DEBOUNCE_TIME   = 50_ms;
+const unsigned long INPUT_SAMPLE_INTERVAL = INPUT_DEBOUNCE_TIME / DEBOUNCE_SAMPLES;
+
+enum InputId : uint8_t {
+#ifdef ENABLE_PRESET_BUTTON
+  INPUT_BUTTON,
+#endif
+#ifdef ENABLE_FLOAT_SWITCH
+  INPUT_FLOAT,
+#endif
+  INPUT_COUNT
+};
+static_assert(INPUT_COUNT <= 8, "the debouncer takes 8 inputs");
+
+struct InputPin {
+  uint8_t pin;
+  uint8_t mode;       // INPUT or INPUT_PULLUP
+  bool    activeLow;
+};
+
+// In InputId order
+const InputPin INPUT_PINS[INPUT_COUNT] = {
+#ifdef ENABLE_PRESET_BUTTON
+  { BUTTON_PIN, INPUT, false }, // Grove button drives the pin high
+#endif
+#ifdef ENABLE_FLOAT_SWITCH
+  { FLOAT_SWITCH_PIN, INPUT_PULLUP, true },
+#endif
+};
+
+// Distinct ports the inputs live on, and where each input is in them
+volatile uint8_t* inputPorts[INPUT_COUNT];
+uint8_t inputPortCount = 0;
+uint8_t inputPortIndex[INPUT_COUNT];
+uint8_t inputMask[INPUT_COUNT];
+uint8_t inputInvert = 0;             // active-low inputs
+
+VerticalDebouncer inputDebounce;
+unsigned long lastInputSample = 0;
+
+// Read every input port once; bit n is input n, 1 = active
+uint8_t sampleInputs() {
+  uint8_t levels[INPUT_COUNT] = {};
+  for (uint8_t p = 0; p < inputPortCount; p++) levels[p] = *inputPorts[p];
+  uint8_t sample = 0;
+  for (uint8_t i = 0; i < INPUT_COUNT; i++) {
+    if (levels[inputPortIndex[i]] & inputMask[i]) sample |= 1 << i;
+  }
+  return sample ^ inputInvert;
+}
+
+void initInputs() {
+  for (uint8_t i = 0; i < INPUT_COUNT; i++) {
+    const InputPin& in = INPUT_PINS[i];
+    pinMode(in.pin, in.mode);
+    if (in.activeLow) inputInvert |= 1 << i;
+    inputMask[i] = digitalPinToBitMask(in.pin);
+    volatile uint8_t* port = portInputRegister(digitalPinToPort(in.pin));
+    uint8_t p = 0;
+    while (p < inputPortCount && inputPorts[p] != port) p++;
+    if (p == inputPortCount) inputPorts[inputPortCount++] = port;
+    inputPortIndex[i] = p;
+  }
+  inputDebounce.begin(sampleInputs());
+}
+
+#ifdef ENABLE_PRESET_BUTTON
+// Step to the next preset (a run in progress finishes under the old one)
+void buttonPressed() {
+#ifdef ENABLE_DISPLAY_SLEEP
+  // A press on a sleeping display only wakes it
+  if (displayButtonPress()) return;
+#endif
+  Config& edit = beginConfigEdit();
+  edit.preset = (edit.preset + 1) % PRESET_COUNT;
+  commitConfig(COMMIT_AT_PUMP_OFF);
+
+#ifdef ENABLE_DISPLAY
+  showPresetOverlay();
+#endif
+#ifdef ENABLE_SERIAL_LOGGING
+  logPreset(upcomingConfig());
+#endif
+}
+#endif
+
+// Debounced level of an input: true while pressed / closed
+inline bool inputActive(InputId id) { return inputDebounce.state & (1 << id); }
+
+// Act on debounced edges. Inputs that drive the pump (the float switch)
+// are read by updatePump(), which runs right after serviceInputs() in the
+// same loop pass.
+void handleInputEvents(uint8_t activated, uint8_t released) {
+#ifdef ENABLE_PRESET_BUTTON
+  if (activated & (1 << INPUT_BUTTON)) buttonPressed();
+#endif
+  (void)released;
+}
+
+// Sample and debounce on the input tick. Call every loop pass.
+void serviceInputs(unsigned long now) {
+  if (now - lastInputSample < INPUT_SAMPLE_INTERVAL) return;
+  TRACE_SCOPE("serviceInputs");
+  lastInputSample = now;
+  uint8_t changed = inputDebounce.update(sampleInputs());
+  if (changed) handleInputEvents(changed & inputDebounce.state, changed & ~inputDebounce.state);
+}
+
+#endif // ENABLE_DIGITAL_INPUTS
+
+// =============================================================================
+// PUMP / RELAY CONTROL
+// =============================================================================
+// Every run goes through a duty-cycle limit (include/duty_limit.h): at
+// least PUMP_MIN_OFF between runs and at most PUMP_MAX_ON within any
+// PUMP_DUTY_WINDOW, whatever the preset or the rule asks for. A run over
+// the budget is shortened; a denied start counts as a skipped cycle and is
+// reported with its reason.
+//
+// In demand mode (scheduleMode SCHEDULE_DEMAND) the float switch decides
+// instead of the timed cycle: a run starts in the loop pass in which the
+// debounced float rises, and stops once it has dropped (but not before
+// demandMinRun) or at demandMaxRun. A float that is still up at
+// demandMaxRun FLOAT_STUCK_RUNS runs in a row is taken to be stuck, and the
+// timed preset runs until the float is seen down again. A float that has not
+// been up for FLOAT_SILENT_CYCLES cycle intervals of the preset may be a
+// broken wire or just a dry sump; the two read the same, so it is only
+// reported (and keeps the display awake) while the pump stays off.
+// =============================================================================
+
+#include "duty_limit.h"
+
+const unsigned long PUMP_DUTY_WINDOW = 1_h;
+const uint8_t       PUMP_DUTY_BUCKETS = 12;    // 5 minutes each
+const unsigned long PUMP_MAX_ON      = 30_min; // per window: 50 % duty
+const unsigned long PUMP_MIN_OFF     = 30_s;   // rest between runs
+
+DutyLimiter<PUMP_DUTY_BUCKETS> pumpDuty(PUMP_DUTY_WINDOW, PUMP_MAX_ON, PUMP_MIN_OFF);
+unsigned int pumpDenied = 0;               // starts denied since boot (saturating)
+DutyVerdict  lastDutyVerdict = DUTY_OK;    // of the last denied start
+
+#ifdef ENABLE_SERIAL_LOGGING
+void logPumpDenied(DutyVerdict verdict) {
+  serialHold();
+  Serial.print(fstr(STR_LOG_DENIED));
+  Serial.println(fstr(verdict == DUTY_DENY_REST ? STR_DUTY_REST : STR_DUTY_BUDGET));
+}
+#endif
+
+void initRelay() {
+  pinMode(RELAY_PIN, OUTPUT);
+  digitalWrite(RELAY_PIN, LOW);
+}
+
+// Activate the pump (relay on) for the given time (ms), or less if the
+// duty-cycle limit says so. False if the limit denied the run.
+bool pumpOn(unsigned long duration, PumpTrigger trigger = TRIGGER_SCHEDULE) {
+  if (pumpRunning) return true; // Already on
+
+  DutyVerdict verdict = pumpDuty.check(millis(), duration);
+  if (verdict != DUTY_OK) {
+    if (pumpDenied < 0xFFFF) pumpDenied++;
+    lastDutyVerdict = verdict;
+    metricAdd(MET_PUMP_DENIED);
+#ifdef ENABLE_SERIAL_LOGGING
+    logPumpDenied(verdict);
+#endif
+#ifdef ENABLE_DATA_LOGGER
+    logEvent(LOG_DENIED, verdict);
+#endif
+    return false;
+  }
+
+  digitalWrite(RELAY_PIN, HIGH);
+  pumpRunning = true;
+  pumpStartTime = millis();
+  pumpRunDuration = duration;
+  pumpTrigger = trigger;
+  if (pumpRunCount < 0xFFFF) pumpRunCount++;
+
+#ifdef ENABLE_SERIAL_LOGGING
+  logPumpOn(trigger);
+#endif
+#ifdef ENABLE_DATA_LOGGER
+  logEvent(LOG_PUMP_ON, duration / 1000 | (trigger == TRIGGER_FLOAT ? LOG_PUMP_BY_FLOAT : 0));
+#endif
+#ifdef ENABLE_RUN_STATS
+  runStarted(duration);
+#endif
+  return true;
+}
+
+// Deactivate the pump (relay off)
+void pumpOff() {
+  if (!pumpRunning) return; // Already off
+
+  digitalWrite(RELAY_PIN, LOW);
+  pumpRunning = false;
+  pumpStopTime = millis();
+  pumpDuty.stopped(pumpStopTime, pumpStopTime - pumpStartTime);
+
+#ifdef ENABLE_SERIAL_LOGGING
+  logPumpOff();
+#endif
+#ifdef ENABLE_DATA_LOGGER
+  logEvent(LOG_PUMP_OFF, (pumpStopTime - pumpStartTime) / 1000);
+#endif
+#ifdef ENABLE_RUN_STATS
+  runStopped();
+#endif
+
+  // Cycle boundary: publish a configuration deferred until now
+  if (configPublishPending) {
+    publishConfig();
+#ifdef ENABLE_SERIAL_LOGGING
+    logPreset(activeConfig());
+#endif
+  }
+}
+
+// Whether the next run is due, and if so how long ago it became due.
+// Normally a run starts pumpCycleInterval after the last one stopped. On a
+// synced bus it starts at this unit's slot of the site cycle instead, after
+// waiting at least half an interval and at most one and a half.
+bool pumpStartDue(unsigned long now, unsigned long& late) {
+  unsigned long interval = pumpCycleInterval();
+  unsigned long waited = now - pumpStopTime;
+#ifdef ENABLE_RS485
+  if (busStaggered()) {
+    if (waited < interval / 2) return false;
+    unsigned long sinceSlot = (busSiteTime(now) - busPhase(interval)) % interval;
+    if (sinceSlot > waited - interval / 2) return false;
+    late = sinceSlot;
+    return true;
+  }
+#endif
+  if (waited < interval) return false;
+  late = waited - interval;
+  return true;
+}
+
+#ifdef ENABLE_FLOAT_SWITCH
+
+const uint8_t       FLOAT_STUCK_RUNS     = 3;
+const uint8_t       FLOAT_SILENT_CYCLES  = 3;
+const unsigned long FLOAT_RETRY_INTERVAL = PUMP_MIN_OFF; // after a denied start
+
+uint8_t floatLongRuns = 0;          // demand runs in a row that ended at the maximum
+bool    demandStartDenied = false;  // the last start attempt was denied
+unsigned long lastDemandStart = 0;  // when it was made
+unsigned long lastFloatUp = 0;      // when the float was last up (or demand mode began)
+
+void setFloatFailed(FloatFailure failed) {
+  floatFailed = failed;
+  floatLongRuns = 0;
+#ifdef ENABLE_SERIAL_LOGGING
+  serialHold();
+  Serial.println(fstr((StrId)(STR_LOG_FLOAT_OK + failed)));
+#endif
+#ifdef ENABLE_DATA_LOGGER
+  logEvent(LOG_FLOAT, failed);
+#endif
+}
+
+// updatePump() in demand mode
+void updateDemand(unsigned long now) {
+  const Config& c = activeConfig();
+  bool high = inputActive(INPUT_FLOAT);
+  if (!high) floatLongRuns = 0;   // it moves, so it is not stuck
+  if (pumpRunning) {
+    unsigned long ran = now - pumpStartTime;
+    bool demandRun = pumpTrigger == TRIGGER_FLOAT;
+    if (ran >= pumpRunDuration) {
+      bool full = demandRun && high && pumpRunDuration == c.demandMaxRun;
+      pumpOff();
+      if (full && ++floatLongRuns >= FLOAT_STUCK_RUNS) setFloatFailed(FLOAT_STUCK);
+    } else if (demandRun && !high && ran >= c.demandMinRun) {
+      pumpOff();
+    }
+  } else if (high && (!demandStartDenied || now - lastDemandStart >= FLOAT_RETRY_INTERVAL)) {
+    lastDemandStart = now;
+    demandStartDenied = !pumpOn(c.demandMaxRun, TRIGGER_FLOAT);
+  }
+}
+
+#endif // ENABLE_FLOAT_SWITCH
+
+// Non-blocking pump state machine.
+// Call this every loop iteration.
+void updatePump() {
+  TRACE_SCOPE("updatePump");
+  unsigned long now = millis();
+
+#ifdef ENABLE_FLOAT_SWITCH
+  if (activeConfig().scheduleMode == SCHEDULE_DEMAND) {
+    bool high = inputActive(INPUT_FLOAT);
+    if (high) lastFloatUp = now;
+    // A failed float that moves again is trusted again
+    if ((floatFailed == FLOAT_STUCK && !high) || (floatFailed == FLOAT_SILENT && high)) {
+      setFloatFailed(FLOAT_OK);
+    }
+    if (!floatFailed && now - lastFloatUp >= FLOAT_SILENT_CYCLES * pumpCycleInterval()) {
+      setFloatFailed(FLOAT_SILENT);
+    }
+    if (floatFailed != FLOAT_STUCK) {
+      updateDemand(now);
+      return;
+    }
+  } else {
+    lastFloatUp = now; // the silence counts from when demand mode began
+  }
+#endif
+
+  if (pumpRunning) {
+    // Turn off after the run time chosen at pumpOn()
+    if (now - pumpStartTime >= pumpRunDuration) {
+      unsigned long late = now - pumpStartTime - pumpRunDuration;
+      relayTiming.record(late);
+      metricObserve(MET_RELAY_LATE, late);
+      pumpOff();
+    }
+  } else {
+    // Turn on when the next run is due
+    unsigned long late;
+    if (pumpStartDue(now, late)) {
+      unsigned long duration = pumpOnDuration();
+#ifdef ENABLE_RULES
+      if (!ruleAllowsRun(duration)) {
+        pumpStopTime = now; // skip this cycle: wait a full interval again
+        return;
+      }
+#endif
+      if (!pumpOn(duration)) {
+        pumpStopTime = now; // denied: wait a full interval again
+        return;
+      }
+      relayTiming.record(late);
+      metricObserve(MET_RELAY_LATE, late);
+    }
+  }
+}
+
+// =============================================================================
+// SERIAL COMMANDS
+// =============================================================================
+// Line-oriented commands on the serial port (newline terminated):
+//   cfg export        -> "CFG <hex blob>"
+//   cfg import <hex>  -> "CFG OK" or "CFG ERR <code>"
+//   rule load <hex>   -> "RULE OK" or "RULE ERR <code>"
+//   rule clear        -> "RULE OK"
+//   rule show         -> "RULE <hex blob>|none us=<last>/<max>"
+//   time HH:MM        -> "TIME OK" (wall clock for time-of-day rules)
+//   log info          -> "LOG head=.. seq=.. pending=.. written=.. ..."
+//   log dump N        -> last N log pages (at most what the flash holds), one
+//                        "LOG <time>,<type>,..." per record, oldest first,
+//                        then "LOG END"; a line per loop pass
+//   lcd               -> "LCD us=<last>/<max>" (updateDisplay() time)
+//   hist              -> "HIST <samples> <bytes>", then one line per sample,
+//                        oldest first: "HIST <minutes ago>,<temp>,<hum>"
+//                        (0.1 units), then "HIST END"; streamed a line per
+//                        loop pass while the serial buffer has room
+//   ee                -> "EE pending=.. writes=.. ...", then "EE wear <block>:<n> ..."
+//   dev               -> "DEV display=<0|1> sensor=<0|1>" (devices in use)
+//   relay             -> "RELAY switches=.. late=<mean>/<max> ms" (how long
+//                        after its due time each scheduled switch happened)
+//   metrics           -> "M <name>[<unit>] <value>" per metric, then "M END"
+//   metrics every N   -> every N seconds (0 = stop; sooner if loop.passes
+//                        would outgrow a 16-bit delta), "MD ..." lines for
+//                        what changed since the last report, then "MD END"
+//   runs              -> "RUNS <preset> n=<runs> h=<mean>/<sd> t=<mean>/<sd>"
+//                        per preset that has run (change over a run, 0.1
+//                        units), then "RUNS END"; a line per loop pass
+//   bus               -> "BUS addr=.. nodes=.. synced=<0|1> offset=<ms> ..."
+//   duty              -> "DUTY on=<s>/<max s> denied=<n> last=<reason>" (pump
+//                        on-time in the last hour; reason 1 rest, 2 budget)
+//   alarm             -> "ALARM active=<bits> latched=<bits>" (bit n: AlarmId n)
+//   alarm ack         -> the same, after clearing latched alarms that are
+//                        no longer active
+//   float             -> "FLOAT level=<0|1> failed=<0|1|2> long=<n>" (float
+//                        switch; failed: 1 stuck, 2 silent; long: runs in a
+//                        row that hit demandMaxRun)
+// Lines starting with ':' are RS-485 frames (see RS-485 BUS), not commands.
+// The hex of an import is decoded on the fly, so the line itself is never
+// buffered. A blob is only applied once it has been received completely and
+// passed its CRC and range checks.
+// =============================================================================
+
+#ifdef ENABLE_SERIAL_COMMANDS
+
+const uint8_t COMMAND_MAX = 16;
+
+char    commandBuf[COMMAND_MAX + 1];
+uint8_t commandLen = 0;
+bool    commandOverflow = false;
+
+// What the hex payload of the current line is for
+enum ImportTarget : uint8_t {
+  IMPORT_NONE,
+  IMPORT_CONFIG,
+  IMPORT_RULE,
+};
+
+#ifdef ENABLE_RULES
+const uint8_t IMPORT_MAX = (RULE_BLOB_MAX > CONFIG_BLOB_SIZE) ? RULE_BLOB_MAX : CONFIG_BLOB_SIZE;
+#else
+const uint8_t IMPORT_MAX = CONFIG_BLOB_SIZE;
+#endif
+
+ImportTarget importing = IMPORT_NONE;
+uint8_t importBlob[IMPORT_MAX];
+uint8_t importLen = 0;
+int8_t  importHighNibble = -1; // pending high nibble, -1 if none
+bool    importBadInput = false;
+
+int8_t hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+void printHexByte(uint8_t b) {
+  if (b < 0x10) Serial.print('0');
+  Serial.print(b, HEX);
+}
+
+void exportConfig() {
+  uint8_t blob[CONFIG_BLOB_SIZE];
+  encodeConfig(activeConfig(), blob);
+  Serial.print(fstr(STR_REPLY_CFG));
+  for (uint8_t i = 0; i < CONFIG_BLOB_SIZE; i++) printHexByte(blob[i]);
+  Serial.println();
+}
+
+void feedImportHex(char c) {
+  if (c == ' ') return;
+  int8_t v = hexValue(c);
+  if (v < 0 || importLen >= IMPORT_MAX) {
+    importBadInput = true;
+    return;
+  }
+  if (importHighNibble < 0) {
+    importHighNibble = v;
+  } else {
+    importBlob[importLen++] = (importHighNibble << 4) | v;
+    importHighNibble = -1;
+  }
+}
+
+void finishConfigImport() {
+  ConfigStatus status = CONFIG_ERR_SIZE;
+  if (!importBadInput && importHighNibble < 0) {
+    status = decodeConfig(importBlob, importLen, beginConfigEdit());
+    if (status == CONFIG_OK) status = commitConfig(COMMIT_NOW);
+    if (status == CONFIG_OK) logPreset(activeConfig());
+  }
+  if (status == CONFIG_OK) {
+    Serial.println(fstr(STR_REPLY_CFG_OK));
+  } else {
+    Serial.print(fstr(STR_REPLY_CFG_ERR));
+    Serial.println((uint8_t)status);
+  }
+}
+
+#ifdef ENABLE_RULES
+
+void finishRuleImport() {
+  RuleLoadStatus status = RULE_LOAD_ERR_SIZE;
+  if (!importBadInput && importHighNibble < 0) status = storeRule(importBlob, importLen);
+  if (status == RULE_LOAD_OK) {
+    Serial.println(fstr(STR_REPLY_RULE_OK));
+  } else {
+    Serial.print(fstr(STR_REPLY_RULE_ERR));
+    Serial.println((uint8_t)status);
+  }
+}
+
+void showRule() {
+  Serial.print(fstr(STR_REPLY_RULE));
+  if (ruleLength == 0) {
+    Serial.print(fstr(STR_RULE_NONE));
+  } else {
+    for (uint8_t i = 0; i < ruleLength + 3; i++) printHexByte(eepromCache.read(EEPROM_ADDR_RULE + i));
+  }
+  Serial.print(fstr(STR_RULE_US));
+  Serial.print(lastRuleMicros);
+  Serial.print('/');
+  Serial.println(maxRuleMicros);
+}
+
+// Parse "HH:MM" into a minute of day; -1 if malformed.
+int16_t parseTimeOfDay(const char* s) {
+  if (strlen(s) != 5 || s[2] != ':') return -1;
+  for (uint8_t i = 0; i < 5; i++) {
+    if (i != 2 && (s[i] < '0' || s[i] > '9')) return -1;
+  }
+  int16_t h = (s[0] - '0') * 10 + (s[1] - '0');
+  int16_t m = (s[3] - '0') * 10 + (s[4] - '0');
+  if (h > 23 || m > 59) return -1;
+  return h * 60 + m;
+}
+
+#endif // ENABLE_RULES
+
+#ifdef ENABLE_DATA_LOGGER
+
+void showLogInfo() {
+  if (!dataLog.ready()) {
+    Serial.print(fstr(STR_REPLY_LOG));
+    Serial.println(fstr(STR_RULE_NONE));
+    return;
+  }
+  const LogStats& st = dataLog.stats();
+  char line[96];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_LOG_INFO),
+             (unsigned long)dataLog.headPage(), (unsigned long)dataLog.nextSeq(),
+             dataLog.pending(), st.pagesWritten, st.sectorsErased, st.recordsDropped);
+  Serial.println(line);
+}
+
+// "log dump" is streamed like "hist": a record per loop pass while the
+// serial buffer has room. Pages are tracked by sequence number, so pages
+// written meanwhile do not shift the dump.
+const uint8_t LOG_LINE_MAX = 32;
+
+uint32_t logDumpSeq = 0;     // page being printed
+uint32_t logDumpEnd = 0;     // one past the last page to print
+uint8_t  logDumpRecord = 0;  // next record in it
+bool     logDumping = false;
+
+void startLogDump(long pages) {
+  uint32_t stored = dataLog.storedPages();
+  if (pages < 0) pages = 0;
+  if ((unsigned long)pages > stored) pages = stored;
+  logDumpEnd = dataLog.nextSeq();
+  logDumpSeq = logDumpEnd - pages;
+  logDumpRecord = 0;
+  logDumping = true;
+}
+
+// Print the next record if the serial buffer has room
+void serviceLogDump() {
+  if (!logDumping || serialBusy() || Serial.availableForWrite() < LOG_LINE_MAX) return;
+  TRACE_SCOPE("serviceLogDump");
+  if (logDumpSeq == logDumpEnd) {
+    Serial.println(fstr(STR_REPLY_LOG_END));
+    logDumping = false;
+    return;
+  }
+  // 0 records if the page has been erased since (or was torn)
+  uint8_t page[LOG_PAGE_SIZE];
+  uint32_t back = dataLog.nextSeq() - 1 - logDumpSeq;
+  uint8_t n = back < dataLog.storedPages() ? dataLog.readPage(back, page) : 0;
+  if (logDumpRecord >= n) {
+    logDumpSeq++;
+    logDumpRecord = 0;
+    return;
+  }
+  LogRecord r = DataLog::record(page, logDumpRecord++);
+  char line[LOG_LINE_MAX];
+  if (r.type == LOG_SENSOR || r.type == LOG_ALARM) {
+    snprintf_P(line, sizeof(line), pstr(STR_FMT_LOG_PAIR),
+               (unsigned long)r.time, r.type, r.a(), r.b());
+  } else {
+    snprintf_P(line, sizeof(line), pstr(STR_FMT_LOG_VALUE),
+               (unsigned long)r.time, r.type, (unsigned long)r.value());
+  }
+  Serial.println(line);
+}
+
+#endif // ENABLE_DATA_LOGGER
+
+#ifdef ENABLE_HISTORY
+
+HistoryReader historyDump(history);
+uint16_t historyDumpLeft = 0;   // samples still to print
+bool     historyDumping = false;
+
+const uint8_t HISTORY_LINE_MAX = 24;
+
+void startHistoryDump() {
+  historyDumpLeft = history.samples();
+  historyDump.seek(0);
+  historyDumping = true;
+  char line[HISTORY_LINE_MAX];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_HIST_INFO), historyDumpLeft, history.bytesUsed());
+  Serial.println(line);
+}
+
+// Print one sample if the serial buffer has room, so the dump never
+// stalls the loop.
+void serviceHistoryDump() {
+  TRACE_SCOPE("serviceHistoryDump");
+  if (!historyDumping || serialBusy() || Serial.availableForWrite() < HISTORY_LINE_MAX) return;
+  int16_t t, h;
+  if (historyDumpLeft == 0 || !historyDump.next(t, h)) {
+    Serial.println(fstr(STR_REPLY_HIST_END));
+    historyDumping = false;
+    return;
+  }
+  historyDumpLeft--;
+  char line[HISTORY_LINE_MAX];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_HIST_SAMPLE),
+             (unsigned long)historyDumpLeft * (HISTORY_SAMPLE_INTERVAL / 1_min), t, h);
+  Serial.println(line);
+}
+
+#endif // ENABLE_HISTORY
+
+#ifdef ENABLE_RUN_STATS
+
+const uint8_t RUNS_LINE_MAX = 40;
+
+uint8_t runsReportNext = 0;     // next preset to report
+bool    runsReporting = false;
+
+void startRunsReport() {
+  runsReportNext = 0;
+  runsReporting = true;
+}
+
+// Print the next preset with runs if the serial buffer has room
+void serviceRunsReport() {
+  if (!runsReporting || serialBusy() || Serial.availableForWrite() < RUNS_LINE_MAX) return;
+  while (runsReportNext < PRESET_COUNT && runResponses[runsReportNext].runs == 0) runsReportNext++;
+  if (runsReportNext == PRESET_COUNT) {
+    Serial.println(fstr(STR_REPLY_RUNS_END));
+    runsReporting = false;
+    return;
+  }
+  const RunResponse& r = runResponses[runsReportNext];
+  char line[RUNS_LINE_MAX];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_RUNS), runsReportNext + 1, r.runs,
+             (int)lround(r.humidity.mean), (int)lround(sqrt(r.humidity.variance(r.runs))),
+             (int)lround(r.temperature.mean), (int)lround(sqrt(r.temperature.variance(r.runs))));
+  Serial.println(line);
+  runsReportNext++;
+}
+
+#endif // ENABLE_RUN_STATS
+
+#ifdef ENABLE_ALARMS
+void showAlarms() {
+  char line[32];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_ALARM), alarmState.active, alarmState.latched);
+  Serial.println(line);
+}
+#endif
+
+// Write counters, then the committed bytes per 64-byte block
+// (e.g. "EE wear 0:12 4:3") since boot
+void showEepromStats() {
+  const EepromCacheStats& st = eepromCache.stats();
+  char line[80];
+  snprintf_P(line, sizeof(line), pstr(STR_FMT_EE_INFO), eepromCache.pending(),
+             st.writes, st.coalesced, st.evictions, millis() / 1_s);
+  Serial.println(line);
+  Serial.print(fstr(STR_REPLY_EE_WEAR));
+  for (uint8_t b = 0; b < EEPROM_WEAR_BLOCKS; b++) {
+    if (eepromCache.wear(b) == 0) continue;
+    Serial.print(' ');
+    Serial.print(b);
+    Serial.print(':');
+    Serial.print(eepromCache.wear(b));
+  }
+  Serial.println();
+}
+
+#ifdef ENABLE_METRICS
+
+// Metrics report, a line per loop pass while the serial buffer has room:
+// "M <name>[<unit>] <value>" for counters and gauges, and for histograms a
+// line per non-empty bucket ("M loop.time[us] <64 1234", the last one
+// ">=32768"). A streamed report ("MD ...") holds the counters and buckets
+// that changed since the previous one, as deltas, and every gauge.
+//
+// Deltas are taken from the low 16 bits of the values at the previous
+// report, which is exact while a counter moves less than 65536 between
+// reports. loop.passes moves fastest (the rest step at most about once per
+// pass), so a report comes early once it has moved METRIC_DELTA_MAX.
+
+const uint8_t  METRIC_LINE_MAX = 40;
+const uint8_t  METRIC_DELTA_SLOTS = METRIC_SLOTS - METRIC_GAUGE_COUNT;
+const uint16_t METRIC_DELTA_MAX = 0xF000;
+static_assert(MET_LOOP_PASSES == 0, "loop.passes must own metricLast[0]");
+
+uint16_t metricLast[METRIC_DELTA_SLOTS]; // counters and buckets at the last streamed report
+uint8_t  metricLastIndex = 0;       // metricLast entry of metricCursor
+uint8_t  metricCursor = 0;          // next slot to report
+uint8_t  metricIndex = 0;           // metric owning that slot
+bool     metricReporting = false;
+bool     metricDelta = false;
+unsigned long metricStreamInterval = 0; // 0 = not streaming
+unsigned long lastMetricStream = 0;
+
+// Bytes between the heap and the stack
+uint16_t freeRam() {
+#ifdef CELLARPUMP_SIM
+  return 0; // not meaningful on the host
+#else
+  extern char __heap_start;
+  extern char* __brkval;
+  char top;
+  return &top - (__brkval ? __brkval : &__heap_start);
+#endif
+}
+
+// Copy values other subsystems keep into their metrics.
+void refreshMetrics() {
+  metricSet(MET_EEPROM_WRITES, eepromCache.stats().writes);
+  metricSet(MET_EEPROM_PENDING, eepromCache.pending());
+#ifdef ENABLE_DATA_LOGGER
+  metricSet(MET_LOG_DROPPED, dataLog.stats().recordsDropped);
+#endif
+#ifdef ENABLE_ALARMS
+  metricSet(MET_ALARMS_LATCHED, alarmState.latched);
+#endif
+  metricSet(MET_RAM_FREE, freeRam());
+}
+
+void startMetricsReport(bool delta) {
+  refreshMetrics();
+  metricCursor = 0;
+  metricIndex = 0;
+  metricLastIndex = 0;
+  metricDelta = delta;
+  metricReporting = true;
+}
+
+// Take the next streamed report's deltas from the current values.
+void resetMetricDeltas() {
+  refreshMetrics();
+  uint8_t i = 0;
+  for (uint8_t m = 0; m < METRIC_COUNT; m++) {
+    MetricInfo info = metricInfo(m);
+    if (info.kind == METRIC_GAUGE) continue;
+    uint8_t slots = info.kind == METRIC_HISTOGRAM ? METRIC_BUCKETS : 1;
+    for (uint8_t b = 0; b < slots; b++) metricLast[i++] = (uint16_t)metricSlots[info.slot + b];
+  }
+}
+
+void printMetric(const MetricInfo& info, uint8_t slot, uint32_t value) {
+  Serial.print(fstr(metricDelta ? STR_REPLY_METRIC_DELTA : STR_REPLY_METRIC));
+  Serial.print(reinterpret_cast<const __FlashStringHelper*>(info.name));
+  if (pgm_read_byte(info.unit)) {
+    Serial.print('[');
+    Serial.print(reinterpret_cast<const __FlashStringHelper*>(info.unit));
+    Serial.print(']');
+  }
+  Serial.print(' ');
+  if (info.kind == METRIC_HISTOGRAM) {
+    uint8_t b = slot - info.slot;
+    if (b < METRIC_BUCKETS - 1) {
+      Serial.print('<');
+      Serial.print(metricBucketLimit(b));
+    } else {
+      Serial.print(fstr(STR_METRIC_OVER));
+      Serial.print(metricBucketLimit(b - 1));
+    }
+    Serial.print(' ');
+  }
+  Serial.println(value);
+}
+
+// Start streamed reports when due and print the next line. Call every
+// loop pass.
+void serviceMetrics(unsigned long now) {
+  TRACE_SCOPE("serviceMetrics");
+  uint16_t passes = (uint16_t)metricSlots[MET_LOOP_PASSES] - metricLast[0];
+  if (metricStreamInterval && !metricReporting &&
+      (now - lastMetricStream >= metricStreamInterval || passes >= METRIC_DELTA_MAX)) {
+    lastMetricStream = now;
+    startMetricsReport(true);
+  }
+  if (!metricReporting || serialBusy() || Serial.availableForWrite() < METRIC_LINE_MAX) return;
+
+  while (metricCursor < METRIC_SLOTS) {
+    uint8_t slot = metricCursor++;
+    while (metricIndex + 1 < METRIC_COUNT && metricInfo(metricIndex + 1).slot <= slot) metricIndex++;
+    MetricInfo info = metricInfo(metricIndex);
+    uint32_t value = metricSlots[slot];
+    bool show;
+    if (metricDelta && info.kind == METRIC_GAUGE) {
+      show = true;
+    } else if (metricDelta) {
+      uint16_t delta = (uint16_t)value - metricLast[metricLastIndex];
+      metricLast[metricLastIndex++] = (uint16_t)value;
+      value = delta;
+      show = delta != 0;
+    } else {
+      show = info.kind != METRIC_HISTOGRAM || value != 0;
+    }
+    if (show) {
+      printMetric(info, slot, value);
+      return;
+    }
+  }
+  Serial.print(fstr(metricDelta ? STR_REPLY_METRIC_DELTA : STR_REPLY_METRIC));
+  Serial.println(fstr(STR_METRIC_END));
+  metricReporting = false;
+}
+
+#endif // ENABLE_METRICS
+
+void finishImport() {
+  serialHold();
+  ImportTarget target = importing;
+  importing = IMPORT_NONE;
+  if (target == IMPORT_CONFIG) finishConfigImport();
+#ifdef ENABLE_RULES
+  if (target == IMPORT_RULE) finishRuleImport();
+#endif
+}
+
+void runCommand() {
+  serialHold();
+  if (commandOverflow) {
+    Serial.println(fstr(STR_ERR_TOO_LONG));
+    metricAdd(MET_COMMAND_ERRORS);
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_CFG_EXPORT)) == 0) {
+    exportConfig();
+#ifdef ENABLE_RULES
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_RULE_CLEAR)) == 0) {
+    clearRule();
+    Serial.println(fstr(STR_REPLY_RULE_OK));
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_RULE_SHOW)) == 0) {
+    showRule();
+  } else if (strncmp_P(commandBuf, pstr(STR_CMD_TIME), strlen_P(pstr(STR_CMD_TIME))) == 0) {
+    int16_t minute = parseTimeOfDay(commandBuf + strlen_P(pstr(STR_CMD_TIME)));
+    if (minute < 0) {
+      Serial.println(fstr(STR_ERR_BAD_TIME));
+    } else {
+      setClock(minute);
+      Serial.println(fstr(STR_REPLY_TIME_OK));
+    }
+#endif
+#ifdef ENABLE_METRICS
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_METRICS)) == 0) {
+    startMetricsReport(false);
+  } else if (strncmp_P(commandBuf, pstr(STR_CMD_METRICS_EVERY), strlen_P(pstr(STR_CMD_METRICS_EVERY))) == 0) {
+    unsigned long interval = atol(commandBuf + strlen_P(pstr(STR_CMD_METRICS_EVERY))) * 1_s;
+    if (interval && !metricStreamInterval) resetMetricDeltas(); // first report: the first N s
+    metricStreamInterval = interval;
+    lastMetricStream = millis();
+#endif
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_RELAY)) == 0) {
+    char line[56];
+    snprintf_P(line, sizeof(line), pstr(STR_FMT_RELAY),
+               relayTiming.switches, relayTiming.lateMean(), relayTiming.lateMax);
+    Serial.println(line);
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_DUTY)) == 0) {
+    char line[48];
+    snprintf_P(line, sizeof(line), pstr(STR_FMT_DUTY), pumpDuty.used(millis()), pumpDuty.budget(),
+               pumpDenied, lastDutyVerdict);
+    Serial.println(line);
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_DEV)) == 0) {
+    logPeripherals();
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_EE)) == 0) {
+    showEepromStats();
+#ifdef ENABLE_DISPLAY
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_LCD)) == 0) {
+    Serial.print(fstr(STR_REPLY_LCD));
+    Serial.print(lastDisplayMicros);
+    Serial.print('/');
+    Serial.println(maxDisplayMicros);
+#endif
+#ifdef ENABLE_HISTORY
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_HIST)) == 0) {
+    startHistoryDump();
+#endif
+#ifdef ENABLE_RUN_STATS
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_RUNS)) == 0) {
+    startRunsReport();
+#endif
+#ifdef ENABLE_RS485
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_BUS)) == 0) {
+    char line[80];
+    snprintf_P(line, sizeof(line), pstr(STR_FMT_BUS), busAddress(), busNodeCount, busSynced,
+               busClockOffset, busFrames, busErrors, busSteps);
+    Serial.println(line);
+#endif
+#ifdef ENABLE_FLOAT_SWITCH
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_FLOAT)) == 0) {
+    char line[40];
+    snprintf_P(line, sizeof(line), pstr(STR_FMT_FLOAT), inputActive(INPUT_FLOAT), floatFailed,
+               floatLongRuns);
+    Serial.println(line);
+#endif
+#ifdef ENABLE_ALARMS
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_ALARM)) == 0) {
+    showAlarms();
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_ALARM_ACK)) == 0) {
+    alarmState.acknowledge();
+    showAlarms();
+#endif
+#ifdef ENABLE_DATA_LOGGER
+  } else if (strcmp_P(commandBuf, pstr(STR_CMD_LOG_INFO)) == 0) {
+    showLogInfo();
+  } else if (strncmp_P(commandBuf, pstr(STR_CMD_LOG_DUMP), strlen_P(pstr(STR_CMD_LOG_DUMP))) == 0) {
+    startLogDump(atol(commandBuf + strlen_P(pstr(STR_CMD_LOG_DUMP))));
+#endif
+  } else if (commandLen > 0) {
+    Serial.println(fstr(STR_ERR_UNKNOWN));
+    metricAdd(MET_COMMAND_ERRORS);
+  }
+}
+
+// Consume any pending serial input. Never blocks.
+void pollSerialCommands() {
+  TRACE_SCOPE("pollSerialCommands");
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+#ifdef ENABLE_RS485
+    busLineActive = millis();
+    if (c == BUS_FRAME_START && commandLen == 0 && !importing && !busReceiving) {
+      busLineStart();
+      continue;
+    }
+    if (busReceiving && c != '\n') {
+      if (c != '\r') busLineChar(c);
+      continue;
+    }
+#endif
+    if (c == '\r') continue;
+
+    if (c == '\n') {
+#ifdef ENABLE_RS485
+      if (busReceiving) busLineEnd();
+      else
+#endif
+      if (importing) finishImport();
+      else           runCommand();
+      commandLen = 0;
+      commandBuf[0] = '\0';
+      commandOverflow = false;
+      continue;
+    }
+
+    if (importing) {
+      feedImportHex(c);
+      continue;
+    }
+
+    if (commandLen < COMMAND_MAX) {
+      commandBuf[commandLen++] = c;
+      commandBuf[commandLen] = '\0';
+    } else {
+      commandOverflow = true;
+    }
+
+    ImportTarget target = IMPORT_NONE;
+    if (strcmp_P(commandBuf, pstr(STR_CMD_CFG_IMPORT)) == 0) target = IMPORT_CONFIG;
+#ifdef ENABLE_RULES
+    if (strcmp_P(commandBuf, pstr(STR_CMD_RULE_LOAD)) == 0) target = IMPORT_RULE;
+#endif
+    if (target != IMPORT_NONE) {
+      importing = target;
+      importLen = 0;
+      importHighNibble = -1;
+      importBadInput = false;
+    }
+  }
+}
+
+#endif // ENABLE_SERIAL_COMMANDS
+
+// =============================================================================
+// SETUP
+// =============================================================================
+
+void setup() {
+  TRACE_SCOPE("setup");
+#ifdef ENABLE_RS485
+  initBus(); // transmitter off before anything is printed
+#endif
+#ifdef ENABLE_SERIAL_LOGGING
+  initSerial();
+#endif
+
+  Wire.begin();
+  startPeripherals(probePeripherals());
+#ifdef ENABLE_SERIAL_LOGGING
+  logPeripherals();
+#endif
+
+  loadConfigFromEEPROM(configBuffers[configActive]);
+
+#ifdef ENABLE_HISTORY
+  loadHistoryFromEEPROM();
+#endif
+#ifdef ENABLE_RUN_STATS
+  loadRunStatsFromEEPROM();
+#endif
+
+#ifdef ENABLE_DIGITAL_INPUTS
+  initInputs();
+#endif
+#if defined(ENABLE_PRESET_BUTTON) && defined(ENABLE_DISPLAY)
+  showPresetOverlay();
+#endif
+#ifdef ENABLE_SERIAL_LOGGING
+  logPreset(activeConfig());
+#endif
+
+  initRelay();
+
+#ifdef ENABLE_POWER_FAIL_INPUT
+  pinMode(POWER_FAIL_PIN, INPUT_PULLUP);
+#endif
+
+#ifdef ENABLE_DATA_LOGGER
+  initLogger();
+#endif
+
+#ifdef ENABLE_RULES
+  loadRuleFromEEPROM();
+#endif
+
+  // Upon startup, turn the pump on immediately.
+  // pumpStopTime is 0 so the first cycle triggers right away,
+  // but we explicitly call pumpOn() for clarity.
+  // In demand mode the float switch starts the first run instead
+  if (!demandMode()) pumpOn(pumpOnDuration());
+}
+
+// =============================================================================
+// MAIN LOOP
+// =============================================================================
+
+void loop() {
+  TRACE_SCOPE("loop");
+  unsigned long now = millis();
+#ifdef ENABLE_METRICS
+  unsigned long passStart = micros();
+#endif
+  metricAdd(MET_LOOP_PASSES);
+
+  // --- Handle serial commands ---
+#ifdef ENABLE_SERIAL_COMMANDS
+  pollSerialCommands();
+#endif
+
+  // --- Debounced buttons and contacts ---
+#ifdef ENABLE_DIGITAL_INPUTS
+  serviceInputs(now);
+#endif
+
+  // --- Update pump state (non-blocking) ---
+  updatePump();
+
+  // --- RS-485 clock sync and frame transmission ---
+#ifdef ENABLE_RS485
+  serviceBus(now);
+#endif
+
+  // --- Last reading of a finished run ---
+#ifdef ENABLE_RUN_STATS
+  serviceRunResponse(now);
+#endif
+
+  // --- Append to the data log (non-blocking), dump it (a line per pass) ---
+#ifdef ENABLE_DATA_LOGGER
+  serviceLogger(now);
+#ifdef ENABLE_SERIAL_COMMANDS
+  serviceLogDump();
+#endif
+#endif
+
+  // --- Commit cached EEPROM writes (a byte per pass) ---
+#ifdef ENABLE_POWER_FAIL_INPUT
+  checkPowerFail();
+#endif
+  eepromCache.service();
+
+  // --- Metrics report (a line per pass) ---
+#if defined(ENABLE_METRICS) && defined(ENABLE_SERIAL_COMMANDS)
+  serviceMetrics(now);
+#endif
+
+  // --- Run statistics report (a line per pass) ---
+#if defined(ENABLE_RUN_STATS) && defined(ENABLE_SERIAL_COMMANDS)
+  serviceRunsReport();
+#endif
+
+  // --- History checkpoint and dump (a byte / a line per pass) ---
+#ifdef ENABLE_HISTORY
+  serviceHistoryCheckpoint(now);
+#ifdef ENABLE_SERIAL_COMMANDS
+  serviceHistoryDump();
+#endif
+#endif
+
+  // --- Look for peripherals that came or went ---
+  servicePeripherals(now);
 
   // --- Read sensor periodically ---
 #ifdef ENABLE_TEMP_HUMIDITY_SENSOR
-  if (now - lastSensorRead >= SENSOR_READ_INTERVAL) {
+  if (present(PERIPHERAL_SENSOR) && now - lastSensorRead >= SENSOR_READ_INTERVAL) {
     lastSensorRead = now;
+#ifdef ENABLE_ALARMS
+    if (readSensor()) checkAlarms(temperatureFilter.value(), humidityFilter.value());
+#else
     readSensor();
+#endif
   }
 #endif
 
@@ -482,16 +2902,31 @@ void loop() {
 #ifdef ENABLE_DISPLAY
   // Skip normal display refresh while overlay is shown
 #ifdef ENABLE_PRESET_BUTTON
-  if (overlayShowing && (now - overlayStartTime >= OVERLAY_DISPLAY_MS)) {
+  // (millis(), not now: the overlay may have been started later in this pass)
+  if (overlayShowing && (millis() - overlayStartTime >= OVERLAY_DISPLAY_MS)) {
     overlayShowing = false; // overlay expired — resume normal display
   }
   bool overlayActive = overlayShowing;
 #else
   bool overlayActive = false;
 #endif
-  if (!overlayActive && (now - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL)) {
+#ifdef ENABLE_DISPLAY_SLEEP
+  serviceDisplaySleep(now);
+  bool asleep = displayAsleep;
+#else
+  bool asleep = false;
+#endif
+  if (present(PERIPHERAL_DISPLAY) && !asleep && !overlayActive &&
+      (now - lastDisplayUpdate >= DISPLAY_UPDATE_INTERVAL)) {
     lastDisplayUpdate = now;
+    unsigned long started = micros();
     updateDisplay();
+    lastDisplayMicros = micros() - started;
+    if (lastDisplayMicros > maxDisplayMicros) maxDisplayMicros = lastDisplayMicros;
   }
 #endif
+
+#ifdef ENABLE_METRICS
+  metricObserve(MET_LOOP_TIME, micros() - passStart);
+#endif
 }
@@ -0,0 +1,56 @@
+// =============================================================================
+// Threshold alarms (include/alarms.h)
+// =============================================================================
+//   pio test -e native -f test_alarms
+// =============================================================================
+
+#include <math.h>
+#include <unity.h>
+
+#include "alarms.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Temperature minus dew point by the Magnus form, in floating point
+static double magnusMargin(double t, double rh) {
+  double g = log(rh / 100.0) + 17.62 * t / (243.12 + t);
+  return t - 243.12 * g / (17.62 - g);
+}
+
+static void expectMargin(int16_t t, int16_t h, int16_t tolerance) {
+  int16_t expected = (int16_t)lround(magnusMargin(t / 10.0, h / 10.0) * 10.0);
+  TEST_ASSERT_INT16_WITHIN(tolerance, expected, dewPointMargin(t, h));
+}
+
+void test_dew_margin_known_points() {
+  TEST_ASSERT_EQUAL_INT16(0, dewPointMargin(120, 1000));  // saturated
+  TEST_ASSERT_INT16_WITHIN(1, 33, dewPointMargin(120, 800));   // 12.0 C 80 %: dew point 8.7 C
+  TEST_ASSERT_INT16_WITHIN(1, 107, dewPointMargin(200, 500));  // 20.0 C 50 %: dew point 9.3 C
+}
+
+void test_dew_margin_depends_on_temperature() {
+  // Same humidity, colder air: the dew point is closer
+  TEST_ASSERT_TRUE(dewPointMargin(20, 800) < dewPointMargin(250, 800));
+}
+
+void test_dew_margin_grid() {
+  for (int16_t t = -400; t <= 600; t += 25) {
+    for (int16_t h = 10; h <= 1000; h += 5) expectMargin(t, h, 1);
+  }
+}
+
+void test_dew_margin_out_of_range_humidity() {
+  TEST_ASSERT_EQUAL_INT16(0, dewPointMargin(120, 1200));
+  TEST_ASSERT_EQUAL_INT16(dewPointMargin(120, 1), dewPointMargin(120, 0));
+  TEST_ASSERT_EQUAL_INT16(dewPointMargin(120, 1), dewPointMargin(120, -5));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_dew_margin_known_points);
+  RUN_TEST(test_dew_margin_depends_on_temperature);
+  RUN_TEST(test_dew_margin_grid);
+  RUN_TEST(test_dew_margin_out_of_range_humidity);
+  return UNITY_END();
+}
@@ -0,0 +1,79 @@
+// =============================================================================
+// Pump duty-cycle limit (include/duty_limit.h)
+// =============================================================================
+//   pio test -e native -f test_duty_limit
+// =============================================================================
+
+#include <unity.h>
+
+#include "duty_limit.h"
+
+void setUp() {}
+void tearDown() {}
+
+// A 60 s window of twelve 5 s buckets, 30 s on at most, 3 s rest
+const unsigned long WINDOW = 60000;
+const unsigned long BUCKET = WINDOW / 12;
+typedef DutyLimiter<12> Limiter;
+
+static Limiter make() { return Limiter(WINDOW, 30000, 3000); }
+
+// A run of ran ms ending at end must count for the whole window after it,
+// and be gone one bucket later
+static void expectCountedForWindow(unsigned long end, unsigned long ran) {
+  Limiter duty = make();
+  duty.stopped(end, ran);
+  uint16_t seconds = (ran + 999) / 1000;
+  TEST_ASSERT_EQUAL_UINT16(seconds, duty.used(end));
+  TEST_ASSERT_EQUAL_UINT16(seconds, duty.used(end + WINDOW - 1));
+  TEST_ASSERT_EQUAL_UINT16(0, duty.used(end + WINDOW + BUCKET));
+}
+
+void test_run_counted_for_the_window_wherever_it_ends() {
+  expectCountedForWindow(0, 2000);                    // at the start of a bucket
+  expectCountedForWindow(BUCKET - 1, 2000);           // at the end of one
+  expectCountedForWindow(7 * BUCKET + 1234, 4000);
+  expectCountedForWindow(3 * BUCKET + BUCKET / 2, 12000); // longer than a bucket
+}
+
+void test_rest_between_runs() {
+  Limiter duty = make();
+  duty.stopped(10000, 5000);
+  unsigned long duration = 5000;
+  TEST_ASSERT_EQUAL(DUTY_DENY_REST, duty.check(12999, duration));
+  TEST_ASSERT_EQUAL(DUTY_OK, duty.check(13000, duration));
+  TEST_ASSERT_EQUAL_UINT32(5000, duration);
+}
+
+void test_budget_shortens_then_denies() {
+  Limiter duty = make();
+  duty.stopped(20000, 20000);
+  unsigned long duration = 15000;
+  TEST_ASSERT_EQUAL(DUTY_OK, duty.check(25000, duration));
+  TEST_ASSERT_EQUAL_UINT32(10000, duration);
+  duty.stopped(35000, duration);
+  duration = 1000;
+  TEST_ASSERT_EQUAL(DUTY_DENY_BUDGET, duty.check(40000, duration));
+  // Both runs still count a window after the first one ended
+  TEST_ASSERT_EQUAL(DUTY_DENY_BUDGET, duty.check(20000 + WINDOW - 1, duration));
+  TEST_ASSERT_EQUAL_UINT16(10, duty.used(35000 + WINDOW - 1));
+  TEST_ASSERT_EQUAL(DUTY_OK, duty.check(35000 + WINDOW - 1, duration));
+}
+
+void test_long_idle_clears_the_window() {
+  Limiter duty = make();
+  duty.stopped(1000, 30000);
+  TEST_ASSERT_EQUAL_UINT16(30, duty.used(1000));
+  TEST_ASSERT_EQUAL_UINT16(0, duty.used(1000 + 10 * WINDOW));
+  duty.stopped(1000 + 10 * WINDOW, 3000);
+  TEST_ASSERT_EQUAL_UINT16(3, duty.used(1000 + 10 * WINDOW + WINDOW - 1));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_run_counted_for_the_window_wherever_it_ends);
+  RUN_TEST(test_rest_between_runs);
+  RUN_TEST(test_budget_shortens_then_denies);
+  RUN_TEST(test_long_idle_clears_the_window);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+// =============================================================================
+// HistoryLog / HistoryReader (include/history.h)
+// =============================================================================
+//   pio test -e native -f test_history
+// =============================================================================
+
+#include <unity.h>
+
+#include "history.h"
+
+void setUp() {}
+void tearDown() {}
+
+static HistoryLog history;
+
+// Decode everything and compare with the expected samples (tenths, already
+// on the quantization steps)
+static void expectSamples(const int16_t (*expected)[2], uint16_t count) {
+  TEST_ASSERT_EQUAL_UINT16(count, history.samples());
+  HistoryReader reader(history);
+  int16_t t, h;
+  for (uint16_t i = 0; i < count; i++) {
+    TEST_ASSERT_TRUE(reader.next(t, h));
+    TEST_ASSERT_EQUAL_INT16(expected[i][0], t);
+    TEST_ASSERT_EQUAL_INT16(expected[i][1], h);
+  }
+  TEST_ASSERT_FALSE(reader.next(t, h));
+}
+
+void test_round_trip() {
+  history.clear();
+  const int16_t s[][2] = { { 120, 780 }, { 120, 780 }, { 121, 785 }, { 135, 700 }, { 135, 700 },
+                           { -20, 995 }, { -21, 990 } };
+  for (const auto& v : s) history.append(v[0], v[1]);
+  expectSamples(s, sizeof(s) / sizeof(s[0]));
+}
+
+void test_break_then_append() {
+  history.clear();
+  const int16_t s[][2] = { { 120, 780 }, { 121, 780 }, { 121, 785 }, { 119, 790 } };
+  for (uint8_t i = 0; i < 3; i++) history.append(s[i][0], s[i][1]);
+  history.breakBlock();
+  TEST_ASSERT_EQUAL_UINT16(3, history.samples());
+  history.append(s[3][0], s[3][1]);
+  expectSamples(s, 4);
+}
+
+void test_break_on_empty_and_twice() {
+  history.clear();
+  history.breakBlock();
+  history.append(100, 500);
+  history.breakBlock();
+  history.breakBlock();
+  history.append(100, 500);
+  history.append(100, 500);
+  const int16_t s[][2] = { { 100, 500 }, { 100, 500 }, { 100, 500 } };
+  expectSamples(s, 3);
+}
+
+void test_break_inside_a_run() {
+  history.clear();
+  // An open run of unchanged samples must not be extended across the break
+  for (uint8_t i = 0; i < 10; i++) history.append(120, 780);
+  history.breakBlock();
+  for (uint8_t i = 0; i < 10; i++) history.append(120, 780);
+  int16_t s[20][2];
+  for (uint8_t i = 0; i < 20; i++) { s[i][0] = 120; s[i][1] = 780; }
+  expectSamples(s, 20);
+}
+
+void test_blocks_fill_and_wrap() {
+  history.clear();
+  // Enough changing samples to drop old blocks; the newest ones must decode
+  const uint16_t total = HISTORY_BLOCK_SAMPLES * 5 + 17;
+  for (uint16_t i = 0; i < total; i++) history.append((int16_t)(i % 37) * 3, 500 + (int16_t)(i % 11) * 5);
+  uint16_t n = history.samples();
+  TEST_ASSERT_TRUE(n > 0 && n <= total);
+  TEST_ASSERT_TRUE(history.consistent());
+  HistoryReader reader(history);
+  int16_t t, h;
+  for (uint16_t i = total - n; i < total; i++) {
+    TEST_ASSERT_TRUE(reader.next(t, h));
+    TEST_ASSERT_EQUAL_INT16((int16_t)(i % 37) * 3, t);
+    TEST_ASSERT_EQUAL_INT16(500 + (int16_t)(i % 11) * 5, h);
+  }
+  TEST_ASSERT_FALSE(reader.next(t, h));
+}
+
+void test_restore_then_break() {
+  // As after a reboot: copy the raw state, break, keep appending
+  history.clear();
+  for (uint8_t i = 0; i < 3; i++) history.append(200 + i, 600);
+  static HistoryLog restored;
+  memcpy(restored.data(), history.data(), sizeof(HistoryLog));
+  TEST_ASSERT_TRUE(restored.consistent());
+  restored.breakBlock();
+  restored.append(210, 650);
+  TEST_ASSERT_EQUAL_UINT16(4, restored.samples());
+  HistoryReader reader(restored, 3);
+  int16_t t, h;
+  TEST_ASSERT_TRUE(reader.next(t, h));
+  TEST_ASSERT_EQUAL_INT16(210, t);
+  TEST_ASSERT_EQUAL_INT16(650, h);
+  TEST_ASSERT_FALSE(reader.next(t, h));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_break_then_append);
+  RUN_TEST(test_break_on_empty_and_twice);
+  RUN_TEST(test_break_inside_a_run);
+  RUN_TEST(test_blocks_fill_and_wrap);
+  RUN_TEST(test_restore_then_break);
+  return UNITY_END();
+}
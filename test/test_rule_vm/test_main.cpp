@@ -0,0 +1,112 @@
+// =============================================================================
+// Rule VM (include/rule_vm.h): int16_t arithmetic wraps, jumps and loads are checked
+// =============================================================================
+//   pio test -e native -f test_rule_vm
+// =============================================================================
+
+#include <unity.h>
+
+#include "rule_vm.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Verify and evaluate a program; it must RUN for `seconds`
+template <uint8_t Len>
+static void expectRunFor(const uint8_t (&code)[Len], uint16_t seconds) {
+  int16_t vars[RULE_VAR_COUNT] = {};
+  TEST_ASSERT_TRUE(ruleVerify([&](uint8_t pc) { return code[pc]; }, Len));
+  RuleResult r = ruleEvaluate([&](uint8_t pc) { return code[pc]; }, Len, vars);
+  TEST_ASSERT_EQUAL(RULE_RUN, r.decision);
+  TEST_ASSERT_EQUAL_UINT16(seconds, r.runSeconds);
+}
+
+// RUN_FOR clamps negative values to 0, so each program compares its result
+// with the expected value and runs for EQ's 0 or 1
+
+void test_add_wraps() {
+  const uint8_t code[] = { OP_PUSH16, 0xFF, 0x7F, OP_PUSH8, 1, OP_ADD,   // 32767 + 1
+                           OP_PUSH16, 0x00, 0x80, OP_EQ, OP_RUN_FOR };    // == -32768
+  expectRunFor(code, 1);
+}
+
+void test_sub_wraps() {
+  const uint8_t code[] = { OP_PUSH16, 0x00, 0x80, OP_PUSH8, 1, OP_SUB,   // -32768 - 1
+                           OP_PUSH16, 0xFF, 0x7F, OP_EQ, OP_RUN_FOR };    // == 32767
+  expectRunFor(code, 1);
+}
+
+void test_mul_wraps() {
+  const uint8_t code[] = { OP_PUSH16, 0x01, 0x01, OP_PUSH16, 0x00, 0x01, OP_MUL,  // 257 * 256
+                           OP_PUSH16, 0x00, 0x01, OP_EQ, OP_RUN_FOR };             // == 256
+  expectRunFor(code, 1);
+}
+
+void test_neg_of_min_wraps() {
+  const uint8_t code[] = { OP_PUSH16, 0x00, 0x80, OP_NEG,
+                           OP_PUSH16, 0x00, 0x80, OP_EQ, OP_RUN_FOR };
+  expectRunFor(code, 1);
+}
+
+void test_div_of_min_by_minus_one_wraps() {
+  const uint8_t code[] = { OP_PUSH16, 0x00, 0x80, OP_PUSH8, 0xFF, OP_DIV,
+                           OP_PUSH16, 0x00, 0x80, OP_EQ, OP_RUN_FOR };
+  expectRunFor(code, 1);
+}
+
+void test_div_truncates_toward_zero() {
+  const uint8_t code[] = { OP_PUSH8, 100, OP_PUSH8, 0xF9, OP_DIV, OP_NEG, OP_RUN_FOR };  // -(100 / -7)
+  expectRunFor(code, 14);
+}
+
+void test_div_by_zero_is_zero() {
+  const uint8_t code[] = { OP_PUSH8, 100, OP_PUSH8, 0, OP_DIV, OP_PUSH8, 5, OP_ADD, OP_RUN_FOR };
+  expectRunFor(code, 5);
+}
+
+template <uint8_t Len>
+static bool verifies(const uint8_t (&code)[Len]) {
+  return ruleVerify([&](uint8_t pc) { return code[pc]; }, Len);
+}
+
+void test_jump_into_operand_rejected() {
+  // JMP 1 lands on PUSH8's operand, which would run as LOAD 66
+  const uint8_t jmp[] = { OP_JMP, 1, OP_PUSH8, OP_LOAD, 0x42 };
+  TEST_ASSERT_FALSE(verifies(jmp));
+  const uint8_t jz[] = { OP_PUSH8, 0, OP_JZ, 2, OP_PUSH16, 0x03, 0x42, OP_RUN_FOR };
+  TEST_ASSERT_FALSE(verifies(jz));
+  const uint8_t past[] = { OP_JMP, 2, OP_SKIP };
+  TEST_ASSERT_FALSE(verifies(past));
+}
+
+void test_jumps_to_instructions_and_end_accepted() {
+  const uint8_t skipOver[] = { OP_JMP, 2, OP_PUSH8, 5, OP_SKIP };
+  TEST_ASSERT_TRUE(verifies(skipOver));
+  const uint8_t toEnd[] = { OP_PUSH8, 0, OP_JZ, 1, OP_SKIP };
+  TEST_ASSERT_TRUE(verifies(toEnd));
+  expectRunFor(toEnd, 0);
+}
+
+void test_load_out_of_range_is_an_error() {
+  // Not verifiable, but ruleEvaluate must not read past vars either
+  const uint8_t code[] = { OP_LOAD, RULE_VAR_COUNT, OP_RUN_FOR };
+  TEST_ASSERT_FALSE(verifies(code));
+  int16_t vars[RULE_VAR_COUNT] = {};
+  RuleResult r = ruleEvaluate([&](uint8_t pc) { return code[pc]; }, sizeof(code), vars);
+  TEST_ASSERT_EQUAL(RULE_ERROR, r.decision);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_add_wraps);
+  RUN_TEST(test_sub_wraps);
+  RUN_TEST(test_mul_wraps);
+  RUN_TEST(test_neg_of_min_wraps);
+  RUN_TEST(test_div_of_min_by_minus_one_wraps);
+  RUN_TEST(test_div_truncates_toward_zero);
+  RUN_TEST(test_div_by_zero_is_zero);
+  RUN_TEST(test_jump_into_operand_rejected);
+  RUN_TEST(test_jumps_to_instructions_and_end_accepted);
+  RUN_TEST(test_load_out_of_range_is_an_error);
+  return UNITY_END();
+}
@@ -0,0 +1,135 @@
+// =============================================================================
+// SpikeFilter (include/sensor_filter.h) on synthetic traces
+// =============================================================================
+//   pio test -e native -f test_sensor_filter
+// =============================================================================
+
+#include <unity.h>
+
+#include "sensor_filter.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Feed a trace and check the output after every sample
+template <uint8_t N>
+static void expectTrace(SpikeFilter<N>& f, const int16_t* in, const int16_t* out, uint8_t len) {
+  int16_t got[32];
+  for (uint8_t i = 0; i < len; i++) got[i] = f.update(in[i]);
+  TEST_ASSERT_EQUAL_INT16_ARRAY(out, got, len);
+}
+
+void test_single_spike_is_rejected() {
+  SpikeFilter<5> f(0);
+  const int16_t in[]  = { 200, 201, 200, 900, 200, 201, 200 };
+  const int16_t out[] = { 200, 200, 200, 200, 200, 201, 200 };
+  expectTrace(f, in, out, sizeof(in) / sizeof(in[0]));
+}
+
+void test_double_spike_is_rejected() {
+  SpikeFilter<5> f(0);
+  const int16_t in[]  = { 200, 200, 200, 200, 200, -400, 900, 200, 200, 200 };
+  const int16_t out[] = { 200, 200, 200, 200, 200,  200, 200, 200, 200, 200 };
+  expectTrace(f, in, out, sizeof(in) / sizeof(in[0]));
+}
+
+void test_three_samples_are_a_step_not_a_spike() {
+  SpikeFilter<5> f(0);
+  const int16_t in[]  = { 200, 200, 200, 200, 200, 300, 300, 300, 300 };
+  const int16_t out[] = { 200, 200, 200, 200, 200, 200, 200, 300, 300 };
+  expectTrace(f, in, out, sizeof(in) / sizeof(in[0]));
+}
+
+void test_slew_limit() {
+  SpikeFilter<5> f(10);
+  // The median reaches 300 on the 8th sample; the output then climbs 10 per update
+  const int16_t in[]  = { 200, 200, 200, 200, 200, 300, 300, 300, 300, 300, 300, 300 };
+  const int16_t out[] = { 200, 200, 200, 200, 200, 200, 200, 210, 220, 230, 240, 250 };
+  expectTrace(f, in, out, sizeof(in) / sizeof(in[0]));
+  // and down again, by at most 10 per update, once the median has turned
+  TEST_ASSERT_EQUAL_INT16(260, f.update(100));
+  TEST_ASSERT_EQUAL_INT16(270, f.update(100));
+  TEST_ASSERT_EQUAL_INT16(260, f.update(100));
+  TEST_ASSERT_EQUAL_INT16(250, f.update(100));
+  TEST_ASSERT_EQUAL_INT16(250, f.value());
+}
+
+void test_slew_limit_does_not_delay_the_first_value() {
+  SpikeFilter<5> f(10);
+  TEST_ASSERT_FALSE(f.hasValue());
+  TEST_ASSERT_EQUAL_INT16(-123, f.update(-123));
+  TEST_ASSERT_TRUE(f.hasValue());
+}
+
+void test_warm_up_uses_the_samples_so_far() {
+  SpikeFilter<5> f(0);
+  // count < N: the median of what has arrived (the lower middle for an even count)
+  const int16_t in[]  = { 500, 100, 300, 900, 200, 400 };
+  const int16_t out[] = { 500, 100, 300, 300, 300, 300 };
+  expectTrace(f, in, out, sizeof(in) / sizeof(in[0]));
+}
+
+void test_reset_restarts_the_warm_up() {
+  SpikeFilter<5> f(10);
+  for (uint8_t i = 0; i < 5; i++) f.update(200);
+  f.reset();
+  TEST_ASSERT_FALSE(f.hasValue());
+  TEST_ASSERT_EQUAL_INT16(700, f.update(700));
+  TEST_ASSERT_EQUAL_INT16(700, f.update(800));  // median of {700, 800}: the lower one
+}
+
+// Brute-force median of the last n samples, lower middle for an even count
+static int16_t referenceMedian(const int16_t* trace, uint8_t end, uint8_t n) {
+  int16_t w[15];
+  uint8_t len = end + 1 < n ? end + 1 : n;
+  for (uint8_t i = 0; i < len; i++) w[i] = trace[end + 1 - len + i];
+  for (uint8_t i = 1; i < len; i++) {
+    for (uint8_t j = i; j > 0 && w[j - 1] > w[j]; j--) {
+      int16_t t = w[j];
+      w[j] = w[j - 1];
+      w[j - 1] = t;
+    }
+  }
+  return w[(len - 1) / 2];
+}
+
+template <uint8_t N>
+static void checkAgainstReference(const int16_t* trace, uint8_t len) {
+  SpikeFilter<N> f(0);
+  for (uint8_t i = 0; i < len; i++) {
+    TEST_ASSERT_EQUAL_INT16(referenceMedian(trace, i, N), f.update(trace[i]));
+  }
+}
+
+void test_duplicates_in_replace_sorted() {
+  // Few distinct values, so the sample that leaves the window usually has
+  // equal neighbours in the sorted array
+  const int16_t trace[] = { 5, 5, 5, 7, 7, 5, 7, 5, 5, 3, 3, 3, 7, 7, 7, 7, 5, 3, 5, 7,
+                            3, 3, 5, 5, 7, 3, 7, 5, 3, 3, 3, 3 };
+  const uint8_t len = sizeof(trace) / sizeof(trace[0]);
+  checkAgainstReference<3>(trace, len);
+  checkAgainstReference<5>(trace, len);
+  checkAgainstReference<6>(trace, len);
+  checkAgainstReference<15>(trace, len);
+}
+
+void test_all_equal_window() {
+  SpikeFilter<5> f(0);
+  for (uint8_t i = 0; i < 12; i++) TEST_ASSERT_EQUAL_INT16(42, f.update(42));
+  TEST_ASSERT_EQUAL_INT16(42, f.update(-1000));
+  TEST_ASSERT_EQUAL_INT16(42, f.update(1000));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_spike_is_rejected);
+  RUN_TEST(test_double_spike_is_rejected);
+  RUN_TEST(test_three_samples_are_a_step_not_a_spike);
+  RUN_TEST(test_slew_limit);
+  RUN_TEST(test_slew_limit_does_not_delay_the_first_value);
+  RUN_TEST(test_warm_up_uses_the_samples_so_far);
+  RUN_TEST(test_reset_restarts_the_warm_up);
+  RUN_TEST(test_duplicates_in_replace_sorted);
+  RUN_TEST(test_all_equal_window);
+  return UNITY_END();
+}
@@ -0,0 +1,389 @@
+#!/usr/bin/env python3
+"""Build, inspect and provision Cellar Pump configuration blobs.
+
+The blob format matches encodeConfig()/decodeConfig() in src/main.cpp:
+
+    'C' 'P' | version | payload length | payload ... | CRC-16/CCITT-FALSE (LE)
+
+Examples:
+    cellarcfg.py make -o site.bin --preset 3 --timing 3=45s/6h --temp-offset -0.4
+    cellarcfg.py make -o site.bin --alarm humidity-high=80/1.5 --alarm temp-low=off
+    cellarcfg.py make -o sump.bin --mode demand --demand-min-run 30s --demand-max-run 4min
+    cellarcfg.py show site.bin
+    cellarcfg.py pull /dev/ttyACM0 -o golden.bin
+    cellarcfg.py push golden.bin /dev/ttyACM0 /dev/ttyACM1 /dev/ttyACM2
+
+push/pull need pyserial (pip install pyserial).
+"""
+
+import argparse
+import re
+import struct
+import sys
+import time
+
+MAGIC = b"CP"
+VERSION = 1
+PRESET_COUNT = 7
+HEADER = struct.Struct("<2sBB")
+FIELDS = struct.Struct("<BBIhh")
+TIMING = struct.Struct("<II")
+BUS = struct.Struct("<BB")
+ALARM = struct.Struct("<hB")
+ALARMS = ("temp-low", "temp-high", "humidity-high", "dew-margin-low")  # AlarmId order
+DEMAND = struct.Struct("<II")
+PAYLOAD_SIZE = (FIELDS.size + PRESET_COUNT * TIMING.size + BUS.size + len(ALARMS) * ALARM.size
+                + DEMAND.size)
+BUS_ADDRESS_MAX = 247
+ALARM_OFF = 0x7FFF
+ALARM_UNITS = ("C", "C", "%RH", "C")
+
+SCHEDULE_MODES = {0: "timed", 1: "demand"}
+
+DEFAULT_PRESETS = [
+    (60_000, 30 * 60_000),
+    (60_000, 2 * 3_600_000),
+    (60_000, 6 * 3_600_000),
+    (60_000, 24 * 3_600_000),
+    (60_000, 60_000),
+    (60_000, 4 * 60_000),
+    (60_000, 10 * 60_000),
+]
+
+# (limit, hysteresis) in tenths, per alarm
+DEFAULT_ALARMS = [(20, 5), (ALARM_OFF, 5), (850, 20), (ALARM_OFF, 5)]
+
+UNITS = {"ms": 1, "s": 1000, "min": 60_000, "h": 3_600_000, "day": 86_400_000}
+
+ERRORS = {1: "size", 2: "magic", 3: "version", 4: "crc", 5: "range"}
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def parse_duration(text):
+    m = re.fullmatch(r"(\d+)\s*(ms|s|min|h|day)", text.strip())
+    if not m:
+        raise argparse.ArgumentTypeError(f"bad duration {text!r} (e.g. 60s, 30min, 2h, 1day)")
+    return int(m.group(1)) * UNITS[m.group(2)]
+
+
+def parse_alarm(text):
+    m = re.fullmatch(r"([a-z-]+)=(off|-?\d+(?:\.\d)?)(?:/(\d+(?:\.\d)?))?", text.strip())
+    if not m or m.group(1) not in ALARMS:
+        raise argparse.ArgumentTypeError(
+            f"bad alarm {text!r} (NAME=LIMIT[/HYSTERESIS] or NAME=off; names: {', '.join(ALARMS)})")
+    limit = ALARM_OFF if m.group(2) == "off" else round(float(m.group(2)) * 10)
+    hysteresis = round(float(m.group(3)) * 10) if m.group(3) else None
+    return ALARMS.index(m.group(1)), limit, hysteresis
+
+
+def format_duration(ms):
+    for unit in ("day", "h", "min", "s"):
+        if ms % UNITS[unit] == 0:
+            return f"{ms // UNITS[unit]}{unit}"
+    return f"{ms}ms"
+
+
+def default_config():
+    return {
+        "preset": 0,
+        "schedule_mode": 0,
+        "green_threshold": 5 * 60_000,
+        "temp_offset": 0,
+        "humidity_offset": 0,
+        "presets": list(DEFAULT_PRESETS),
+        "bus_address": 0,
+        "bus_nodes": 0,
+        "alarms": list(DEFAULT_ALARMS),
+        "demand_min_run": 20_000,
+        "demand_max_run": 5 * 60_000,
+    }
+
+
+def encode(cfg):
+    payload = FIELDS.pack(cfg["preset"], cfg["schedule_mode"], cfg["green_threshold"],
+                          cfg["temp_offset"], cfg["humidity_offset"])
+    for on, cycle in cfg["presets"]:
+        payload += TIMING.pack(on, cycle)
+    payload += BUS.pack(cfg["bus_address"], cfg["bus_nodes"])
+    for limit, hysteresis in cfg["alarms"]:
+        payload += ALARM.pack(limit, hysteresis)
+    payload += DEMAND.pack(cfg["demand_min_run"], cfg["demand_max_run"])
+    body = HEADER.pack(MAGIC, VERSION, len(payload)) + payload
+    return body + struct.pack("<H", crc16(body))
+
+
+def decode(blob):
+    """Decode and validate a blob; raises ValueError with the firmware's error name."""
+    if len(blob) < HEADER.size + 2:
+        raise ValueError("size")
+    magic, version, length = HEADER.unpack_from(blob)
+    if magic != MAGIC:
+        raise ValueError("magic")
+    if version != VERSION:
+        raise ValueError("version")
+    if length > PAYLOAD_SIZE or len(blob) != HEADER.size + length + 2:
+        raise ValueError("size")
+    (crc,) = struct.unpack_from("<H", blob, HEADER.size + length)
+    if crc != crc16(blob[:HEADER.size + length]):
+        raise ValueError("crc")
+
+    cfg = default_config()
+    payload = blob[HEADER.size:HEADER.size + length]
+    if len(payload) >= FIELDS.size:
+        (cfg["preset"], cfg["schedule_mode"], cfg["green_threshold"],
+         cfg["temp_offset"], cfg["humidity_offset"]) = FIELDS.unpack_from(payload)
+    for i in range(PRESET_COUNT):
+        off = FIELDS.size + i * TIMING.size
+        if len(payload) >= off + TIMING.size:
+            cfg["presets"][i] = TIMING.unpack_from(payload, off)
+    off = FIELDS.size + PRESET_COUNT * TIMING.size
+    if len(payload) >= off + BUS.size:
+        cfg["bus_address"], cfg["bus_nodes"] = BUS.unpack_from(payload, off)
+    for i in range(len(ALARMS)):
+        off = FIELDS.size + PRESET_COUNT * TIMING.size + BUS.size + i * ALARM.size
+        if len(payload) >= off + ALARM.size:
+            cfg["alarms"][i] = ALARM.unpack_from(payload, off)
+    off = FIELDS.size + PRESET_COUNT * TIMING.size + BUS.size + len(ALARMS) * ALARM.size
+    if len(payload) >= off + DEMAND.size:
+        cfg["demand_min_run"], cfg["demand_max_run"] = DEMAND.unpack_from(payload, off)
+    validate(cfg)
+    return cfg
+
+
+def validate(cfg):
+    ok = (0 <= cfg["preset"] < PRESET_COUNT
+          and cfg["schedule_mode"] in SCHEDULE_MODES
+          and cfg["green_threshold"] <= UNITS["day"]
+          and abs(cfg["temp_offset"]) <= 100
+          and abs(cfg["humidity_offset"]) <= 200
+          and all(1000 <= on <= UNITS["day"] and 1000 <= cycle <= 7 * UNITS["day"]
+                  for on, cycle in cfg["presets"])
+          and 0 <= cfg["bus_address"] <= BUS_ADDRESS_MAX
+          and 0 <= cfg["bus_nodes"] <= BUS_ADDRESS_MAX
+          and all(limit == ALARM_OFF or -400 <= limit <= 1000 for limit, _ in cfg["alarms"])
+          and all(0 <= hysteresis <= 255 for _, hysteresis in cfg["alarms"])
+          and 1000 <= cfg["demand_min_run"] <= cfg["demand_max_run"] <= UNITS["day"])
+    if not ok:
+        raise ValueError("range")
+
+
+def describe(cfg):
+    lines = [
+        f"preset:          {cfg['preset'] + 1}",
+        f"schedule mode:   {SCHEDULE_MODES.get(cfg['schedule_mode'], cfg['schedule_mode'])}",
+        f"green threshold: {format_duration(cfg['green_threshold'])}",
+        f"temp offset:     {cfg['temp_offset'] / 10:+.1f} C",
+        f"humidity offset: {cfg['humidity_offset'] / 10:+.1f} %RH",
+    ]
+    for i, (on, cycle) in enumerate(cfg["presets"]):
+        lines.append(f"  {i + 1}: {on // 1000}s / {format_duration(cycle)}")
+    if cfg["bus_address"] == 0:
+        lines.append("bus:             off")
+    elif cfg["bus_address"] == 1:
+        lines.append(f"bus:             coordinator, {cfg['bus_nodes']} nodes")
+    else:
+        lines.append(f"bus:             node {cfg['bus_address']}")
+    lines.append(f"demand runs:     {format_duration(cfg['demand_min_run'])} .. "
+                 f"{format_duration(cfg['demand_max_run'])}")
+    lines.append("alarms:")
+    for name, unit, (limit, hysteresis) in zip(ALARMS, ALARM_UNITS, cfg["alarms"]):
+        if limit == ALARM_OFF:
+            lines.append(f"  {name}: off")
+        else:
+            lines.append(f"  {name}: {limit / 10:.1f} {unit}, hysteresis {hysteresis / 10:.1f}")
+    return "\n".join(lines)
+
+
+def read_blob(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def write_blob(path, blob):
+    with open(path, "wb") as f:
+        f.write(blob)
+
+
+# --- Serial transport ------------------------------------------------------
+
+def open_port(port, baud):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("push/pull need pyserial: pip install pyserial")
+    s = serial.Serial(port, baud, timeout=0.2)
+    time.sleep(2.0)  # the Uno resets when the port opens
+    s.reset_input_buffer()
+    return s
+
+
+def transact(s, command, prefix, timeout=3.0):
+    s.write((command + "\n").encode("ascii"))
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        line = s.readline().decode("ascii", "replace").strip()
+        if line.startswith(prefix):
+            return line
+    raise TimeoutError(f"no {prefix!r} reply to {command.split()[0:2]}")
+
+
+def pull(port, baud):
+    with open_port(port, baud) as s:
+        line = transact(s, "cfg export", "CFG ")
+    return bytes.fromhex(line[4:])
+
+
+def push(port, baud, blob):
+    with open_port(port, baud) as s:
+        reply = transact(s, "cfg import " + blob.hex().upper(), "CFG ")
+        if reply != "CFG OK":
+            code = int(reply.split()[-1]) if reply.split()[-1].isdigit() else 0
+            raise RuntimeError(f"device rejected blob: {ERRORS.get(code, reply)}")
+        line = transact(s, "cfg export", "CFG ")
+    if bytes.fromhex(line[4:]) != blob:
+        raise RuntimeError("read-back differs from pushed blob")
+
+
+# --- Command line ----------------------------------------------------------
+
+def cmd_make(args):
+    cfg = decode(read_blob(args.base)) if args.base else default_config()
+    if args.preset is not None:
+        cfg["preset"] = args.preset - 1
+    if args.green_threshold is not None:
+        cfg["green_threshold"] = args.green_threshold
+    if args.temp_offset is not None:
+        cfg["temp_offset"] = round(args.temp_offset * 10)
+    if args.humidity_offset is not None:
+        cfg["humidity_offset"] = round(args.humidity_offset * 10)
+    for spec in args.timing or []:
+        m = re.fullmatch(r"(\d+)=([^/]+)/(.+)", spec)
+        if not m:
+            sys.exit(f"bad --timing {spec!r} (expected N=ON/CYCLE, e.g. 3=60s/6h)")
+        idx = int(m.group(1)) - 1
+        if not 0 <= idx < PRESET_COUNT:
+            sys.exit(f"preset number must be 1..{PRESET_COUNT}")
+        cfg["presets"][idx] = (parse_duration(m.group(2)), parse_duration(m.group(3)))
+    if args.mode is not None:
+        cfg["schedule_mode"] = next(k for k, v in SCHEDULE_MODES.items() if v == args.mode)
+    if args.demand_min_run is not None:
+        cfg["demand_min_run"] = args.demand_min_run
+    if args.demand_max_run is not None:
+        cfg["demand_max_run"] = args.demand_max_run
+    if args.bus_address is not None:
+        cfg["bus_address"] = args.bus_address
+    if args.bus_nodes is not None:
+        cfg["bus_nodes"] = args.bus_nodes
+    for idx, limit, hysteresis in args.alarm or []:
+        if hysteresis is None:
+            hysteresis = cfg["alarms"][idx][1]
+        cfg["alarms"][idx] = (limit, hysteresis)
+    try:
+        validate(cfg)
+    except ValueError:
+        sys.exit("configuration out of range")
+    blob = encode(cfg)
+    write_blob(args.output, blob)
+    print(describe(cfg))
+    print(f"wrote {len(blob)} bytes to {args.output}")
+
+
+def cmd_show(args):
+    blob = read_blob(args.file)
+    try:
+        cfg = decode(blob)
+    except ValueError as e:
+        sys.exit(f"{args.file}: invalid blob ({e})")
+    print(describe(cfg))
+    print(f"{len(blob)} bytes, CRC OK")
+
+
+def cmd_hex(args):
+    blob = read_blob(args.file)
+    decode(blob)
+    print("cfg import " + blob.hex().upper())
+
+
+def cmd_pull(args):
+    blob = pull(args.port, args.baud)
+    decode(blob)
+    write_blob(args.output, blob)
+    print(f"{args.port}: saved {len(blob)} bytes to {args.output}")
+
+
+def cmd_push(args):
+    blob = read_blob(args.file)
+    decode(blob)
+    failed = 0
+    for port in args.ports:
+        try:
+            push(port, args.baud, blob)
+            print(f"{port}: OK")
+        except Exception as e:  # keep going through the batch
+            print(f"{port}: FAILED ({e})")
+            failed += 1
+    sys.exit(1 if failed else 0)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("--baud", type=int, default=9600)
+    sub = p.add_subparsers(dest="command", required=True)
+
+    m = sub.add_parser("make", help="build a blob from defaults or an existing blob")
+    m.add_argument("-o", "--output", required=True)
+    m.add_argument("--base", help="start from this blob instead of the defaults")
+    m.add_argument("--preset", type=int, help="active preset (1-based, as on the LCD)")
+    m.add_argument("--green-threshold", type=parse_duration)
+    m.add_argument("--temp-offset", type=float, help="calibration offset in C")
+    m.add_argument("--humidity-offset", type=float, help="calibration offset in %%RH")
+    m.add_argument("--timing", action="append", metavar="N=ON/CYCLE",
+                   help="preset timing, e.g. 3=60s/6h (repeatable)")
+    m.add_argument("--mode", choices=list(SCHEDULE_MODES.values()),
+                   help="timed: run the preset cycle; demand: run when the float switch rises")
+    m.add_argument("--demand-min-run", type=parse_duration,
+                   help="demand mode: shortest run, even if the float drops sooner")
+    m.add_argument("--demand-max-run", type=parse_duration,
+                   help="demand mode: longest run, even if the float stays up")
+    m.add_argument("--bus-address", type=int,
+                   help="RS-485 address: 0 = off, 1 = coordinator, 2..247 = node")
+    m.add_argument("--bus-nodes", type=int,
+                   help="controllers sharing the cycle (set on the coordinator)")
+    m.add_argument("--alarm", type=parse_alarm, action="append", metavar="NAME=LIMIT[/HYST]",
+                   help="alarm threshold and hysteresis in C or %%RH, or NAME=off, e.g. "
+                        "humidity-high=85/2 (repeatable; names: " + ", ".join(ALARMS) + ")")
+    m.set_defaults(func=cmd_make)
+
+    s = sub.add_parser("show", help="verify a blob and print its contents")
+    s.add_argument("file")
+    s.set_defaults(func=cmd_show)
+
+    h = sub.add_parser("hex", help="print the serial import command for a blob")
+    h.add_argument("file")
+    h.set_defaults(func=cmd_hex)
+
+    pl = sub.add_parser("pull", help="export the configuration of a controller")
+    pl.add_argument("port")
+    pl.add_argument("-o", "--output", required=True)
+    pl.set_defaults(func=cmd_pull)
+
+    ps = sub.add_parser("push", help="import a blob into one or more controllers")
+    ps.add_argument("file")
+    ps.add_argument("ports", nargs="+")
+    ps.set_defaults(func=cmd_push)
+
+    args = p.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
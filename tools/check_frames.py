@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Check the simulator's screens against the golden frames in test/frames.
+
+Every test/frames/<case>.args holds the simulator options of one scenario
+('#' starts a comment); <case>.frames holds the screens it must produce, one
+per line as printed by --frames, without the leading time:
+
+    <r>,<g>,<b> |<row 0>|<row 1>|
+
+The time is left out because it moves with the simulated cost of a loop pass
+(bus time, delays), which a faster renderer is meant to change; every screen
+that appears, and the order they appear in, must stay byte for byte the same.
+A countdown that changed its rounding still shows up as different frames.
+
+Examples:
+    pio run -e native && tools/check_frames.py
+    tools/check_frames.py preset1_cycle overlay_expiry
+    tools/check_frames.py --update          # after an intended display change
+
+Exits with status 1 if any case differs.
+"""
+
+import argparse
+import difflib
+import pathlib
+import re
+import shlex
+import subprocess
+import sys
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+FRAMES_DIR = ROOT / "test" / "frames"
+DEFAULT_PROGRAM = ROOT / ".pio" / "build" / "native" / "program"
+
+FRAME = re.compile(r"^\d+ (\d+,\d+,\d+ \|.*\|.*\|)$")
+
+
+def read_args(path):
+    words = []
+    for line in path.read_text().splitlines():
+        words += shlex.split(line, comments=True)
+    return words
+
+
+def run_case(program, args):
+    out = subprocess.run([str(program), "--frames", "--quiet"] + args,
+                         check=True, capture_output=True, text=True).stdout
+    return [m.group(1) + "\n" for m in map(FRAME.match, out.splitlines()) if m]
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("cases", nargs="*", help="case names (default: all)")
+    p.add_argument("--program", default=str(DEFAULT_PROGRAM), help="simulator binary")
+    p.add_argument("--update", action="store_true", help="rewrite the golden files")
+    args = p.parse_args()
+
+    program = pathlib.Path(args.program)
+    if not program.exists():
+        sys.exit(f"{program} not found; build it with 'pio run -e native'")
+    names = args.cases or sorted(f.stem for f in FRAMES_DIR.glob("*.args"))
+
+    failed = 0
+    for name in names:
+        frames = run_case(program, read_args(FRAMES_DIR / f"{name}.args"))
+        golden_path = FRAMES_DIR / f"{name}.frames"
+        if args.update:
+            golden_path.write_text("".join(frames))
+            print(f"{name}: wrote {len(frames)} frames")
+            continue
+        golden = golden_path.read_text().splitlines(keepends=True) if golden_path.exists() else []
+        if frames == golden:
+            print(f"{name}: ok ({len(frames)} frames)")
+            continue
+        failed += 1
+        print(f"{name}: FAILED")
+        sys.stdout.writelines(difflib.unified_diff(golden, frames, f"{name}.frames", "simulator", n=2))
+    if failed:
+        print(f"{failed} of {len(names)} cases differ")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
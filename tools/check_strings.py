@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Flag string literals that would be placed in SRAM.
+
+On AVR every plain "..." literal is copied into SRAM at startup. Firmware
+text belongs in the flash string pool (include/string_pool.h, plus the
+metric names in include/metrics.h) or, failing that, in F()/PSTR(). This
+script lists every other literal in src/ and include/ and fails if it finds
+one.
+
+Allowed without wrapping: #include paths, static_assert messages, the
+empty literal of a user-defined literal operator (operator"") and
+TRACE_SCOPE() names (compiled out on the target).
+
+Runs standalone (python3 tools/check_strings.py) or as a PlatformIO
+pre-build script (extra_scripts = pre:tools/check_strings.py).
+"""
+
+import os
+import re
+import sys
+
+SCAN_DIRS = ("src", "include")
+EXTENSIONS = (".c", ".cpp", ".h", ".hpp", ".ino")
+POOL_FILE = os.path.join("include", "string_pool.h")
+# Files whose literals all go to flash
+POOL_FILES = (POOL_FILE, os.path.join("include", "metrics.h"))
+
+LITERAL = re.compile(r'"(?:[^"\\\n]|\\.)*"')
+
+
+def strip_comments(text):
+    # Blank out comments but keep the newlines so line numbers stay right.
+    # String literals are matched first so "//" inside a string survives.
+    def blank(m):
+        s = m.group(0)
+        return s if s.startswith('"') else re.sub(r"[^\n]", " ", s)
+    return re.sub(r'"(?:[^"\\\n]|\\.)*"|//[^\n]*|/\*.*?\*/', blank, text, flags=re.S)
+
+
+def allowed(line, start):
+    before = line[:start].rstrip()
+    stripped = line.lstrip()
+    if stripped.startswith("#include"):
+        return True
+    if "static_assert" in line:
+        return True
+    if before.endswith("operator"):
+        return True
+    if before.endswith("TRACE_SCOPE("):
+        return True
+    if before.endswith("F(") or before.endswith("PSTR("):
+        return True
+    return False
+
+
+def check(root):
+    problems = []
+    for d in SCAN_DIRS:
+        for dirpath, _, files in os.walk(os.path.join(root, d)):
+            for name in sorted(files):
+                if not name.endswith(EXTENSIONS):
+                    continue
+                path = os.path.join(dirpath, name)
+                rel = os.path.relpath(path, root)
+                if rel in POOL_FILES:
+                    continue
+                with open(path, encoding="utf-8") as f:
+                    text = strip_comments(f.read())
+                for lineno, line in enumerate(text.splitlines(), 1):
+                    for m in LITERAL.finditer(line):
+                        if not allowed(line, m.start()):
+                            problems.append(f"{rel}:{lineno}: SRAM string literal {m.group(0)}")
+    return problems
+
+
+def report(root):
+    problems = check(root)
+    for p in problems:
+        print(p, file=sys.stderr)
+    if problems:
+        print(f"{len(problems)} string literal(s) outside the flash string pool "
+              f"({POOL_FILE})", file=sys.stderr)
+    return not problems
+
+
+try:
+    Import("env")  # noqa: F821 — defined when run by PlatformIO
+except NameError:
+    if __name__ == "__main__":
+        sys.exit(0 if report(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))) else 1)
+else:
+    if not report(env.subst("$PROJECT_DIR")):  # noqa: F821
+        env.Exit(1)  # noqa: F821
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Decode a data-logger flash image (SPI NOR dump or simulator --flash file).
+
+The format matches include/log_store.h: 64-byte log pages
+
+    0xA5 | count | seq u32 | CRC-16/CCITT-FALSE u16 | count x 8-byte record
+
+and records of  time u32 (s since boot) | type u8 | 3 data bytes.
+Pages are printed in sequence order as CSV: seq,time,type,values.
+
+Examples:
+    logdump.py flash.bin
+    logdump.py flash.bin --stats
+"""
+
+import argparse
+import struct
+import sys
+
+PAGE_SIZE = 64
+HEADER = struct.Struct("<BBIH")
+RECORD = struct.Struct("<IB3s")
+MAGIC = 0xA5
+MAX_RECORDS = (PAGE_SIZE - HEADER.size) // RECORD.size
+
+TYPES = {1: "boot", 2: "sensor", 3: "pump_on", 4: "pump_off", 5: "sync", 6: "alarm",
+         7: "denied", 8: "float"}
+PUMP_BY_FLOAT = 1 << 23  # pump_on: started by the float switch
+ALARMS = ("temp-low", "temp-high", "humidity-high", "dew-margin-low")  # AlarmId order
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def signed12(v):
+    return v - 0x1000 if v & 0x800 else v
+
+
+def pages(image):
+    """Yield (seq, [records]) for every valid page, in flash order."""
+    for off in range(0, len(image) - PAGE_SIZE + 1, PAGE_SIZE):
+        page = image[off:off + PAGE_SIZE]
+        magic, count, seq, crc = HEADER.unpack_from(page)
+        if magic != MAGIC or not 0 < count <= MAX_RECORDS:
+            continue
+        body = page[HEADER.size:HEADER.size + count * RECORD.size]
+        if crc16(body, crc16(page[:6])) != crc:
+            continue
+        yield seq, [RECORD.unpack_from(body, i * RECORD.size) for i in range(count)]
+
+
+def describe(rtype, data):
+    v = int.from_bytes(data, "little")
+    if rtype == 2:
+        return f"{signed12(v & 0xFFF) / 10:.1f},{signed12(v >> 12) / 10:.1f}"
+    if rtype == 3 and v & PUMP_BY_FLOAT:
+        return f"{v & ~PUMP_BY_FLOAT},float"
+    if rtype == 6:
+        alarm = signed12(v & 0xFFF)
+        name = ALARMS[abs(alarm) - 1] if 0 < abs(alarm) <= len(ALARMS) else str(abs(alarm))
+        return f"{name},{'on' if alarm > 0 else 'off'},{signed12(v >> 12) / 10:.1f}"
+    if rtype == 7:
+        return {1: "rest", 2: "budget"}.get(v, str(v))
+    if rtype == 8:
+        return "stuck" if v else "ok"
+    return str(v)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("image")
+    p.add_argument("--stats", action="store_true", help="print a summary instead of the records")
+    args = p.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    found = sorted(pages(image))
+    if args.stats:
+        records = sum(len(r) for _, r in found)
+        print(f"{len(found)} valid pages, {records} records, "
+              f"seq {found[0][0]}..{found[-1][0]}" if found else "no valid pages")
+        return
+    for seq, records in found:
+        for time, rtype, data in records:
+            print(f"{seq},{time},{TYPES.get(rtype, rtype)},{describe(rtype, data)}")
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+"""Wire serial ports together as one RS-485 bus, and watch or poll it.
+
+Every byte read from one port is written to all the others, as on a shared
+pair. Ports are paths: the pseudo-terminals of simulators started with
+--bus-pty, or USB RS-485 adapters (9600 8N1).
+
+Frames seen on the bus (format in include/bus_frame.h) are printed decoded,
+with the port they came from; anything else is ignored. Two ports sending
+at once is reported as a collision. A status reply is shown with the
+node's latched alarms and its skew: how far the node's site clock is from
+the coordinator's, as extrapolated from the last time sync.
+
+With --poll the hub also acts as a site PC on the bus and polls the listed
+addresses in turn, whenever the line is quiet.
+
+Examples:
+    sim --bus-pty --send 0:"$(cellarcfg.py hex coord.bin)"     # bus: /dev/pts/5
+    sim --bus-pty --send 0:"$(cellarcfg.py hex node2.bin)"     # bus: /dev/pts/6
+    rs485hub.py /dev/pts/5 /dev/pts/6 --poll 2 --poll-interval 10
+"""
+
+import argparse
+import os
+import select
+import struct
+import sys
+import termios
+import time
+import tty
+
+BROADCAST = 0
+STATUS_PUMP = 0x01
+STATUS_SYNCED = 0x02
+ALARMS = ("temp-low", "temp-high", "humidity-high", "dew-margin-low")  # by bit
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def parse_frame(line):
+    """Bytes (address, type, payload) of a ':' line, or None if malformed."""
+    try:
+        raw = bytes.fromhex(line[1:])
+    except ValueError:
+        return None
+    if len(raw) < 4 or struct.unpack_from("<H", raw, len(raw) - 2)[0] != crc16(raw[:-2]):
+        return None
+    return raw[:-2]
+
+
+def format_frame(frame):
+    return ":" + (frame + struct.pack("<H", crc16(frame))).hex().upper() + "\r\n"
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    attrs = termios.tcgetattr(fd)
+    attrs[4] = attrs[5] = termios.B9600  # ispeed, ospeed (pseudo-terminals ignore them)
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    tty.setraw(fd)
+    return fd
+
+
+class Bus:
+    def __init__(self, paths):
+        self.paths = paths
+        self.fds = [open_port(p) for p in paths]
+        self.lines = [b""] * len(paths)   # partial line per port
+        self.last_rx = 0.0
+        self.sync = None                   # (site ms, monotonic s) of the last time sync
+
+    def send(self, data, skip=None):
+        for i, fd in enumerate(self.fds):
+            if i == skip:
+                continue
+            try:
+                os.write(fd, data)
+            except OSError:
+                pass  # nobody on that end any more (e.g. a simulator that finished)
+
+    def busy(self):
+        return any(self.lines) or time.monotonic() - self.last_rx < 0.02
+
+    def pump(self, timeout):
+        ready, _, _ = select.select(self.fds, [], [], timeout)
+        for fd in ready:
+            i = self.fds.index(fd)
+            try:
+                data = os.read(fd, 4096)
+            except OSError:
+                continue
+            if not data:
+                continue
+            self.last_rx = time.monotonic()
+            self.send(data, skip=i)
+            self.receive(i, data)
+
+    def receive(self, port, data):
+        for b in data:
+            if b == ord(":"):
+                others = [j for j, line in enumerate(self.lines) if line and j != port]
+                if others:
+                    self.report(port, f"collision with {self.paths[others[0]]}")
+                self.lines[port] = b":"
+            elif b == ord("\n"):
+                if self.lines[port]:
+                    self.show(port, self.lines[port].decode("ascii", "replace").strip())
+                self.lines[port] = b""
+            elif self.lines[port]:
+                self.lines[port] += bytes([b])
+
+    def show(self, port, line):
+        frame = parse_frame(line)
+        if frame is None:
+            self.report(port, f"bad frame {line}")
+            return
+        address, kind, payload = frame[0], chr(frame[1]), frame[2:]
+        to = "all" if address == BROADCAST else str(address)
+        if kind == "T" and len(payload) >= 5:
+            site, nodes = struct.unpack_from("<IB", payload)
+            self.sync = (site, time.monotonic())
+            text = f"T to {to}: site {site / 1000:.3f} s, {nodes} nodes"
+        elif kind == "S" and len(payload) >= 7:
+            site, sender, flags, preset = struct.unpack_from("<IBBB", payload)
+            text = (f"S from {sender}: site {site / 1000:.3f} s, preset {preset + 1}, "
+                    f"pump {'on' if flags & STATUS_PUMP else 'off'}, "
+                    f"{'synced' if flags & STATUS_SYNCED else 'free-running'}")
+            if len(payload) >= 8:
+                alarms = [name for bit, name in enumerate(ALARMS) if payload[7] & (1 << bit)]
+                text += f", alarms {','.join(alarms) or 'none'}"
+            if self.sync:
+                expected = self.sync[0] + (time.monotonic() - self.sync[1]) * 1000
+                text += f", skew {site - expected:+.0f} ms"
+        elif kind == "P":
+            text = f"P to {to}"
+        else:
+            text = f"{kind} to {to}: {payload.hex()}"
+        self.report(port, text)
+
+    def report(self, port, text):
+        source = self.paths[port] if port is not None else "hub"
+        print(f"{time.strftime('%H:%M:%S')} {source}: {text}", flush=True)
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("ports", nargs="+", help="pseudo-terminals or serial devices on the bus")
+    p.add_argument("--poll", help="addresses to poll for status, e.g. 2,3,4")
+    p.add_argument("--poll-interval", type=float, default=5.0, help="seconds between polls of the same address")
+    args = p.parse_args()
+
+    try:
+        bus = Bus(args.ports)
+    except OSError as e:
+        sys.exit(f"cannot open port: {e}")
+    polls = [int(a) for a in args.poll.split(",")] if args.poll else []
+    next_poll, index = time.monotonic() + args.poll_interval, 0
+    try:
+        while True:
+            bus.pump(0.01)
+            if polls and time.monotonic() >= next_poll and not bus.busy():
+                address = polls[index % len(polls)]
+                bus.send(format_frame(bytes([address, ord("P")])).encode("ascii"))
+                bus.report(None, f"P to {address}")
+                index += 1
+                next_poll = time.monotonic() + args.poll_interval / len(polls)
+    except KeyboardInterrupt:
+        return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,402 @@
+#!/usr/bin/env python3
+"""Compile Cellar Pump rules to the bytecode run by include/rule_vm.h.
+
+A rule is a list of statements, evaluated top to bottom at every scheduled
+pump start. The first action reached decides; if none is reached the pump
+runs as the preset says.
+
+    # pump only above 70% humidity, never at night, longer when cold
+    if time >= 22:00 or (time >= 0 and time < 06:00): skip
+    if humidity < 70%: skip
+    if temperature < 5.0C: run on_seconds * 2
+    run
+
+Statements:  if <expr>: <action>   |   <action>
+Actions:     run  |  run <seconds>  |  skip
+Operators:   or and not  < <= > >= == !=  + - * /  ( )
+Literals:    70%  -> 700 (0.1 %RH)     5.5C -> 55 (0.1 C)
+             22:00 -> 1320 (minute of day)
+             90s 2min 1h -> seconds    plain integers as written
+Variables:   temperature humidity time (minute of day, -1 if the clock is
+             not set) uptime_hours run_count skip_count preset on_seconds
+             cycle_minutes
+
+Examples:
+    rulec.py night.rule                     # prints "rule load <hex>"
+    rulec.py night.rule --disasm
+    rulec.py night.rule --simulate humidity=80% time=23:30
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAX_CODE = 64
+MAX_STACK = 8
+
+OPS = {
+    "PUSH8": 0x01, "PUSH16": 0x02, "LOAD": 0x03,
+    "ADD": 0x10, "SUB": 0x11, "MUL": 0x12, "DIV": 0x13, "NEG": 0x14,
+    "LT": 0x20, "LE": 0x21, "GT": 0x22, "GE": 0x23, "EQ": 0x24, "NE": 0x25,
+    "AND": 0x26, "OR": 0x27, "NOT": 0x28,
+    "JZ": 0x30, "JMP": 0x31,
+    "RUN": 0x40, "SKIP": 0x41, "RUN_FOR": 0x42,
+}
+OP_NAMES = {v: k for k, v in OPS.items()}
+OPERANDS = {"PUSH8": 1, "PUSH16": 2, "LOAD": 1, "JZ": 1, "JMP": 1}
+
+VARS = ["temperature", "humidity", "time", "uptime_hours", "run_count",
+        "skip_count", "preset", "on_seconds", "cycle_minutes"]
+ALIASES = {"temp": "temperature", "hum": "humidity", "minute_of_day": "time"}
+
+BINARY = {"+": "ADD", "-": "SUB", "*": "MUL", "/": "DIV",
+          "<": "LT", "<=": "LE", ">": "GT", ">=": "GE", "==": "EQ", "!=": "NE"}
+
+TOKEN = re.compile(r"""
+    (?P<ws>[ \t]+) | (?P<comment>\#[^\n]*) | (?P<nl>[\n;]) |
+    (?P<time>\d{1,2}:\d{2}) |
+    (?P<num>\d+(?:\.\d+)?)(?P<unit>%|C|s|min|h)? |
+    (?P<op><=|>=|==|!=|[-+*/<>():]) |
+    (?P<name>[A-Za-z_]\w*)
+""", re.X)
+
+
+class CompileError(Exception):
+    pass
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def literal(num, unit):
+    value = float(num)
+    if unit in ("%", "C"):
+        return round(value * 10)
+    if unit == "min":
+        value *= 60
+    elif unit == "h":
+        value *= 3600
+    if value != int(value):
+        raise CompileError(f"{num}{unit or ''} must be a whole number")
+    return int(value)
+
+
+def tokenize(src):
+    tokens, pos, line = [], 0, 1
+    while pos < len(src):
+        m = TOKEN.match(src, pos)
+        if not m:
+            raise CompileError(f"line {line}: unexpected {src[pos]!r}")
+        pos = m.end()
+        if m.group("nl"):
+            tokens.append(("nl", None, line))
+            line += src[m.start():m.end()].count("\n")
+        elif m.group("time"):
+            h, mi = map(int, m.group("time").split(":"))
+            if h > 23 or mi > 59:
+                raise CompileError(f"line {line}: bad time {m.group('time')}")
+            tokens.append(("num", h * 60 + mi, line))
+        elif m.group("num"):
+            tokens.append(("num", literal(m.group("num"), m.group("unit")), line))
+        elif m.group("op"):
+            tokens.append(("op", m.group("op"), line))
+        elif m.group("name"):
+            tokens.append(("name", m.group("name"), line))
+    tokens.append(("nl", None, line))
+    tokens.append(("eof", None, line))
+    return tokens
+
+
+class Compiler:
+    def __init__(self, tokens):
+        self.tokens = tokens
+        self.pos = 0
+        self.code = bytearray()
+
+    # --- token helpers ---
+    def peek(self):
+        return self.tokens[self.pos]
+
+    def take(self):
+        tok = self.tokens[self.pos]
+        self.pos += 1
+        return tok
+
+    def accept(self, kind, value=None):
+        tok = self.peek()
+        if tok[0] == kind and (value is None or tok[1] == value):
+            self.pos += 1
+            return True
+        return False
+
+    def expect(self, kind, value=None):
+        tok = self.peek()
+        if not self.accept(kind, value):
+            raise CompileError(f"line {tok[2]}: expected {value or kind}, got {tok[1] or tok[0]!r}")
+
+    def emit(self, op, *operands):
+        self.code.append(OPS[op])
+        self.code.extend(operands)
+
+    # --- grammar ---
+    def program(self):
+        while not self.accept("eof"):
+            if self.accept("nl"):
+                continue
+            self.statement()
+        if len(self.code) > MAX_CODE:
+            raise CompileError(f"program is {len(self.code)} bytes, limit is {MAX_CODE}")
+        return bytes(self.code)
+
+    def statement(self):
+        if self.accept("name", "if"):
+            self.expr()
+            self.expect("op", ":")
+            self.emit("JZ", 0)
+            patch = len(self.code) - 1
+            self.action()
+            offset = len(self.code) - (patch + 1)
+            if offset > 255:
+                raise CompileError("if body too long")
+            self.code[patch] = offset
+        else:
+            self.action()
+        if not self.accept("nl"):
+            tok = self.peek()
+            raise CompileError(f"line {tok[2]}: expected end of statement")
+
+    def action(self):
+        tok = self.take()
+        if tok[:2] == ("name", "skip"):
+            self.emit("SKIP")
+        elif tok[:2] == ("name", "run"):
+            if self.peek()[0] in ("nl", "eof"):
+                self.emit("RUN")
+            else:
+                self.expr()
+                self.emit("RUN_FOR")
+        else:
+            raise CompileError(f"line {tok[2]}: expected run or skip")
+
+    def expr(self):
+        self.and_expr()
+        while self.accept("name", "or"):
+            self.and_expr()
+            self.emit("OR")
+
+    def and_expr(self):
+        self.not_expr()
+        while self.accept("name", "and"):
+            self.not_expr()
+            self.emit("AND")
+
+    def not_expr(self):
+        if self.accept("name", "not"):
+            self.not_expr()
+            self.emit("NOT")
+        else:
+            self.comparison()
+
+    def comparison(self):
+        self.sum()
+        tok = self.peek()
+        if tok[0] == "op" and tok[1] in ("<", "<=", ">", ">=", "==", "!="):
+            self.take()
+            self.sum()
+            self.emit(BINARY[tok[1]])
+
+    def sum(self):
+        self.term()
+        while self.peek()[0] == "op" and self.peek()[1] in "+-":
+            op = self.take()[1]
+            self.term()
+            self.emit(BINARY[op])
+
+    def term(self):
+        self.unary()
+        while self.peek()[0] == "op" and self.peek()[1] in "*/":
+            op = self.take()[1]
+            self.unary()
+            self.emit(BINARY[op])
+
+    def unary(self):
+        if self.accept("op", "-"):
+            tok = self.peek()
+            if tok[0] == "num":
+                self.take()
+                self.push(-tok[1], tok[2])
+            else:
+                self.unary()
+                self.emit("NEG")
+        else:
+            self.atom()
+
+    def atom(self):
+        tok = self.take()
+        if tok[0] == "num":
+            self.push(tok[1], tok[2])
+        elif tok[0] == "name":
+            name = ALIASES.get(tok[1], tok[1])
+            if name not in VARS:
+                raise CompileError(f"line {tok[2]}: unknown variable {tok[1]!r}")
+            self.emit("LOAD", VARS.index(name))
+        elif tok[:2] == ("op", "("):
+            self.expr()
+            self.expect("op", ")")
+        else:
+            raise CompileError(f"line {tok[2]}: unexpected {tok[1] or tok[0]!r}")
+
+    def push(self, value, line):
+        if not -32768 <= value <= 32767:
+            raise CompileError(f"line {line}: {value} does not fit in 16 bits")
+        if -128 <= value <= 127:
+            self.emit("PUSH8", value & 0xFF)
+        else:
+            self.emit("PUSH16", *struct.pack("<h", value))
+
+
+def compile_rule(src):
+    return Compiler(tokenize(src)).program()
+
+
+def blob(code):
+    body = bytes([len(code)]) + code
+    return body + struct.pack("<H", crc16(body))
+
+
+def disassemble(code):
+    pc, lines = 0, []
+    while pc < len(code):
+        name = OP_NAMES[code[pc]]
+        n = OPERANDS.get(name, 0)
+        args = code[pc + 1:pc + 1 + n]
+        if name == "PUSH8":
+            text = str(struct.unpack("<b", args)[0])
+        elif name == "PUSH16":
+            text = str(struct.unpack("<h", args)[0])
+        elif name == "LOAD":
+            text = VARS[args[0]]
+        elif name in ("JZ", "JMP"):
+            text = f"-> {pc + 1 + n + args[0]}"
+        else:
+            text = ""
+        lines.append(f"{pc:3d}  {name:8s} {text}")
+        pc += 1 + n
+    return "\n".join(lines)
+
+
+def wrap16(v):
+    return (v + 0x8000) % 0x10000 - 0x8000
+
+
+def evaluate(code, values):
+    """Reference VM; mirrors ruleEvaluate() in include/rule_vm.h."""
+    stack, pc, steps = [], 0, 0
+    while pc < len(code):
+        steps += 1
+        name = OP_NAMES[code[pc]]
+        pc += 1
+        if name in ("PUSH8", "PUSH16", "LOAD"):
+            if len(stack) >= MAX_STACK:
+                return "error", 0, steps
+            if name == "PUSH8":
+                stack.append(struct.unpack("<b", code[pc:pc + 1])[0]); pc += 1
+            elif name == "PUSH16":
+                stack.append(struct.unpack("<h", code[pc:pc + 2])[0]); pc += 2
+            else:
+                stack.append(values[code[pc]]); pc += 1
+            continue
+        if name == "JMP":
+            pc += code[pc] + 1
+            continue
+        if name == "RUN":
+            return "run", 0, steps
+        if name == "SKIP":
+            return "skip", 0, steps
+        if not stack:
+            return "error", 0, steps
+        b = stack.pop()
+        if name == "JZ":
+            off = code[pc]; pc += 1
+            if b == 0:
+                pc += off
+            continue
+        if name == "RUN_FOR":
+            return "run", max(b, 0), steps
+        if name == "NEG":
+            stack.append(wrap16(-b)); continue
+        if name == "NOT":
+            stack.append(int(not b)); continue
+        if not stack:
+            return "error", 0, steps
+        a = stack[-1]
+        if name == "DIV":
+            r = 0 if b == 0 else int(a / b)
+        else:
+            r = {"ADD": a + b, "SUB": a - b, "MUL": a * b,
+                 "LT": a < b, "LE": a <= b, "GT": a > b, "GE": a >= b,
+                 "EQ": a == b, "NE": a != b,
+                 "AND": bool(a and b), "OR": bool(a or b)}[name]
+        stack[-1] = wrap16(int(r))
+    return "run", 0, steps
+
+
+def parse_assignments(items):
+    values = [0] * len(VARS)
+    values[VARS.index("time")] = -1
+    values[VARS.index("preset")] = 1
+    values[VARS.index("on_seconds")] = 60
+    values[VARS.index("cycle_minutes")] = 30
+    for item in items:
+        name, _, text = item.partition("=")
+        name = ALIASES.get(name, name)
+        if name not in VARS:
+            sys.exit(f"unknown variable {name!r}")
+        toks = tokenize(text)
+        neg = toks[0][:2] == ("op", "-")
+        tok = toks[1] if neg else toks[0]
+        if tok[0] != "num":
+            sys.exit(f"bad value for {name}: {text!r}")
+        values[VARS.index(name)] = -tok[1] if neg else tok[1]
+    return values
+
+
+def main():
+    p = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    p.add_argument("source", help="rule file ('-' for stdin)")
+    p.add_argument("-o", "--output", help="write the binary blob to this file")
+    p.add_argument("--disasm", action="store_true", help="print the bytecode")
+    p.add_argument("--simulate", nargs="*", metavar="VAR=VALUE",
+                   help="evaluate with these inputs, e.g. humidity=80%% time=23:30")
+    args = p.parse_args()
+
+    src = sys.stdin.read() if args.source == "-" else open(args.source).read()
+    try:
+        code = compile_rule(src)
+    except CompileError as e:
+        sys.exit(f"{args.source}: {e}")
+
+    data = blob(code)
+    if args.output:
+        with open(args.output, "wb") as f:
+            f.write(data)
+    if args.disasm:
+        print(disassemble(code))
+    if args.simulate is not None:
+        decision, seconds, steps = evaluate(code, parse_assignments(args.simulate))
+        print(f"{decision}{f' {seconds}s' if seconds else ''} ({steps} instructions)")
+    if not (args.disasm or args.simulate is not None):
+        print("rule load " + data.hex().upper())
+    print(f"{len(code)} bytes of code", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,416 @@
+#!/usr/bin/env python3
+"""Worst-case stack depth and loop() cycle estimate from the firmware ELF.
+
+The bound is computed from the code, not measured, so it covers paths a
+test run never takes. avr-objdump gives every function (ours, the Arduino
+core, Wire, rgb_lcd, DHT, libc, libgcc):
+
+  frame   pushes, "rcall .+0" (2 bytes each) and the frame pointer
+          adjustment (sbiw / subi+sbci on r28:r29) in its body
+  calls   call / rcall, and jmp / rjmp to another function (tail calls)
+
+Stack depth of a function = its frame + the deepest of its callees plus
+the return address each call pushes. Indirect calls (icall, eicall) may
+reach any function in a C++ vtable or in CALLBACKS below. Recursion has no
+static bound and fails the check, as does any function compiled with a
+dynamic frame (alloca, variable-length arrays), which -fstack-usage
+reports in the .su files.
+
+Total = deepest of main() and the static constructors + deepest ISR (AVR
+interrupts do not nest unless an ISR re-enables them). The check fails if
+that exceeds the SRAM left after .data and .bss; nothing here uses the heap.
+
+The cycle count is the longest path through loop() with every loop body
+counted once, plus the worst path of each callee; it is an estimate, not a
+bound: time spent spinning in delay(), busy-waits and retry loops is left
+out. Conditional branches and skips are charged their taken cost.
+
+Runs standalone:
+
+  python3 tools/stack_report.py .pio/build/uno/firmware.elf --ram 2048
+
+or as a PlatformIO post script (extra_scripts = post:tools/stack_report.py),
+which reports after every firmware build and fails the build when the check
+fails (it is skipped, with a note, when avr-objdump or the ELF cannot be
+read), and adds "pio run -t stack" for the report alone.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+# Functions only reached through a pointer that is not in a vtable
+# (Wire's slave-mode callbacks, called from the TWI interrupt)
+CALLBACKS = ("TwoWire::onReceiveService", "TwoWire::onRequestService")
+
+ROOTS = ("main", "__do_global_ctors")
+REPORTED = ("setup", "loop")
+
+HEADER = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+INSN = re.compile(r"^\s*([0-9a-f]+):\s+(?:[0-9a-f]{2} )+\s*\t(\S+)\s*([^;]*?)\s*(?:;\s*(?:0x([0-9a-f]+))?.*)?$")
+SYMBOL = re.compile(r"^([0-9a-f]+)\s.{7}\s(\S+)\s+([0-9a-f]+)\s+(.+)$")
+SECTION = re.compile(r"^\s*\d+\s+(\S+)\s+([0-9a-f]+)\s")
+
+BRANCHES = {"brbc", "brbs", "brcc", "brcs", "breq", "brge", "brhc", "brhs", "brid", "brie",
+            "brlo", "brlt", "brmi", "brne", "brpl", "brsh", "brtc", "brts", "brvc", "brvs"}
+SKIPS = {"cpse", "sbrc", "sbrs", "sbic", "sbis"}
+JUMPS = {"rjmp", "jmp"}
+CALLS = {"rcall", "call"}
+INDIRECT_CALLS = {"icall", "eicall"}
+INDIRECT_JUMPS = {"ijmp", "eijmp"}
+RETURNS = {"ret", "reti"}
+TABLE_JUMPS = ("__tablejump2__", "__tablejump__")
+
+# megaAVR cycle counts (worst case); anything not listed takes 1
+CYCLES = {
+    "adiw": 2, "sbiw": 2, "mul": 2, "muls": 2, "mulsu": 2, "fmul": 2, "fmuls": 2, "fmulsu": 2,
+    "ld": 2, "ldd": 2, "st": 2, "std": 2, "lds": 2, "sts": 2, "push": 2, "pop": 2,
+    "sbi": 2, "cbi": 2, "rjmp": 2, "ijmp": 2, "eijmp": 2, "jmp": 3,
+    "lpm": 3, "elpm": 3, "rcall": 3, "icall": 3, "eicall": 4, "call": 4, "ret": 4, "reti": 4,
+}
+for _b in BRANCHES:
+    CYCLES[_b] = 2
+for _s in SKIPS:
+    CYCLES[_s] = 3
+
+
+class Function:
+    def __init__(self, name, addr):
+        self.name = name
+        self.addr = addr
+        self.insns = []       # (addr, mnemonic, operands, target)
+        self.frame = 0
+        self.calls = set()    # callee addresses
+        self.indirect = False
+
+    def short(self):
+        return self.name.split("(")[0]
+
+
+def run(tool, *args):
+    return subprocess.run([tool, *args], check=True, capture_output=True, text=True).stdout
+
+
+def parse_disassembly(text):
+    funcs = {}
+    cur = None
+    for line in text.splitlines():
+        m = HEADER.match(line)
+        if m:
+            cur = Function(m.group(2), int(m.group(1), 16))
+            funcs[cur.addr] = cur
+            continue
+        m = INSN.match(line)
+        if m and cur:
+            addr, op, operands, comment = m.groups()
+            target = int(comment, 16) if comment else None
+            if target is None and op in ("call", "jmp") and operands.startswith("0x"):
+                target = int(operands, 16)
+            cur.insns.append((int(addr, 16), op, operands.replace(" ", ""), target))
+    return funcs
+
+
+def function_end(funcs, f):
+    return f.insns[-1][0] + 1 if f.insns else f.addr
+
+
+def analyze_frames(funcs):
+    starts = set(funcs)
+    for f in funcs.values():
+        end = function_end(funcs, f)
+        fp_frame = 0
+        for i, (addr, op, operands, target) in enumerate(f.insns):
+            if op == "push":
+                f.frame += 1
+            elif op == "rcall" and operands == ".+0":
+                f.frame += 2
+            elif op == "sbiw" and operands.startswith("r28,"):
+                fp_frame = max(fp_frame, int(operands.split(",")[1], 0))
+            elif op == "subi" and operands.startswith("r28,") and i + 1 < len(f.insns):
+                nop, nops = f.insns[i + 1][1], f.insns[i + 1][2]
+                if nop == "sbci" and nops.startswith("r29,"):
+                    size = int(operands.split(",")[1], 0) + 256 * int(nops.split(",")[1], 0)
+                    if size < 0x8000:           # not the epilogue adding it back
+                        fp_frame = max(fp_frame, size)
+            if op in CALLS and operands != ".+0" and target is not None:
+                f.calls.add(target)
+            elif op in JUMPS and target in starts and target != f.addr:
+                f.calls.add(target)             # tail call
+            elif op in JUMPS and target is not None and not (f.addr <= target < end):
+                f.calls.add(target)
+            elif op in INDIRECT_CALLS:
+                f.indirect = True
+        f.frame += fp_frame
+
+
+def indirect_targets(funcs, elf, objdump):
+    """Functions reachable through a pointer: vtable entries and CALLBACKS."""
+    by_name = {f.short(): a for a, f in funcs.items()}
+    targets = {by_name[n] for n in CALLBACKS if n in by_name}
+
+    vtables = []
+    for line in run(objdump, "-t", "-C", elf).splitlines():
+        m = SYMBOL.match(line)
+        if m and m.group(4).startswith("vtable for "):
+            vtables.append((int(m.group(1), 16), int(m.group(3), 16)))
+    if not vtables:
+        return targets
+
+    # Vtables live in .data (RAM); their entries are word addresses
+    data = {}
+    for line in run(objdump, "-s", "-j", ".data", elf).splitlines():
+        parts = line.split()
+        if len(parts) < 2 or not re.fullmatch(r"[0-9a-f]+", parts[0]):
+            continue
+        base = int(parts[0], 16)
+        start = line.index(parts[0]) + len(parts[0]) + 1
+        raw = line[start:start + 35].replace(" ", "")   # four groups of 4 bytes
+        for i in range(0, len(raw), 2):
+            data[base + i // 2] = int(raw[i:i + 2], 16)
+    for start, size in vtables:
+        for off in range(0, size - 1, 2):
+            if start + off in data and start + off + 1 in data:
+                word = data[start + off] | (data[start + off + 1] << 8)
+                if word * 2 in funcs:
+                    targets.add(word * 2)
+    return targets
+
+
+class Recursion(Exception):
+    pass
+
+
+def stack_depth(funcs, targets, pc_bytes):
+    memo = {}
+
+    def depth(addr, chain):
+        """(depth, path, the callers on chain whose presence the result
+        depends on); only results depending on no caller are memoized."""
+        if addr in memo:
+            return memo[addr]
+        f = funcs.get(addr)
+        if f is None:
+            return 0, [], frozenset()
+        if addr in chain:
+            names = [funcs[a].short() for a in chain[chain.index(addr):]] + [f.short()]
+            raise Recursion(" -> ".join(names))
+        chain.append(addr)
+        # A virtual call back into a function already on the path is taken to
+        # be another object's method (Print::write(buf) -> write(c)), not recursion
+        callees = set(f.calls)
+        needs = set()
+        if f.indirect:
+            callees |= targets - set(chain)
+            needs |= targets & set(chain)
+        best, path = 0, []
+        for c in callees:
+            d, p, n = depth(c, chain)
+            needs |= n
+            if c in funcs and d + pc_bytes > best:
+                best, path = d + pc_bytes, p
+        chain.pop()
+        needs.discard(addr)             # on the chain wherever this is called from
+        result = (f.frame + best, [f.short()] + path, frozenset(needs))
+        if not needs:
+            memo[addr] = result
+        return result
+
+    return lambda addr, chain: depth(addr, chain)[:2]
+
+
+def path_cycles(funcs, targets, pc_bytes):
+    """Longest path through each function, loop bodies counted once, and
+    the calls made along it as (name, cycles)."""
+    extra = 1 if pc_bytes == 3 else 0
+    memo = {}
+
+    def cycles(addr, chain):
+        if addr in memo:
+            return memo[addr]
+        f = funcs.get(addr)
+        if f is None or addr in chain:
+            return 0, []
+        chain.append(addr)
+        end = function_end(funcs, f)
+        index = {a: i for i, (a, _, _, _) in enumerate(f.insns)}
+        dist = [0] * (len(f.insns) + 1)
+        via = [[] for _ in range(len(f.insns) + 1)]
+        best_after = [0] * (len(f.insns) + 2)
+        for i in range(len(f.insns) - 1, -1, -1):
+            addr_i, op, operands, target = f.insns[i]
+            cost = CYCLES.get(op, 1) + (extra if op in ("call", "rcall", "icall", "ret", "reti") else 0)
+            callee = 0
+            succ = []
+            if op in CALLS and operands != ".+0" and target is not None:
+                name = funcs[target].name if target in funcs else ""
+                callee = cycles(target, chain)[0]
+                if name.startswith(TABLE_JUMPS):
+                    succ = ["table"]
+                else:
+                    succ = [i + 1]
+            elif op in INDIRECT_CALLS:
+                for t in targets:
+                    c = cycles(t, chain)[0]
+                    if c > callee:
+                        callee, target = c, t
+                succ = [i + 1]
+            elif op in JUMPS:
+                if target in index and f.addr <= target < end:
+                    if target > addr_i:
+                        succ = [index[target]]
+                elif target is not None:
+                    name = funcs[target].name if target in funcs else ""
+                    if name.startswith(TABLE_JUMPS):
+                        succ = ["table"]
+                    callee = cycles(target, chain)[0]
+            elif op in BRANCHES:
+                succ = [i + 1]
+                if target in index and target > addr_i:
+                    succ.append(index[target])
+            elif op in SKIPS:
+                succ = [i + 1, i + 2]
+            elif op in INDIRECT_JUMPS:
+                succ = ["table"]
+            elif op not in RETURNS:
+                succ = [i + 1]
+            nxt, nxt_path = 0, []
+            for s in succ:
+                if s == "table":      # switch jump table: any later case
+                    if best_after[i + 1] > nxt:
+                        nxt, nxt_path = best_after[i + 1], []
+                elif s < len(f.insns) and dist[s] > nxt:
+                    nxt, nxt_path = dist[s], via[s]
+            dist[i] = cost + callee + nxt
+            via[i] = [(funcs[target].short(), callee)] + nxt_path if callee else nxt_path
+            best_after[i] = max(dist[i], best_after[i + 1])
+        chain.pop()
+        total = dist[0] if f.insns else 0
+        memo[addr] = (total, via[0] if f.insns else [])
+        return memo[addr]
+
+    return cycles
+
+
+def section_sizes(elf, objdump):
+    sizes = {}
+    for line in run(objdump, "-h", elf).splitlines():
+        m = SECTION.match(line)
+        if m:
+            sizes[m.group(1)] = int(m.group(2), 16)
+    return sizes
+
+
+def dynamic_frames(su_dir):
+    found = []
+    for dirpath, _, files in os.walk(su_dir or ""):
+        for name in sorted(files):
+            if not name.endswith(".su"):
+                continue
+            with open(os.path.join(dirpath, name), encoding="utf-8", errors="replace") as f:
+                for line in f:
+                    fields = line.rstrip("\n").split("\t")
+                    if len(fields) == 3 and "dynamic" in fields[2] and "bounded" not in fields[2]:
+                        found.append(fields[0])
+    return found
+
+
+def report(elf, ram, f_cpu, pc_bytes, objdump, su_dir):
+    funcs = parse_disassembly(run(objdump, "-d", "-C", elf))
+    analyze_frames(funcs)
+    targets = indirect_targets(funcs, elf, objdump)
+    by_name = {f.short(): a for a, f in funcs.items()}
+
+    depth = stack_depth(funcs, targets, pc_bytes)
+    cycles = path_cycles(funcs, targets, pc_bytes)
+    try:
+        print("Stack (bytes, worst path):")
+        for name in REPORTED + ROOTS:
+            if name in by_name:
+                d, p = depth(by_name[name], [])
+                print(f"  {name:<20} {d:5}  {' > '.join(p)}")
+        main_depth = max((depth(by_name[n], [])[0] for n in ROOTS if n in by_name), default=0)
+        isr_depth, isr_name = 0, "none"
+        for a, f in funcs.items():
+            if f.name.startswith("__vector_") and f.name != "__vector_default":
+                d = depth(a, [])[0] + pc_bytes    # the interrupt pushes the PC
+                if d > isr_depth:
+                    isr_depth, isr_name = d, f.name
+        print(f"  {'worst interrupt':<20} {isr_depth:5}  {isr_name}")
+    except Recursion as e:
+        print(f"stack_report: recursion has no static bound: {e}", file=sys.stderr)
+        return False
+
+    dynamic = dynamic_frames(su_dir)
+    for where in dynamic:
+        print(f"stack_report: dynamic stack frame: {where}", file=sys.stderr)
+    ok = not dynamic
+
+    sizes = section_sizes(elf, objdump)
+    data, bss = sizes.get(".data", 0), sizes.get(".bss", 0) + sizes.get(".noinit", 0)
+    free = ram - data - bss
+    total = main_depth + isr_depth
+    print(f"  {'total':<20} {total:5}  (main {main_depth} + interrupt {isr_depth})")
+    print(f"SRAM {ram} - .data {data} - .bss {bss} = {free} bytes for the stack: "
+          f"{'OK' if total <= free else 'OVERRUN'} ({free - total:+d})")
+    if total > free:
+        ok = False
+
+    if "loop" in by_name:
+        c, p = cycles(by_name["loop"], [])
+        print(f"loop() longest path (loops counted once, waits excluded): {c} cycles"
+              f" = {c * 1e6 / f_cpu:.0f} us at {f_cpu / 1e6:g} MHz")
+        for name, n in sorted(p, key=lambda call: -call[1])[:10]:
+            print(f"  {n:8}  {name}")
+    return ok
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("elf")
+    ap.add_argument("--ram", type=int, default=2048, help="SRAM size in bytes")
+    ap.add_argument("--f-cpu", type=float, default=16e6, help="clock in Hz")
+    ap.add_argument("--pc-bytes", type=int, default=2, help="return address size (3 above 128 KB flash)")
+    ap.add_argument("--objdump", default="avr-objdump")
+    ap.add_argument("--su-dir", help="directory searched for -fstack-usage .su files")
+    args = ap.parse_args()
+    ok = report(args.elf, args.ram, args.f_cpu, args.pc_bytes, args.objdump, args.su_dir)
+    return 0 if ok else 1
+
+
+try:
+    Import("env")  # noqa: F821 — defined when run by PlatformIO
+except NameError:
+    if __name__ == "__main__":
+        sys.exit(main())
+else:
+    def board_report(source, env):
+        board = env.BoardConfig()
+        flash = int(board.get("upload.maximum_size", 32256))
+        objdump = os.path.join(os.path.dirname(env.subst("$CC")) or "", "avr-objdump")
+        env_path = env["ENV"].get("PATH", "")
+        os.environ["PATH"] = env_path + os.pathsep + os.environ.get("PATH", "")
+        return report(str(source[0]), int(board.get("upload.maximum_ram_size", 2048)),
+                      float(str(board.get("build.f_cpu", "16000000L")).rstrip("L")),
+                      3 if flash > 128 * 1024 else 2, objdump, env.subst("$BUILD_DIR"))
+
+    def stack_check(target, source, env):
+        # After every build. A toolchain without avr-objdump skips the
+        # check rather than failing builds that would otherwise be fine
+        try:
+            ok = board_report(source, env)
+        except (OSError, ValueError, subprocess.CalledProcessError) as e:
+            print(f"stack_report: skipped: {e}", file=sys.stderr)
+            return
+        if not ok:
+            env.Exit(1)
+
+    def stack_target(target, source, env):
+        if not board_report(source, env):
+            env.Exit(1)
+
+    elf = "$BUILD_DIR/${PROGNAME}.elf"
+    env.AddPostAction(elf, stack_check)  # noqa: F821
+    env.AddCustomTarget("stack", elf, stack_target, title="Stack report",  # noqa: F821
+                        description="Worst-case stack depth and loop() cycles")